@@ -0,0 +1,395 @@
+#include "BinaryProtocol.hpp"
+#include "Latency.hpp"
+#include "Log.hpp"
+#include "TextFormat.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/**
+ * Load generator and end-to-end check for the TCP server.
+ *
+ *   load_generator [--host ADDR] [--port N] [--connections N] [--orders N]
+ *                  [--pipeline N] [--rate N] [--binary] [--first-id N]
+ *                  [--timeout SECONDS]
+ *
+ * Opens --connections sessions and sends --orders SUBMITs in total, split
+ * evenly between them (random side, price 95-105, quantity 1-10: a book that
+ * keeps trading). Each connection runs on its own thread, writes and reads
+ * without blocking, and matches every ACK (or ERR) to its request by order
+ * id, so RTT is measured per request however deep the pipeline.
+ *
+ * Closed loop (default): each connection keeps up to --pipeline requests in
+ * flight and sends the next as soon as one completes; RTT runs from the
+ * send. Open loop (--rate N): requests leave on a fixed schedule of N per
+ * second across all connections whatever the server's pace, and RTT runs
+ * from each request's *scheduled* time — a server that stalls is charged for
+ * every request it held up, not just the one in flight (no coordinated
+ * omission).
+ *
+ * Prints throughput and RTT percentiles; exits 1 if any request goes
+ * unanswered for --timeout seconds or a connection fails.
+ */
+
+namespace {
+
+struct Options {
+    const char*   host        = "127.0.0.1";
+    std::uint16_t port        = 6767;
+    std::size_t   connections = 1;
+    std::size_t   orders      = 100'000;
+    std::size_t   pipeline    = 1;
+    double        rate        = 0;  // orders/s across all connections; 0 = closed loop
+    bool          binary      = false;
+    OrderId       firstId     = 1;
+    std::uint32_t timeout     = 5;
+};
+
+template <class T>
+[[nodiscard]] std::optional<T> parse_number(std::string_view arg) noexcept {
+    T value{};
+    const auto [ptr, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    if (ec != std::errc{} || ptr != arg.data() + arg.size()) return std::nullopt;
+    return value;
+}
+
+[[nodiscard]] Options parse_options(int argc, char** argv) {
+    Options opts;
+    const auto set = []<class T>(T& field, std::string_view flag, std::string_view value) {
+        if (const auto n = parse_number<T>(value); n && *n > 0) field = *n;
+        else logln("Ignoring invalid {} '{}'.", flag, value);
+    };
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        const char* const value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (arg == "--binary") {
+            opts.binary = true;
+            continue;
+        }
+        if (!value) {
+            logln("Ignoring argument '{}'.", arg);
+            continue;
+        }
+        ++i;
+        if (arg == "--host")             opts.host = value;
+        else if (arg == "--port")        set(opts.port, arg, value);
+        else if (arg == "--connections") set(opts.connections, arg, value);
+        else if (arg == "--orders")      set(opts.orders, arg, value);
+        else if (arg == "--pipeline")    set(opts.pipeline, arg, value);
+        else if (arg == "--rate")        set(opts.rate, arg, value);
+        else if (arg == "--first-id")    set(opts.firstId, arg, value);
+        else if (arg == "--timeout")     set(opts.timeout, arg, value);
+        else {
+            logln("Ignoring argument '{}'.", arg);
+            --i;
+        }
+    }
+    return opts;
+}
+
+/// What one connection did; merged into the report once every thread ends.
+struct ConnectionResult {
+    LatencyHistogram rtt;
+    std::uint64_t    completed = 0;
+    std::uint64_t    fills     = 0;
+    std::uint64_t    rejects   = 0;
+    bool             failed    = false;
+};
+
+/**
+ * One client session. Requests are numbered 0..count-1 and carry order id
+ * firstId + number, so a response's id leads straight to the request's
+ * timestamp, whatever order responses come back in.
+ */
+class Connection {
+public:
+    Connection(const Options& opts, std::size_t index, std::size_t count, OrderId firstId)
+        : m_opts{&opts},
+          m_index{index},
+          m_firstId{firstId},
+          m_stamps(count, 0),
+          m_rng{static_cast<std::uint32_t>(index + 1)} {}
+
+    Connection(const Connection&)            = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    ~Connection() {
+        if (m_fd >= 0) ::close(m_fd);
+    }
+
+    /// Connect and, with --binary, switch the session over. False (after
+    /// reporting why) on failure.
+    [[nodiscard]] bool open() {
+        m_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons(m_opts->port);
+        if (::inet_pton(AF_INET, m_opts->host, &addr.sin_addr) != 1) {
+            logln("Invalid host address '{}'.", m_opts->host);
+            return false;
+        }
+        if (m_fd < 0 || ::connect(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            std::perror("connect");
+            return false;
+        }
+        const int one = 1;
+        ::setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        if (m_opts->binary) {
+            const std::string hello = std::string{kBinaryHello} + '\n';
+            char reply[kBinaryHelloReply.size()];
+            std::size_t got = 0;
+            if (::send(m_fd, hello.data(), hello.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(hello.size()))
+                return false;
+            while (got < sizeof(reply)) {
+                const ssize_t n = ::recv(m_fd, reply + got, sizeof(reply) - got, 0);
+                if (n <= 0) return false;
+                got += static_cast<std::size_t>(n);
+            }
+            if (std::string_view{reply, got} != kBinaryHelloReply) {
+                logln("Server refused the binary protocol.");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Send every request and wait for every response. `start` is the
+    /// shared open-loop epoch and `ticksPerOrder` the schedule's spacing
+    /// across all connections (0 = closed loop).
+    void run(std::uint64_t start, double ticksPerOrder, ConnectionResult& result) {
+        const std::uint64_t count     = m_stamps.size();
+        const double        perNs     = tsc_ticks_per_ns();
+        const auto          timeout   = static_cast<std::uint64_t>(m_opts->timeout * 1e9 * perNs);
+        const double        stride    = ticksPerOrder * static_cast<double>(m_opts->connections);
+        const double        offset    = ticksPerOrder * static_cast<double>(m_index);
+        std::uint64_t       sent      = 0;
+        std::uint64_t       progress  = read_tsc();  // last send or response
+        const auto          scheduled = [&](std::uint64_t k) {
+            return start + static_cast<std::uint64_t>(offset + stride * static_cast<double>(k));
+        };
+
+        while (result.completed < count) {
+            std::uint64_t now = read_tsc();
+            while (sent < count && (ticksPerOrder > 0 ? scheduled(sent) <= now
+                                                      : sent - result.completed < m_opts->pipeline)) {
+                m_stamps[sent] = ticksPerOrder > 0 ? scheduled(sent) : now;
+                encode(sent++);
+            }
+            if (!m_tx.empty() && !flush()) break;
+            if (!receive(result)) break;
+
+            now = read_tsc();
+            if (m_progressed) progress = now;
+            m_progressed = false;
+            if (result.completed < count && now - progress > timeout) {
+                logln("connection {}: no response for {} s ({} of {} requests answered).", m_index,
+                      m_opts->timeout, result.completed, count);
+                break;
+            }
+
+            // Wait for the socket, or (open loop) for the next send time.
+            std::int64_t waitNs = 1'000'000;
+            if (ticksPerOrder > 0 && sent < count) {
+                const std::uint64_t due = scheduled(sent);
+                waitNs = due > now ? static_cast<std::int64_t>(static_cast<double>(due - now) / perNs) : 0;
+                if (waitNs < 50'000) continue;  // spin: a poll() wakeup costs more
+            } else if (ticksPerOrder == 0 && sent < count && sent - result.completed < m_opts->pipeline) {
+                continue;  // a response just freed a slot
+            }
+            pollfd pfd{m_fd, static_cast<short>(POLLIN | (m_tx.empty() ? 0 : POLLOUT)), 0};
+            const timespec ts{waitNs / 1'000'000'000, waitNs % 1'000'000'000};
+            ::ppoll(&pfd, 1, &ts, nullptr);
+        }
+        result.failed = result.completed < count;
+    }
+
+private:
+    void encode(std::uint64_t k) {
+        const Order order{.id       = m_firstId + static_cast<OrderId>(k),
+                          .side     = m_side(m_rng) ? Side::Buy : Side::Sell,
+                          .price    = m_price(m_rng),
+                          .quantity = m_quantity(m_rng)};
+        if (m_opts->binary) {
+            encode_submit(m_tx, order);
+            return;
+        }
+        append_line(m_tx, 16 + 3 * kMaxIntChars, [&order](char* p) noexcept {
+            p = write_int(write_chars(p, "SUBMIT "), order.id);
+            p = write_chars(p, order.side == Side::Buy ? " B " : " S ");
+            p = write_int(p, order.price);
+            p = write_int(write_chars(p, " "), order.quantity);
+            return write_chars(p, "\n");
+        });
+    }
+
+    /// Write as much of m_tx as the socket takes; false on a dead socket.
+    [[nodiscard]] bool flush() {
+        const ssize_t n = ::send(m_fd, m_tx.data(), m_tx.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) return true;
+            std::perror("send");
+            return false;
+        }
+        m_tx.erase(0, static_cast<std::size_t>(n));
+        m_progressed = true;
+        return true;
+    }
+
+    /// Read whatever has arrived and settle each complete response; false
+    /// if the server closed the connection or the socket failed.
+    [[nodiscard]] bool receive(ConnectionResult& result) {
+        char buf[64 * 1024];
+        for (;;) {
+            const ssize_t n = ::recv(m_fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n == 0) {
+                logln("connection {}: server closed the connection.", m_index);
+                return false;
+            }
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EINTR) return true;
+                std::perror("recv");
+                return false;
+            }
+            m_rx.append(buf, static_cast<std::size_t>(n));
+            const std::uint64_t now = read_tsc();
+            const std::size_t   used = m_opts->binary ? settleBinary(result, now) : settleText(result, now);
+            m_rx.erase(0, used);
+            m_progressed = true;
+        }
+    }
+
+    /// Settle complete text lines: ACK <id> and ERR ... <id> end a request.
+    [[nodiscard]] std::size_t settleText(ConnectionResult& result, std::uint64_t now) {
+        std::size_t pos = 0;
+        for (std::size_t eol; (eol = m_rx.find('\n', pos)) != std::string::npos; pos = eol + 1) {
+            const std::string_view line{m_rx.data() + pos, eol - pos};
+            if (line.starts_with("FILL ")) {
+                ++result.fills;
+                continue;
+            }
+            const bool reject = line.starts_with("ERR ");
+            if (!reject && !line.starts_with("ACK ")) continue;
+            const std::string_view id = line.substr(line.rfind(' ') + 1);
+            if (const auto parsed = parse_number<OrderId>(id)) settle(*parsed, reject, result, now);
+        }
+        return pos;
+    }
+
+    /// Settle complete binary messages: Ack and Reject end a request.
+    [[nodiscard]] std::size_t settleBinary(ConnectionResult& result, std::uint64_t now) {
+        std::size_t pos = 0;
+        for (std::size_t n; (n = binary_message_size(std::string_view{m_rx}.substr(pos))) != 0; pos += n) {
+            BinaryHeader header;
+            std::memcpy(&header, m_rx.data() + pos, sizeof(header));
+            if (header.type == MsgType::Fill) {
+                ++result.fills;
+            } else if (header.type == MsgType::Ack && n == sizeof(AckMsg)) {
+                AckMsg ack;
+                std::memcpy(&ack, m_rx.data() + pos, sizeof(ack));
+                settle(from_wire(ack.id), false, result, now);
+            } else if (header.type == MsgType::Reject && n == sizeof(RejectMsg)) {
+                RejectMsg reject;
+                std::memcpy(&reject, m_rx.data() + pos, sizeof(reject));
+                settle(from_wire(reject.id), true, result, now);
+            }
+        }
+        return pos;
+    }
+
+    void settle(OrderId id, bool reject, ConnectionResult& result, std::uint64_t now) noexcept {
+        const auto k = static_cast<std::uint64_t>(id - m_firstId);
+        if (id < m_firstId || k >= m_stamps.size() || m_stamps[k] == 0) return;  // not ours, or settled
+        result.rtt.record(now > m_stamps[k] ? now - m_stamps[k] : 0);
+        m_stamps[k] = 0;
+        ++result.completed;
+        result.rejects += reject;
+    }
+
+    const Options*             m_opts;
+    std::size_t                m_index;
+    OrderId                    m_firstId;
+    std::vector<std::uint64_t> m_stamps;  // per request: send (or scheduled) TSC; 0 = settled or unsent
+    std::string                m_tx;
+    std::string                m_rx;
+    bool                       m_progressed = false;
+    int                        m_fd         = -1;
+
+    std::mt19937                            m_rng;
+    std::bernoulli_distribution             m_side{0.5};
+    std::uniform_int_distribution<Price>    m_price{95, 105};
+    std::uniform_int_distribution<Quantity> m_quantity{1, 10};
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const Options opts = parse_options(argc, argv);
+    const double  perNs = tsc_ticks_per_ns();  // calibrate before the clock starts
+
+    // Split the orders evenly; the first `orders % connections` take one extra.
+    std::vector<std::unique_ptr<Connection>> connections;
+    OrderId next = opts.firstId;
+    for (std::size_t c = 0; c < opts.connections; ++c) {
+        const std::size_t count = opts.orders / opts.connections + (c < opts.orders % opts.connections ? 1 : 0);
+        connections.push_back(std::make_unique<Connection>(opts, c, count, next));
+        if (!connections.back()->open()) return 1;
+        next += static_cast<OrderId>(count);
+    }
+
+    logln("{} orders over {} connection(s), {}, {} protocol", opts.orders, opts.connections,
+          opts.rate > 0 ? std::format("open loop at {:.0f} orders/s", opts.rate)
+                        : std::format("closed loop, pipeline depth {}", opts.pipeline),
+          opts.binary ? "binary" : "text");
+
+    std::vector<ConnectionResult> results(opts.connections);
+    const double ticksPerOrder = opts.rate > 0 ? 1e9 * perNs / opts.rate : 0.0;
+
+    using Clock = std::chrono::steady_clock;
+    const auto          wallStart = Clock::now();
+    const std::uint64_t start     = read_tsc() + static_cast<std::uint64_t>(1e6 * perNs);  // 1 ms for the threads
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t c = 0; c < opts.connections; ++c)
+            threads.emplace_back([&, c] { connections[c]->run(start, ticksPerOrder, results[c]); });
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - wallStart).count();
+
+    ConnectionResult total;
+    for (const ConnectionResult& r : results) {
+        total.rtt.merge(r.rtt);
+        total.completed += r.completed;
+        total.fills += r.fills;
+        total.rejects += r.rejects;
+        total.failed |= r.failed;
+    }
+
+    const auto us = [perNs](std::uint64_t ticks) { return static_cast<double>(ticks) / perNs / 1000.0; };
+    logln("done {} orders in {:.2f}s ({:.0f} orders/s), {} fills, {} rejects", total.completed, seconds,
+          seconds > 0 ? static_cast<double>(total.completed) / seconds : 0.0, total.fills, total.rejects);
+    logln("RTT us: p50={:.1f} p90={:.1f} p99={:.1f} p99.9={:.1f} max={:.1f}", us(total.rtt.percentile(50)),
+          us(total.rtt.percentile(90)), us(total.rtt.percentile(99)), us(total.rtt.percentile(99.9)),
+          us(total.rtt.max()));
+    return total.failed ? 1 : 0;
+}
@@ -7,10 +7,15 @@ SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 PROJECT_ROOT="$(cd "$SCRIPT_DIR/../.." && pwd)"
 BUILD_DIR="$PROJECT_ROOT/build"
 SERVER_BINARY="$BUILD_DIR/marketDataHandlerLL"
+GENERATOR_BINARY="$BUILD_DIR/benchmark/load_generator"
 
 # Default values
 NUM_ORDERS=100000
 PORT=6767
+CONNECTIONS=4
+PIPELINE=16
+RATE=""
+BINARY=""
 WAIT_TIME=2
 
 # Parse arguments
@@ -24,12 +29,32 @@ while [[ $# -gt 0 ]]; do
             PORT="$2"
             shift 2
             ;;
+        -c|--connections)
+            CONNECTIONS="$2"
+            shift 2
+            ;;
+        -d|--pipeline)
+            PIPELINE="$2"
+            shift 2
+            ;;
+        -r|--rate)
+            RATE="$2"
+            shift 2
+            ;;
+        --binary)
+            BINARY="--binary"
+            shift
+            ;;
         --help)
             echo "Usage: $0 [OPTIONS]"
             echo ""
             echo "Options:"
             echo "  -n, --num-orders NUM   Number of orders to send (default: 100000)"
             echo "  -p, --port PORT        Server port (default: 6767)"
+            echo "  -c, --connections NUM  Client connections (default: 4)"
+            echo "  -d, --pipeline NUM     Requests in flight per connection (default: 16)"
+            echo "  -r, --rate NUM         Open loop: send NUM orders/s in total instead"
+            echo "  --binary               Use the binary protocol"
             echo "  --help                 Show this help message"
             exit 0
             ;;
@@ -52,9 +77,11 @@ if [ ! -f "$SERVER_BINARY" ]; then
     exit 1
 fi
 
-# Check if generator.py exists
-if [ ! -f "$SCRIPT_DIR/generator.py" ]; then
-    echo "Error: generator.py not found at $SCRIPT_DIR/generator.py"
+# Check if the load generator exists
+if [ ! -f "$GENERATOR_BINARY" ]; then
+    echo "Error: load_generator not found at $GENERATOR_BINARY"
+    echo "Please build with benchmarks enabled:"
+    echo "  cmake -DBUILD_BENCHMARKS=ON .. && cmake --build ."
     exit 1
 fi
 
@@ -64,6 +91,12 @@ echo "========================================"
 echo "Server binary: $SERVER_BINARY"
 echo "Port:          $PORT"
 echo "Orders:        $NUM_ORDERS"
+echo "Connections:   $CONNECTIONS"
+if [ -n "$RATE" ]; then
+    echo "Rate:          $RATE orders/s (open loop)"
+else
+    echo "Pipeline:      $PIPELINE"
+fi
 echo "========================================"
 echo ""
 
@@ -75,7 +108,7 @@ if lsof -Pi :$PORT -sTCP:LISTEN -t >/dev/null 2>&1; then
 else
     # Start the server in background
     echo "Starting server..."
-    "$SERVER_BINARY" &
+    "$SERVER_BINARY" "$PORT" &
     SERVER_PID=$!
     
     # Wait for server to start
@@ -96,9 +129,11 @@ echo "Running integration test with $NUM_ORDERS orders..."
 echo ""
 
 # Run the generator
-cd "$SCRIPT_DIR"
-python3 generator.py $NUM_ORDERS
-TEST_RESULT=$?
+GENERATOR_ARGS=(--port "$PORT" --orders "$NUM_ORDERS" --connections "$CONNECTIONS" --pipeline "$PIPELINE")
+[ -n "$RATE" ] && GENERATOR_ARGS+=(--rate "$RATE")
+[ -n "$BINARY" ] && GENERATOR_ARGS+=("$BINARY")
+TEST_RESULT=0
+"$GENERATOR_BINARY" "${GENERATOR_ARGS[@]}" || TEST_RESULT=$?
 
 echo ""
 echo "========================================"
@@ -48,7 +48,16 @@ UNIT_RESULT=${PIPESTATUS[0]}
 
 echo ""
 echo "========================================"
-echo "2. Running Stress Tests"
+echo "2. Running Order-Flow Benchmarks"
+echo "========================================"
+echo ""
+
+./order_flow_bench --benchmark_out="$RESULTS_DIR/flow_${TIMESTAMP}.json" | tee "$RESULTS_DIR/flow_${TIMESTAMP}.txt"
+FLOW_RESULT=${PIPESTATUS[0]}
+
+echo ""
+echo "========================================"
+echo "3. Running Stress Tests"
 echo "========================================"
 echo ""
 
@@ -57,7 +66,7 @@ STRESS_RESULT=${PIPESTATUS[0]}
 
 echo ""
 echo "========================================"
-echo "3. Integration Tests"
+echo "4. Integration Tests"
 echo "========================================"
 
 # Check if server is already running
@@ -82,8 +91,7 @@ fi
 if [ -z "$INTEGRATION_RESULT" ]; then
     echo ""
     echo "Running integration test..."
-    cd "$SCRIPT_DIR/integration"
-    python3 generator.py 50000 | tee "$RESULTS_DIR/integration_${TIMESTAMP}.txt"
+    ./load_generator --orders 50000 --connections 4 --pipeline 16 | tee "$RESULTS_DIR/integration_${TIMESTAMP}.txt"
     INTEGRATION_RESULT=${PIPESTATUS[0]}
     
     # Stop server if we started it
@@ -107,6 +115,12 @@ else
     echo -e "${RED}✗${NC} Unit benchmarks: FAILED"
 fi
 
+if [ $FLOW_RESULT -eq 0 ]; then
+    echo -e "${GREEN}✓${NC} Order-flow benchmarks: PASSED"
+else
+    echo -e "${RED}✗${NC} Order-flow benchmarks: FAILED"
+fi
+
 if [ $STRESS_RESULT -eq 0 ]; then
     echo -e "${GREEN}✓${NC} Stress tests: PASSED"
 else
@@ -122,6 +136,7 @@ fi
 echo ""
 echo "Results saved to: $RESULTS_DIR"
 echo "  - unit_${TIMESTAMP}.txt"
+echo "  - flow_${TIMESTAMP}.json"
 echo "  - stress_${TIMESTAMP}.txt"
 echo "  - integration_${TIMESTAMP}.txt"
 
@@ -141,11 +156,20 @@ else
     echo "  cp $RESULTS_DIR/unit_${TIMESTAMP}.txt $BASELINE"
 fi
 
+FLOW_BASELINE="$RESULTS_DIR/baseline_flow.json"
+if [ -f "$FLOW_BASELINE" ]; then
+    python3 "$SCRIPT_DIR/tools/results_analyzer.py" \
+        "$FLOW_BASELINE" \
+        "$RESULTS_DIR/flow_${TIMESTAMP}.json"
+else
+    echo "  cp $RESULTS_DIR/flow_${TIMESTAMP}.json $FLOW_BASELINE   # order-flow baseline"
+fi
+
 echo ""
 echo "========================================"
 
 # Exit with error if any test failed
-if [ $UNIT_RESULT -ne 0 ] || [ $STRESS_RESULT -ne 0 ] || [ $INTEGRATION_RESULT -ne 0 ]; then
+if [ $UNIT_RESULT -ne 0 ] || [ $FLOW_RESULT -ne 0 ] || [ $STRESS_RESULT -ne 0 ] || [ $INTEGRATION_RESULT -ne 0 ]; then
     echo -e "${RED}Some benchmarks failed${NC}"
     exit 1
 else
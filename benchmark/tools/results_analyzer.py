@@ -5,10 +5,13 @@ Analyze and compare benchmark results from the order book matching engine.
 
 import sys
 import re
-from dataclasses import dataclass
+from dataclasses import dataclass, field
 from typing import List, Dict
 import json
 
+# Time units Google Benchmark-style JSON reports may use, in nanoseconds.
+TIME_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
 @dataclass
 class BenchmarkResult:
     name: str
@@ -18,14 +21,50 @@ class BenchmarkResult:
     p50_ns: float
     p95_ns: float
     p99_ns: float
+    counters: Dict[str, float] = field(default_factory=dict)  # per-op hardware counters, if measured
+
+def parse_json_results(data) -> List[BenchmarkResult]:
+    """Parse a JSON report: Google Benchmark's layout (order_flow_bench
+    --benchmark_out) or the list written by export_json()."""
+    if isinstance(data, list):
+        return [BenchmarkResult(
+                    name=b["name"],
+                    total_ops=int(b["total_ops"]),
+                    throughput=float(b["throughput_ops_per_sec"]),
+                    avg_latency_ns=float(b["avg_latency_ns"]),
+                    p50_ns=float(b["p50_latency_ns"]),
+                    p95_ns=float(b["p95_latency_ns"]),
+                    p99_ns=float(b["p99_latency_ns"]),
+                    counters=b.get("counters", {}))
+                for b in data]
+
+    results = []
+    for b in data.get("benchmarks", []):
+        if b.get("run_type", "iteration") != "iteration":
+            continue  # aggregates (mean, stddev) of repeated runs
+        scale = TIME_UNITS.get(b.get("time_unit", "ns"), 1.0)
+        avg = float(b["real_time"]) * scale
+        results.append(BenchmarkResult(
+            name=b["name"],
+            total_ops=int(b["iterations"]),
+            throughput=float(b.get("items_per_second", 1e9 / avg if avg else 0.0)),
+            avg_latency_ns=avg,
+            p50_ns=float(b.get("p50_ns", avg)),
+            p95_ns=float(b.get("p95_ns", avg)),
+            p99_ns=float(b.get("p99_ns", avg)),
+            counters={k[:-len("_per_op")]: float(v) for k, v in b.items() if k.endswith("_per_op")}))
+    return results
 
 def parse_results(filename: str) -> List[BenchmarkResult]:
-    """Parse benchmark output file."""
+    """Parse benchmark output file: benchmark_suite's text output, or a JSON report."""
     results = []
     
     with open(filename, 'r') as f:
         content = f.read()
     
+    if content.lstrip().startswith(('{', '[')):
+        return parse_json_results(json.loads(content))
+    
     # Split by benchmark sections
     sections = re.split(r'===\s+(.+?)\s+===', content)
     
@@ -72,6 +111,8 @@ def print_summary(results: List[BenchmarkResult]):
         print(f"  P50:              {r.p50_ns:.0f} ns")
         print(f"  P95:              {r.p95_ns:.0f} ns ({r.p95_ns/1000:.2f} us)")
         print(f"  P99:              {r.p99_ns:.0f} ns ({r.p99_ns/1000:.2f} us)")
+        for name, per_op in r.counters.items():
+            print(f"  {name + ' / op:':<18}{per_op:.2f}")
 
 def compare_results(baseline_file: str, current_file: str):
     """Compare two benchmark runs and show differences."""
@@ -136,7 +177,8 @@ def export_json(results: List[BenchmarkResult], output_file: str):
             "avg_latency_ns": r.avg_latency_ns,
             "p50_latency_ns": r.p50_ns,
             "p95_latency_ns": r.p95_ns,
-            "p99_latency_ns": r.p99_ns
+            "p99_latency_ns": r.p99_ns,
+            "counters": r.counters
         }
         for r in results
     ]
@@ -149,7 +191,7 @@ def export_json(results: List[BenchmarkResult], output_file: str):
 def main():
     if len(sys.argv) < 2:
         print("Usage:")
-        print("  python3 results_analyzer.py <results_file>           # Analyze single run")
+        print("  python3 results_analyzer.py <results_file>           # Analyze single run (text or JSON)")
         print("  python3 results_analyzer.py <baseline> <current>     # Compare two runs")
         print("  python3 results_analyzer.py <results_file> --json    # Export to JSON")
         sys.exit(1)
@@ -157,7 +199,10 @@ def main():
     if len(sys.argv) == 3 and sys.argv[2] == '--json':
         results = parse_results(sys.argv[1])
         print_summary(results)
-        export_json(results, sys.argv[1].replace('.txt', '.json'))
+        output = sys.argv[1].replace('.txt', '.json')
+        if output == sys.argv[1]:
+            output = sys.argv[1] + '.summary.json'  # don't overwrite a JSON input
+        export_json(results, output)
     elif len(sys.argv) == 3:
         compare_results(sys.argv[1], sys.argv[2])
     else:
@@ -1,3 +1,6 @@
+#include "BinaryProtocol.hpp"
+#include "EventLog.hpp"
+#include "LineScanner.hpp"
 #include "MatchingEngine.hpp"
 #include "Protocol.hpp"
 
@@ -13,10 +16,13 @@
 
 using namespace std::chrono;
 
-// Each benchmark runs under two sink policies:
-//   TextSinkAdapter — events formatted into a reused wire-protocol buffer,
-//                     comparable to what the server pays per message.
-//   NullSinkAdapter — events discarded, measuring pure engine cost.
+// Each benchmark runs under four sink policies:
+//   TextSinkAdapter   — events formatted into a reused wire-protocol buffer,
+//                       comparable to what the server pays per message.
+//   BinarySinkAdapter — the same for the binary protocol (packed structs).
+//   LogSinkAdapter    — events recorded into an EventLog, the matching
+//                       thread's share when formatting is left to another.
+//   NullSinkAdapter   — events discarded, measuring pure engine cost.
 
 struct TextSinkAdapter {
     static constexpr const char* label = "wire-format";
@@ -25,6 +31,19 @@ struct TextSinkAdapter {
     void beginOp() { buf.clear(); }
 };
 
+struct BinarySinkAdapter {
+    static constexpr const char* label = "binary-wire";
+    std::string buf;
+    BinarySink sink{buf};
+    void beginOp() { buf.clear(); }
+};
+
+struct LogSinkAdapter {
+    static constexpr const char* label = "event-log";
+    EventLog sink;
+    void beginOp() { sink.clear(); }
+};
+
 struct NullSinkAdapter {
     static constexpr const char* label = "engine-only";
     NullSink sink;
@@ -178,6 +197,78 @@ public:
         return computeStats(named<SinkAdapter>("Worst Case (Deep Book Cross)"), latencies, elapsed_sec);
     }
 
+    /// Submit bursts of 256 orders, with one submit() per order or as one
+    /// submitBatch() pipeline. Latency is per order: burst time / burst size.
+    template <class SinkAdapter>
+    BenchmarkResult benchmarkBurst(bool batched, int num_orders) {
+        constexpr int kBurst = 256;
+        MatchingEngine engine;
+        SinkAdapter out;
+        std::vector<Order> burst(kBurst);
+        std::vector<long long> latencies;
+        latencies.reserve(num_orders / kBurst);
+
+        const auto start = steady_clock::now();
+
+        for (int b = 0; b < num_orders / kBurst; ++b) {
+            for (int i = 0; i < kBurst; ++i) burst[i] = generateRandomOrder(b * kBurst + i);
+
+            out.beginOp();
+            const auto t1 = steady_clock::now();
+            if (batched) engine.submitBatch(burst, out.sink);
+            else         for (const Order& o : burst) engine.submit(o, out.sink);
+            const auto t2 = steady_clock::now();
+
+            latencies.push_back(duration_cast<nanoseconds>(t2 - t1).count() / kBurst);
+        }
+
+        const auto end = steady_clock::now();
+        const double elapsed_sec = duration_cast<microseconds>(end - start).count() / 1e6;
+
+        return computeStats(named<SinkAdapter>(batched ? "Submit Burst x256 (batched)" : "Submit Burst x256 (per order)"),
+                            latencies, elapsed_sec);
+    }
+
+    /// Frame and parse one 4 KiB receive chunk of text commands per op: a
+    /// find('\n') + parse_command() per line, or one parse_commands() pass.
+    BenchmarkResult benchmarkChunkParse(bool batched, int num_chunks) {
+        std::string chunk;
+        for (int i = 0; chunk.size() < 4096; ++i) {
+            const Order o = generateRandomOrder(i);
+            chunk += (i % 4 == 3) ? std::format("CANCEL {}\n", i - 3)
+                                  : std::format("SUBMIT {} {} {} {}\n", o.id, o.side == Side::Buy ? 'B' : 'S',
+                                                o.price, o.quantity);
+        }
+
+        CommandBatch batch;
+        std::size_t parsed = 0;  // keeps the loop observable
+        std::vector<long long> latencies;
+        latencies.reserve(num_chunks);
+
+        const auto start = steady_clock::now();
+
+        for (int i = 0; i < num_chunks; ++i) {
+            const auto t1 = steady_clock::now();
+            if (batched) {
+                for (const auto& command : parse_commands(chunk, batch)) parsed += command.has_value();
+            } else {
+                const std::string_view rx = chunk;
+                for (std::size_t pos = 0, nl; (nl = rx.find('\n', pos)) != std::string_view::npos; pos = nl + 1)
+                    parsed += parse_command(rx.substr(pos, nl - pos)).has_value();
+            }
+            const auto t2 = steady_clock::now();
+
+            latencies.push_back(duration_cast<nanoseconds>(t2 - t1).count());
+        }
+
+        const auto end = steady_clock::now();
+        const double elapsed_sec = duration_cast<microseconds>(end - start).count() / 1e6;
+
+        return computeStats(std::format("Parse 4 KiB Chunk ({} lines) [{}]", parsed / num_chunks,
+                                        batched ? std::format("batched-{}", line_scanner_isa()) : "per-line"),
+                            latencies, elapsed_sec);
+    }
+
 private:
     std::mt19937 gen;
     std::uniform_real_distribution<> dist{0.0, 1.0};
@@ -235,6 +326,8 @@ void runSuite(OrderBookBenchmark& bench, int num_ops) {
     printResult(bench.benchmarkMixedWorkload<SinkAdapter>(num_ops));
     printResult(bench.benchmarkCancelation<SinkAdapter>(num_ops));
     printResult(bench.benchmarkWorstCase<SinkAdapter>(10000));  // smaller for worst case
+    printResult(bench.benchmarkBurst<SinkAdapter>(false, num_ops));
+    printResult(bench.benchmarkBurst<SinkAdapter>(true, num_ops));
 }
 
 int main() {
@@ -250,8 +343,13 @@ int main() {
     const int NUM_OPS = 100000;
 
     runSuite<TextSinkAdapter>(bench, NUM_OPS);
+    runSuite<BinarySinkAdapter>(bench, NUM_OPS);
+    runSuite<LogSinkAdapter>(bench, NUM_OPS);
     runSuite<NullSinkAdapter>(bench, NUM_OPS);
 
+    printResult(bench.benchmarkChunkParse(false, NUM_OPS / 10));
+    printResult(bench.benchmarkChunkParse(true, NUM_OPS / 10));
+
     std::cout << "\n====================================" << std::endl;
     std::cout << "Benchmarks complete!" << std::endl;
 
@@ -0,0 +1,400 @@
+#include "Latency.hpp"
+#include "MatchingEngine.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Order-flow microbenchmarks in the style of Google Benchmark: a table of
+// named, parameterised cases, one console line each, and a JSON report
+// (--benchmark_out=FILE) in Google Benchmark's layout that
+// tools/results_analyzer.py reads.
+//
+// Unlike benchmark_suite's uniform prices, the flow here is shaped like a
+// real book's: prices are Zipf-distributed in ticks away from a mid that
+// random-walks, most orders are passive and rest near the touch, a share
+// cross it, and a share cancel earlier orders. Every case warms the book to
+// a given depth first, then times each operation with rdtsc into a
+// LatencyHistogram, and reads cycles, instructions, cache misses and branch
+// misses around the timed loop with perf_event_open (where the kernel lets
+// us). The flow is generated before timing starts, so only the engine is
+// measured; events go to a NullSink.
+//
+//   order_flow_bench [--benchmark_filter=REGEX] [--benchmark_out=FILE] [--ops=N]
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Workload
+// ---------------------------------------------------------------------------
+
+struct FlowConfig {
+    double      zipf       = 1.2;      // price-distance exponent; 0 = uniform over the band
+    Price       band       = 64;       // ticks either side of the mid
+    double      cancel     = 0.3;      // share of ops that cancel an earlier order
+    double      aggressive = 0.1;      // share of submits priced through the touch
+    std::size_t depth      = 1'000;    // resting orders placed before timing
+    std::size_t driftEvery = 1'000;    // ops between one-tick steps of the mid
+    unsigned    seed       = 42;
+};
+
+struct FlowOp {
+    enum class Kind : std::uint8_t { Submit, Cancel } kind;
+    Order order;  // for Cancel, only order.id
+};
+
+/// Samples 0..n-1 with P(k) proportional to 1 / (k + 1)^s.
+class ZipfDistribution {
+public:
+    ZipfDistribution(std::size_t n, double s) : m_cdf(n) {
+        double sum = 0;
+        for (std::size_t k = 0; k < n; ++k) m_cdf[k] = sum += 1.0 / std::pow(static_cast<double>(k + 1), s);
+        for (double& c : m_cdf) c /= sum;
+    }
+
+    template <class Rng>
+    std::size_t operator()(Rng& rng) {
+        const double u = m_uniform(rng);
+        return static_cast<std::size_t>(std::ranges::lower_bound(m_cdf, u) - m_cdf.begin());
+    }
+
+private:
+    std::vector<double>                    m_cdf;
+    std::uniform_real_distribution<double> m_uniform{0.0, 1.0};
+};
+
+class OrderFlow {
+public:
+    explicit OrderFlow(const FlowConfig& config)
+        : m_config{config}, m_rng{config.seed}, m_distance{static_cast<std::size_t>(config.band), config.zipf} {}
+
+    /// `count` resting orders on both sides of the book, none crossing.
+    std::vector<FlowOp> warmup(std::size_t count) {
+        std::vector<FlowOp> ops;
+        ops.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) ops.push_back(submit(false));
+        return ops;
+    }
+
+    /// `count` operations of the configured mix.
+    std::vector<FlowOp> generate(std::size_t count) {
+        std::vector<FlowOp> ops;
+        ops.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            if (m_config.driftEvery && i % m_config.driftEvery == 0) m_mid += coin(0.5) ? 1 : -1;
+            if (!m_live.empty() && coin(m_config.cancel)) {
+                // Any earlier order, filled or not — as real cancels race fills.
+                const std::size_t at = m_rng() % m_live.size();
+                ops.push_back(FlowOp{FlowOp::Kind::Cancel, Order{.id = m_live[at], .side = Side::Buy, .price = 0, .quantity = 0}});
+                m_live[at] = m_live.back();
+                m_live.pop_back();
+            } else {
+                ops.push_back(submit(coin(m_config.aggressive)));
+            }
+        }
+        return ops;
+    }
+
+private:
+    bool coin(double p) { return m_unit(m_rng) < p; }
+
+    FlowOp submit(bool aggressive) {
+        const Side  side     = coin(0.5) ? Side::Buy : Side::Sell;
+        const Price distance = static_cast<Price>(m_distance(m_rng));
+        // Passive orders rest 1 + distance ticks behind the mid; aggressive
+        // ones reach just as far through it, so even at distance 0 they cross
+        // the touch instead of resting at the mid.
+        const Price away  = aggressive ? -(1 + distance) : 1 + distance;
+        const Price price = side == Side::Buy ? m_mid - away : m_mid + away;
+        const Order order{.id = m_nextId++, .side = side, .price = price,
+                          .quantity = 1 + static_cast<Quantity>(m_rng() % (aggressive ? 20 : 10))};
+        m_live.push_back(order.id);  // an aggressive limit order rests whatever it does not fill
+        return FlowOp{FlowOp::Kind::Submit, order};
+    }
+
+    FlowConfig                             m_config;
+    std::mt19937_64                        m_rng;
+    ZipfDistribution                       m_distance;
+    std::uniform_real_distribution<double> m_unit{0.0, 1.0};
+    Price                                  m_mid    = 10'000;
+    OrderId                                m_nextId = 1;
+    std::vector<OrderId>                   m_live;  // orders that may still rest
+};
+
+// ---------------------------------------------------------------------------
+// Hardware counters
+// ---------------------------------------------------------------------------
+
+/// cycles, instructions, cache misses and branch misses of the calling
+/// thread, as one perf_event group. available() is false where the kernel
+/// refuses (no PMU, perf_event_paranoid, containers); the numbers are then
+/// simply left out.
+class PerfCounters {
+public:
+    static constexpr std::array<const char*, 4> kNames{"cycles", "instructions", "cache_misses", "branch_misses"};
+
+    PerfCounters() {
+        constexpr std::array<std::uint64_t, 4> configs{PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                       PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (std::size_t i = 0; i < configs.size(); ++i) {
+            perf_event_attr attr{};
+            attr.type           = PERF_TYPE_HARDWARE;
+            attr.size           = sizeof(attr);
+            attr.config         = configs[i];
+            attr.disabled       = i == 0;  // the group follows its leader
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.read_format    = PERF_FORMAT_GROUP;
+            const int group = i == 0 ? -1 : m_fds[0];
+            m_fds[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+            if (m_fds[i] < 0) {
+                close();
+                return;
+            }
+        }
+    }
+    ~PerfCounters() { close(); }
+
+    PerfCounters(const PerfCounters&)            = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    [[nodiscard]] bool available() const noexcept { return m_fds[0] >= 0; }
+
+    void start() noexcept {
+        if (!available()) return;
+        ::ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    /// Counts since start(), in kNames order; nullopt if unavailable.
+    [[nodiscard]] std::optional<std::array<std::uint64_t, 4>> stop() noexcept {
+        if (!available()) return std::nullopt;
+        ::ioctl(m_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        struct { std::uint64_t count; std::array<std::uint64_t, 4> values; } group{};
+        if (::read(m_fds[0], &group, sizeof(group)) != static_cast<ssize_t>(sizeof(group))) return std::nullopt;
+        return group.values;
+    }
+
+private:
+    void close() noexcept {
+        for (int& fd : m_fds) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+    }
+
+    std::array<int, 4> m_fds{-1, -1, -1, -1};
+};
+
+// ---------------------------------------------------------------------------
+// Harness
+// ---------------------------------------------------------------------------
+
+struct Result {
+    std::string                                  name;
+    std::size_t                                  ops     = 0;
+    double                                       seconds = 0;
+    std::unique_ptr<LatencyHistogram>            latency = std::make_unique<LatencyHistogram>();  // ticks per op
+    std::optional<std::array<std::uint64_t, 4>>  counters = std::nullopt;
+};
+
+struct Case {
+    std::string name;
+    FlowConfig  flow;
+    Result (*run)(const std::string& name, const FlowConfig& flow, std::size_t ops);
+};
+
+template <class Levels>
+Result run_flow(const std::string& name, const FlowConfig& flow, std::size_t ops) {
+    OrderFlow generator{flow};
+    const std::vector<FlowOp> warm  = generator.warmup(flow.depth);
+    const std::vector<FlowOp> timed = generator.generate(ops);
+
+    BasicMatchingEngine<Levels> engine{flow.depth + ops};
+    NullSink drop;
+    for (const FlowOp& op : warm) engine.submit(op.order, drop);
+
+    Result result{.name = name, .ops = ops};
+    PerfCounters perf;
+    const auto start = std::chrono::steady_clock::now();
+    perf.start();
+    for (const FlowOp& op : timed) {
+        const std::uint64_t t0 = read_tsc();
+        if (op.kind == FlowOp::Kind::Submit) engine.submit(op.order, drop);
+        else                                 engine.cancel(op.order.id, drop);
+        result.latency->record(read_tsc() - t0);
+    }
+    result.counters = perf.stop();
+    result.seconds  = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::string flow_name(std::string_view book, const FlowConfig& f) {
+    return std::format("OrderFlow<{}>/zipf:{}/cancel:{}/aggr:{}/depth:{}", book, f.zipf, f.cancel, f.aggressive,
+                       f.depth);
+}
+
+std::vector<Case> make_cases() {
+    const std::array<FlowConfig, 6> flows{{
+        {.cancel = 0.3, .aggressive = 0.1},                    // typical lit book
+        {.cancel = 0.0, .aggressive = 0.05},                   // building depth
+        {.cancel = 0.6, .aggressive = 0.05},                   // quote-stuffing: mostly cancels
+        {.cancel = 0.2, .aggressive = 0.4},                    // sweeping, trade-heavy
+        {.cancel = 0.3, .aggressive = 0.1, .depth = 100'000},  // deep book
+        {.zipf = 0.0, .cancel = 0.3, .aggressive = 0.1},       // flat prices, for contrast
+    }};
+    std::vector<Case> cases;
+    for (const FlowConfig& f : flows) {
+        cases.push_back({flow_name("Map", f), f, run_flow<MapLevels>});
+        cases.push_back({flow_name("Ladder", f), f, run_flow<LadderLevels<>>});
+    }
+    return cases;
+}
+
+// --- reporting ---
+
+struct Summary {
+    double ns_per_op, p50, p90, p95, p99, p999, max, ops_per_sec;
+};
+
+Summary summarize(const Result& r, double ticksPerNs) {
+    const LatencyHistogram& h = *r.latency;
+    const auto ns = [ticksPerNs](std::uint64_t ticks) { return static_cast<double>(ticks) / ticksPerNs; };
+    const double ops = static_cast<double>(r.ops);
+    return {r.seconds * 1e9 / ops, ns(h.percentile(50)), ns(h.percentile(90)), ns(h.percentile(95)),
+            ns(h.percentile(99)),  ns(h.percentile(99.9)), ns(h.max()), ops / r.seconds};
+}
+
+void print_header(bool counters) {
+    std::cout << std::format("{:<64} {:>9} {:>8} {:>8} {:>9} {:>12}", "Benchmark", "Time(ns)", "p50", "p99",
+                             "p99.9", "ops/s");
+    if (counters) std::cout << std::format(" {:>9} {:>9} {:>9} {:>9}", "cyc/op", "ins/op", "llc/kop", "br/kop");
+    std::cout << '\n' << std::string(counters ? 152 : 112, '-') << '\n';
+}
+
+void print_row(const Result& r, const Summary& s) {
+    std::cout << std::format("{:<64} {:>9.1f} {:>8.0f} {:>8.0f} {:>9.0f} {:>12.0f}", r.name, s.ns_per_op, s.p50,
+                             s.p99, s.p999, s.ops_per_sec);
+    if (r.counters) {
+        const auto& c   = *r.counters;
+        const auto per = [&r](std::uint64_t n, double scale) {
+            return static_cast<double>(n) * scale / static_cast<double>(r.ops);
+        };
+        std::cout << std::format(" {:>9.1f} {:>9.1f} {:>9.2f} {:>9.2f}", per(c[0], 1), per(c[1], 1), per(c[2], 1e3),
+                                 per(c[3], 1e3));
+    }
+    std::cout << '\n';
+}
+
+std::string json_escape(std::string_view s) {
+    std::string out;
+    for (const char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+bool write_json(const char* path, const std::vector<Result>& results, double ticksPerNs) {
+    std::ofstream out{path};
+    if (!out) {
+        std::perror(path);
+        return false;
+    }
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+    char host[256] = "unknown";
+    ::gethostname(host, sizeof(host) - 1);
+
+    out << "{\n  \"context\": {\n"
+        << std::format("    \"date\": \"{}\",\n    \"host_name\": \"{}\",\n    \"executable\": \"order_flow_bench\",\n"
+                       "    \"num_cpus\": {},\n    \"tsc_ticks_per_ns\": {:.4f}\n",
+                       date, json_escape(host), std::thread::hardware_concurrency(), ticksPerNs)
+        << "  },\n  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        const Summary s = summarize(r, ticksPerNs);
+        out << (i ? ",\n" : "\n") << "    {\n"
+            << std::format("      \"name\": \"{}\",\n      \"run_type\": \"iteration\",\n      \"iterations\": {},\n"
+                           "      \"real_time\": {:.3f},\n      \"cpu_time\": {:.3f},\n      \"time_unit\": \"ns\",\n"
+                           "      \"items_per_second\": {:.1f},\n      \"p50_ns\": {:.1f},\n      \"p90_ns\": {:.1f},\n"
+                           "      \"p95_ns\": {:.1f},\n      \"p99_ns\": {:.1f},\n      \"p999_ns\": {:.1f},\n"
+                           "      \"max_ns\": {:.1f}",
+                           json_escape(r.name), r.ops, s.ns_per_op, s.ns_per_op, s.ops_per_sec, s.p50, s.p90, s.p95,
+                           s.p99, s.p999, s.max);
+        if (r.counters) {
+            for (std::size_t c = 0; c < PerfCounters::kNames.size(); ++c)
+                out << std::format(",\n      \"{}_per_op\": {:.4f}", PerfCounters::kNames[c],
+                                   static_cast<double>((*r.counters)[c]) / static_cast<double>(r.ops));
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::optional<std::regex> filter;
+    const char*               jsonPath = nullptr;
+    std::size_t               ops      = 1'000'000;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        const auto value = [&](std::string_view flag) -> std::optional<std::string_view> {
+            if (!arg.starts_with(flag) || arg.size() <= flag.size() || arg[flag.size()] != '=') return std::nullopt;
+            return arg.substr(flag.size() + 1);
+        };
+        if (const auto v = value("--benchmark_filter")) {
+            filter.emplace(std::string{*v});
+        } else if (value("--benchmark_out")) {
+            jsonPath = argv[i] + std::string_view{"--benchmark_out="}.size();
+        } else if (const auto n = value("--ops")) {
+            std::from_chars(n->data(), n->data() + n->size(), ops);
+        } else {
+            std::cerr << "usage: order_flow_bench [--benchmark_filter=REGEX] [--benchmark_out=FILE] [--ops=N]\n";
+            return 2;
+        }
+    }
+    if (ops == 0) ops = 1;
+
+    const double ticksPerNs = tsc_ticks_per_ns();
+    const bool   counters   = PerfCounters{}.available();
+    std::cout << std::format("Run on {} CPUs, TSC {:.3f} GHz, {} ops per case\n", std::thread::hardware_concurrency(),
+                             ticksPerNs, ops);
+    if (!counters) std::cout << "perf_event_open unavailable: hardware counters omitted\n";
+    print_header(counters);
+
+    std::vector<Result> results;
+    for (const Case& c : make_cases()) {
+        if (filter && !std::regex_search(c.name, *filter)) continue;
+        results.push_back(c.run(c.name, c.flow, ops));
+        print_row(results.back(), summarize(results.back(), ticksPerNs));
+    }
+
+    if (jsonPath && !write_json(jsonPath, results, ticksPerNs)) return 1;
+    return 0;
+}
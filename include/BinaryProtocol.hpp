@@ -0,0 +1,237 @@
+#pragma once
+
+#include "BookRegistry.hpp"
+#include "MatchingEngine.hpp"
+#include "Protocol.hpp"
+#include "Symbol.hpp"
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// ---------------------------------------------------------------------------
+// Binary wire protocol
+//
+// Fixed-size little-endian messages, each led by a 4-byte header carrying the
+// total message length and its type. Every message is a packed, naturally
+// aligned struct with no implicit padding, so encoding is field byte order
+// plus one memcpy and decoding is one memcpy plus a length/type check — no
+// tokenizing, no integer parsing, no formatting.
+//
+//   client -> server   SUBMIT (48 B), CANCEL (24 B), MODIFY (40 B)
+//   server -> client   ACK, CANCEL_ACK (16 B), FILL (40 B), REJECT (16 B)
+//
+// A connection starts in the text protocol and switches by sending the line
+// "BINARY"; the server answers "ACK BINARY\n" and every byte after that line,
+// in both directions, is binary. There is no way back. DUMP remains text-only.
+// Symbol 0 addresses the default book, as an omitted symbol does in text.
+// ---------------------------------------------------------------------------
+
+/// Text line that switches a connection to the binary protocol.
+inline constexpr std::string_view kBinaryHello      = "BINARY";
+inline constexpr std::string_view kBinaryHelloReply = "ACK BINARY\n";
+
+enum class MsgType : std::uint8_t {
+    Submit    = 0x01,
+    Cancel    = 0x02,
+    Modify    = 0x03,
+    Ack       = 0x81,
+    CancelAck = 0x82,
+    Fill      = 0x83,
+    Reject    = 0x84,
+};
+
+/// RejectMsg reasons: the engine's RejectReasons plus session-level failures.
+enum class RejectCode : std::uint8_t {
+    DuplicateId     = 1,
+    BadQuantity     = 2,
+    UnknownOrder    = 3,  // cancel or modify of an id that is not resting
+    WouldCross      = 4,  // post-only submit that would have traded
+    QuantityLimit   = 5,  // pre-trade risk limits (RiskLimits), submit or modify
+    NotionalLimit   = 6,
+    PriceCollar     = 7,
+    OpenOrderLimit  = 8,
+    PositionLimit   = 9,
+    TooManyAccounts = 10,
+    SelfTrade       = 11,  // self-trade prevention cancelled the rest of the order
+    Killed          = 12,  // fill-or-kill submit that could not fill in full
+    UnknownSymbol   = 0x80,
+    BadMessage      = 0x81,  // unknown type, wrong length or bad field
+    Throttled       = 0x82,  // over the session's message rate
+    JournalFailed   = 0x83,  // the server can no longer journal commands
+};
+
+[[nodiscard]] constexpr RejectCode reject_code(RejectReason r) noexcept {
+    switch (r) {
+        using enum RejectReason;
+        case DuplicateId:     return RejectCode::DuplicateId;
+        case BadQuantity:     return RejectCode::BadQuantity;
+        case UnknownOrder:    return RejectCode::UnknownOrder;
+        case WouldCross:      return RejectCode::WouldCross;
+        case QuantityLimit:   return RejectCode::QuantityLimit;
+        case NotionalLimit:   return RejectCode::NotionalLimit;
+        case PriceCollar:     return RejectCode::PriceCollar;
+        case OpenOrderLimit:  return RejectCode::OpenOrderLimit;
+        case PositionLimit:   return RejectCode::PositionLimit;
+        case TooManyAccounts: return RejectCode::TooManyAccounts;
+        case SelfTrade:       return RejectCode::SelfTrade;
+        case Killed:          return RejectCode::Killed;
+        case Throttled:       return RejectCode::Throttled;
+        case JournalFailed:   return RejectCode::JournalFailed;
+    }
+    std::unreachable();  // C++23: all enumerators handled above
+}
+
+struct BinaryHeader {
+    std::uint16_t length;    // whole message, header included
+    MsgType       type;
+    std::uint8_t  reserved;
+};
+
+struct SubmitMsg {
+    BinaryHeader        header;
+    Side                side;
+    OrderType           type;
+    SelfTradePrevention stp;
+    std::uint8_t        reserved;
+    Account             account;  // kNoAccount: no self-trade prevention
+    std::uint32_t       reserved2;
+    SymbolCode          symbol;
+    OrderId             id;
+    Price               price;
+    Quantity            quantity;
+};
+
+struct CancelMsg {
+    BinaryHeader  header;
+    std::uint32_t reserved;
+    SymbolCode    symbol;
+    OrderId       id;
+};
+
+struct ModifyMsg {
+    BinaryHeader  header;
+    std::uint32_t reserved;
+    SymbolCode    symbol;
+    OrderId       id;
+    Price         price;
+    Quantity      quantity;  // new open quantity
+};
+
+struct AckMsg {  // MsgType::Ack or MsgType::CancelAck
+    BinaryHeader  header;
+    std::uint32_t reserved;
+    OrderId       id;
+};
+
+struct FillMsg {
+    BinaryHeader  header;
+    std::uint32_t reserved;
+    OrderId       taker;
+    OrderId       maker;
+    Price         price;
+    Quantity      quantity;
+};
+
+struct RejectMsg {
+    BinaryHeader  header;
+    RejectCode    reason;
+    std::uint8_t  reserved[3];
+    OrderId       id;  // 0 for BadMessage
+};
+
+static_assert(sizeof(BinaryHeader) == 4);
+static_assert(sizeof(SubmitMsg) == 48 && sizeof(CancelMsg) == 24 && sizeof(ModifyMsg) == 40);
+static_assert(sizeof(AckMsg) == 16 && sizeof(FillMsg) == 40 && sizeof(RejectMsg) == 16);
+static_assert(std::has_unique_object_representations_v<SubmitMsg> &&
+              std::has_unique_object_representations_v<ModifyMsg> &&
+              std::has_unique_object_representations_v<FillMsg>,
+              "wire structs must have no padding");
+
+/// Host <-> little-endian wire order (a no-op on little-endian hosts).
+template <std::integral T>
+[[nodiscard]] constexpr T to_wire(T v) noexcept {
+    if constexpr (std::endian::native == std::endian::big) return std::byteswap(v);
+    else                                                   return v;
+}
+template <std::integral T>
+[[nodiscard]] constexpr T from_wire(T v) noexcept { return to_wire(v); }
+
+template <class M>
+[[nodiscard]] constexpr BinaryHeader binary_header(MsgType type) noexcept {
+    return {to_wire(static_cast<std::uint16_t>(sizeof(M))), type, 0};
+}
+
+/// Append one message to `out` exactly as it goes on the wire.
+template <class M>
+void append_message(std::string& out, const M& msg) {
+    static_assert(std::is_trivially_copyable_v<M>);
+    out.append(reinterpret_cast<const char*>(&msg), sizeof(M));
+}
+
+/// Client-side encoders.
+void encode_submit(std::string& out, const Order& order, SymbolCode symbol = kNoSymbol);
+void encode_cancel(std::string& out, OrderId id, SymbolCode symbol = kNoSymbol);
+void encode_modify(std::string& out, OrderId id, Price price, Quantity quantity, SymbolCode symbol = kNoSymbol);
+
+/**
+ * Length of the complete message at the front of `rx`, or 0 if more bytes
+ * are needed. A header claiming less than its own size counts as a bare
+ * header, so a corrupt stream still makes progress (and is rejected).
+ */
+[[nodiscard]] std::size_t binary_message_size(std::string_view rx) noexcept;
+
+/// Decode one complete client message; nullopt if malformed (BadMessage).
+[[nodiscard]] std::optional<Command> decode_message(std::string_view msg) noexcept;
+
+/**
+ * Encodes engine events as binary messages, appending to a caller-owned
+ * buffer: AckEvent -> Ack, CancelAckEvent -> CancelAck, FillEvent -> Fill,
+ * RejectEvent -> Reject (a cancel of an unknown id is a Reject with
+ * UnknownOrder, where the text protocol answers "ACK <id> NOT_FOUND").
+ */
+class BinarySink {
+public:
+    explicit BinarySink(std::string& out) noexcept : m_out{&out} {}
+
+    void operator()(const AckEvent& e) const {
+        append_message(*m_out, AckMsg{binary_header<AckMsg>(MsgType::Ack), 0, to_wire(e.id)});
+    }
+
+    void operator()(const FillEvent& e) const {
+        append_message(*m_out, FillMsg{binary_header<FillMsg>(MsgType::Fill), 0, to_wire(e.taker),
+                                       to_wire(e.maker), to_wire(e.price), to_wire(e.quantity)});
+    }
+
+    void operator()(const CancelAckEvent& e) const {
+        append_message(*m_out, AckMsg{binary_header<AckMsg>(MsgType::CancelAck), 0, to_wire(e.id)});
+    }
+
+    void operator()(const RejectEvent& e) const { reject(e.id, reject_code(e.reason)); }
+
+    /// Session-level rejects that have no engine event (unknown symbol, ...).
+    void reject(OrderId id, RejectCode code) const {
+        append_message(*m_out, RejectMsg{binary_header<RejectMsg>(MsgType::Reject), code, {}, to_wire(id)});
+    }
+
+private:
+    std::string* m_out;
+};
+static_assert(EventSink<BinarySink>);
+
+/**
+ * Decode one complete binary message and apply it to the book for its
+ * symbol in `books`, appending the binary response to `tx` (not cleared).
+ * Commands that reach a book are first recorded in `journal`, if given;
+ * their fills and book updates are published to `feed`, if given. With a
+ * `throttle`, submits and modifies over its rate are rejected first. Once
+ * the journal has failed, every command is rejected as JournalFailed.
+ */
+void process_message(std::string_view msg, BookRegistry& books, std::string& tx, Journal* journal = nullptr,
+                     MarketDataRing* feed = nullptr, MessageThrottle* throttle = nullptr);
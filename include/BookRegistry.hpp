@@ -0,0 +1,77 @@
+#pragma once
+
+#include "MatchingEngine.hpp"
+#include "Symbol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using SymbolId = std::uint32_t;
+
+// ---------------------------------------------------------------------------
+// BookRegistry
+//
+// Hosts one MatchingEngine per instrument in a single process. Symbols are
+// registered up front (books are preallocated at startup, never on the
+// message path) and mapped to dense SymbolIds that index straight into the
+// book table. Id 0 is always the unnamed default book, which serves commands
+// that carry no symbol — so single-instrument clients work unchanged.
+//
+// Like the engines it owns, the registry is single-threaded.
+// ---------------------------------------------------------------------------
+
+class BookRegistry {
+public:
+    static constexpr SymbolId    kDefaultBook          = 0;
+    static constexpr std::size_t kDefaultOrdersPerBook = 1u << 12;
+
+    /// `expectedOpenOrdersPerBook` sizes each book's slab and id index; keep
+    /// it modest when hosting thousands of instruments. Every book enforces
+    /// `risk` on its own (limits are per account, per instrument).
+    explicit BookRegistry(std::size_t expectedOpenOrdersPerBook = kDefaultOrdersPerBook,
+                          const RiskLimits& risk = {})
+        : m_ordersPerBook{expectedOpenOrdersPerBook}, m_risk{risk} {
+        m_books.push_back(std::make_unique<MatchingEngine>(m_ordersPerBook, m_risk));
+        m_symbols.push_back(kNoSymbol);
+    }
+
+    BookRegistry(const BookRegistry&)            = delete;
+    BookRegistry& operator=(const BookRegistry&) = delete;
+
+    /// Register `symbol` (idempotent) and return its id. Startup-time only.
+    SymbolId add(SymbolCode symbol) {
+        const auto [it, inserted] = m_ids.try_emplace(symbol, static_cast<SymbolId>(m_books.size()));
+        if (inserted) {
+            m_books.push_back(std::make_unique<MatchingEngine>(m_ordersPerBook, m_risk));
+            m_symbols.push_back(symbol);
+        }
+        return it->second;
+    }
+
+    /// Book for `symbol`; kNoSymbol resolves to the default book. nullptr if
+    /// the symbol was never registered.
+    [[nodiscard]] MatchingEngine* find(SymbolCode symbol) noexcept {
+        if (symbol == kNoSymbol) return m_books[kDefaultBook].get();
+        const auto it = m_ids.find(symbol);
+        return it == m_ids.end() ? nullptr : m_books[it->second].get();
+    }
+
+    [[nodiscard]] MatchingEngine&       book(SymbolId id) noexcept { return *m_books[id]; }
+    [[nodiscard]] const MatchingEngine& book(SymbolId id) const noexcept { return *m_books[id]; }
+
+    /// Symbol of book `id` (kNoSymbol for the default book).
+    [[nodiscard]] SymbolCode symbol(SymbolId id) const noexcept { return m_symbols[id]; }
+
+    /// Number of books, including the default one.
+    [[nodiscard]] std::size_t size() const noexcept { return m_books.size(); }
+
+private:
+    std::size_t                                  m_ordersPerBook;
+    RiskLimits                                   m_risk;
+    std::vector<std::unique_ptr<MatchingEngine>> m_books;    // engines are immovable
+    std::vector<SymbolCode>                      m_symbols;  // parallel to m_books
+    std::unordered_map<SymbolCode, SymbolId>     m_ids;
+};
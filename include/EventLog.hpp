@@ -0,0 +1,228 @@
+#pragma once
+
+#include "MatchingEngine.hpp"
+#include "SpscQueue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Event log
+//
+// The engine's recording sink: events are appended to a compact, reusable
+// log and replayed later into a FormattingSink, BinarySink or any other
+// EventSink — after a submitBatch() burst, or on another thread to move
+// serialization off the matching thread.
+//
+// Storage is two columns: one tag byte per event, and the events' fields as
+// 8-byte words, back to back (an ack is 1 word, a fill 4). Recording an event
+// is a tag store plus a few word stores; there is no per-element variant to
+// construct or visit. Both columns are cache-line aligned and keep their
+// capacity across clear(), so a log that has reached its working size never
+// allocates again.
+//
+// EventLog records trade events only; BookEventLog is a MarketDataSink and
+// records book updates too. EventLogPipe circulates a fixed set of logs
+// between a recording thread and a replaying one.
+// ---------------------------------------------------------------------------
+
+enum class EventTag : std::uint8_t { Ack, Fill, CancelAck, Reject, OrderUpdate, LevelUpdate };
+
+/// std::allocator, but every block starts on a cache line.
+template <class T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+
+    CacheAlignedAllocator() noexcept = default;
+    template <class U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) noexcept {}
+
+    [[nodiscard]] T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{kCacheLine}));
+    }
+    void deallocate(T* p, std::size_t) noexcept { ::operator delete(p, std::align_val_t{kCacheLine}); }
+
+    template <class U>
+    bool operator==(const CacheAlignedAllocator<U>&) const noexcept { return true; }
+};
+
+template <bool BookUpdates>
+class alignas(kCacheLine) BasicEventLog {
+public:
+    /// Presize for `events` events of up to four words each.
+    void reserve(std::size_t events) {
+        m_tags.reserve(events);
+        m_words.reserve(4 * events);
+    }
+
+    // --- recording (the sink) ---
+
+    void operator()(const AckEvent& e)       { append(EventTag::Ack, word(e.id)); }
+    void operator()(const CancelAckEvent& e) { append(EventTag::CancelAck, word(e.id)); }
+    void operator()(const RejectEvent& e)    { append(EventTag::Reject, word(e.id), word(e.reason)); }
+
+    void operator()(const FillEvent& e) {
+        append(EventTag::Fill, word(e.taker), word(e.maker), word(e.price), word(e.quantity));
+    }
+
+    void operator()(const OrderUpdateEvent& e) requires BookUpdates {
+        append(EventTag::OrderUpdate, (word(e.action) << 8) | word(e.side), word(e.id), word(e.price),
+               word(e.quantity));
+    }
+    void operator()(const LevelUpdateEvent& e) requires BookUpdates {
+        append(EventTag::LevelUpdate, word(e.side), word(e.price), word(e.quantity));
+    }
+
+    // --- reading ---
+
+    [[nodiscard]] std::size_t size()  const noexcept { return m_tags.size(); }
+    [[nodiscard]] bool        empty() const noexcept { return m_tags.empty(); }
+
+    void clear() noexcept {  // keeps the capacity
+        m_tags.clear();
+        m_words.clear();
+    }
+
+    /// Replay into `sink`, then clear.
+    template <EventSink S>
+    void flush(S&& sink) {
+        replay(sink);
+        clear();
+    }
+
+    /// Same events, in the same order.
+    [[nodiscard]] bool operator==(const BasicEventLog&) const = default;
+
+    /// Deliver every recorded event to `sink`, in order. Book updates go
+    /// only to sinks that take them.
+    template <EventSink S>
+    void replay(S&& sink) const {
+        const std::uint64_t* w = m_words.data();
+        for (const EventTag tag : m_tags) {
+            switch (tag) {
+                using enum EventTag;
+                case Ack:
+                    sink(AckEvent{field<OrderId>(w[0])});
+                    w += 1;
+                    break;
+                case Fill:
+                    sink(FillEvent{field<OrderId>(w[0]), field<OrderId>(w[1]), field<Price>(w[2]),
+                                   field<Quantity>(w[3])});
+                    w += 4;
+                    break;
+                case CancelAck:
+                    sink(CancelAckEvent{field<OrderId>(w[0])});
+                    w += 1;
+                    break;
+                case Reject:
+                    sink(RejectEvent{field<OrderId>(w[0]), static_cast<RejectReason>(w[1])});
+                    w += 2;
+                    break;
+                case OrderUpdate:
+                    if constexpr (std::invocable<S&, const OrderUpdateEvent&>) {
+                        sink(OrderUpdateEvent{static_cast<BookAction>(w[0] >> 8), field<OrderId>(w[1]),
+                                              static_cast<Side>(w[0] & 0xff), field<Price>(w[2]),
+                                              field<Quantity>(w[3])});
+                    }
+                    w += 4;
+                    break;
+                case LevelUpdate:
+                    if constexpr (std::invocable<S&, const LevelUpdateEvent&>) {
+                        sink(LevelUpdateEvent{static_cast<Side>(w[0]), field<Price>(w[1]), field<Quantity>(w[2])});
+                    }
+                    w += 3;
+                    break;
+            }
+        }
+    }
+
+private:
+    template <class T>
+    [[nodiscard]] static constexpr std::uint64_t word(T v) noexcept {
+        if constexpr (std::is_enum_v<T>) return static_cast<std::uint64_t>(std::to_underlying(v));
+        else                             return std::bit_cast<std::uint64_t>(v);
+    }
+    template <class T>
+    [[nodiscard]] static constexpr T field(std::uint64_t w) noexcept { return std::bit_cast<T>(w); }
+
+    template <class... Words>
+    void append(EventTag tag, Words... words) {
+        m_tags.push_back(tag);
+        const std::size_t at = m_words.size();
+        m_words.resize(at + sizeof...(Words));
+        const std::array<std::uint64_t, sizeof...(Words)> values{words...};
+        std::ranges::copy(values, m_words.begin() + static_cast<std::ptrdiff_t>(at));
+    }
+
+    std::vector<EventTag, CacheAlignedAllocator<EventTag>>           m_tags;
+    std::vector<std::uint64_t, CacheAlignedAllocator<std::uint64_t>> m_words;
+};
+
+using EventLog     = BasicEventLog<false>;
+using BookEventLog = BasicEventLog<true>;
+static_assert(EventSink<EventLog> && !MarketDataSink<EventLog> && MarketDataSink<BookEventLog>);
+
+/**
+ * Hands filled logs from one recording thread to one replaying thread and
+ * returns them emptied: a fixed set of logs circulates through two SPSC
+ * queues, so once each log has grown to its working size nothing allocates.
+ *
+ *   recorder:  Log& log = pipe.acquire(); ...record...; pipe.publish(log);
+ *   replayer:  pipe.consume([&](const Log& log) { log.replay(sink); });
+ */
+template <class Log>
+class EventLogPipe {
+public:
+    explicit EventLogPipe(std::size_t logs = 4, std::size_t eventsPerLog = 1024)
+        : m_filled{logs}, m_free{logs} {
+        m_logs.reserve(logs);
+        for (std::size_t i = 0; i < logs; ++i) {
+            m_logs.push_back(std::make_unique<Log>());
+            m_logs.back()->reserve(eventsPerLog);
+            static_cast<void>(m_free.tryPush(m_logs.back().get()));
+        }
+    }
+
+    // --- recording thread ---
+
+    /// An empty log, waiting for the replayer to return one if all are in
+    /// flight.
+    [[nodiscard]] Log& acquire() noexcept {
+        Log* log = nullptr;
+        SpinBackoff backoff;
+        while (!m_free.tryPop(log)) backoff.idle();
+        return *log;
+    }
+
+    /// Pass a filled log (from acquire()) to the replayer.
+    void publish(Log& log) noexcept {
+        static_cast<void>(m_filled.tryPush(&log));  // never full: it holds every log
+    }
+
+    // --- replaying thread ---
+
+    /// Hand each published log to `fn` in publication order, then clear it
+    /// and return it to the recorder. Returns the number of logs consumed.
+    template <class F>
+    std::size_t consume(F&& fn) {
+        return m_filled.drain([&](Log* log) {
+            fn(std::as_const(*log));
+            log->clear();
+            static_cast<void>(m_free.tryPush(log));
+        });
+    }
+
+private:
+    std::vector<std::unique_ptr<Log>> m_logs;
+    SpscQueue<Log*>                   m_filled;  // recorder -> replayer
+    SpscQueue<Log*>                   m_free;    // replayer -> recorder
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Protocol.hpp"
+#include "SpscQueue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// ---------------------------------------------------------------------------
+// Journal
+//
+// Write-ahead journal of every SUBMIT, CANCEL and MODIFY that reached a
+// hosted book, in the order the books saw them, so a restarted server can
+// rebuild its resting orders by replaying the file (JournalReader).
+//
+// The matching thread only copies the command into a lock-free SpscQueue; a
+// dedicated writer thread encodes, writes and syncs. The writer drains
+// everything queued since its last pass and issues it as one write(), then
+// group-commits: one fdatasync/fsync covers every record written since the
+// previous sync, issued once `syncBatch` records are pending or
+// `syncInterval` has passed. Under load batches grow on their own, so the
+// sync rate stays bounded however fast commands arrive.
+//
+// Durability is asynchronous: responses go out before their record is
+// synced, so a crash can lose up to one sync window of commands the client
+// saw acknowledged. flush() blocks until everything appended so far is
+// durable. If the writer falls a full ring behind, append() spins until it
+// catches up — back-pressure rather than a silently dropped record.
+//
+// The first failed write or sync marks the journal unhealthy for good: the
+// writer stops writing (a partial record it left is a torn tail the next
+// open() drops) and only drains the ring, and the sessions reject every
+// command instead of applying it unrecorded. An idle writer spins briefly,
+// then sleeps syncInterval at a time, so it costs nothing without traffic.
+//
+// File format: a 16-byte header ("MEJOURNL", u32 version, u32 reserved)
+// followed by records that are exactly binary-protocol SubmitMsg/CancelMsg/
+// ModifyMsg messages (BinaryProtocol.hpp). A torn final record is discarded on open.
+// ---------------------------------------------------------------------------
+
+inline constexpr std::string_view kJournalMagic      = "MEJOURNL";
+inline constexpr std::uint32_t    kJournalVersion    = 2;  // 2: SubmitMsg carries account and stp
+inline constexpr std::size_t      kJournalHeaderSize = 16;
+
+class Journal {
+public:
+    enum class Sync : std::uint8_t {
+        None,  // write() only: survives a process crash, not a power loss
+        Data,  // fdatasync
+        Full,  // fsync
+    };
+
+    struct Config {
+        Sync                      sync         = Sync::Data;
+        std::size_t               ringCapacity = 1u << 16;  // records in flight to the writer
+        std::size_t               syncBatch    = 4096;      // sync once this many records are pending...
+        std::chrono::microseconds syncInterval{500};        // ...or the oldest has waited this long
+    };
+
+    /// Open (creating if needed) the journal at `path` for appending,
+    /// truncating any torn final record, and start the writer thread.
+    /// nullptr (after reporting why) on failure.
+    [[nodiscard]] static std::unique_ptr<Journal> open(const std::string& path, const Config& config);
+
+    ~Journal();  // writes and syncs everything appended, then joins the writer
+
+    Journal(const Journal&)            = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // --- matching thread (single producer) ---
+
+    void append(const SubmitCommand& command) noexcept { push(Command{command}); }
+    void append(const CancelCommand& command) noexcept { push(Command{command}); }
+    void append(const ModifyCommand& command) noexcept { push(Command{command}); }
+
+    /// Block until every record appended so far is written and synced.
+    void flush() noexcept;
+
+    /// Records in the journal so far, including those from earlier runs:
+    /// the position a snapshot taken now reflects.
+    [[nodiscard]] std::uint64_t appended() const noexcept { return m_appended; }
+
+    // --- any thread ---
+
+    /// Records known durable (written, and synced unless Sync::None).
+    [[nodiscard]] std::uint64_t durable() const noexcept { return m_durable.load(std::memory_order_acquire); }
+
+    /// False once a write or sync has failed; nothing is written after that.
+    [[nodiscard]] bool healthy() const noexcept { return !m_failed.load(std::memory_order_relaxed); }
+
+private:
+    Journal(int fd, const Config& config, std::uint64_t records);
+
+    void push(const Command& command) noexcept {
+        if (!m_ring.tryPush(command)) [[unlikely]] {
+            SpinBackoff backoff;
+            while (!m_ring.tryPush(command)) backoff.idle();
+        }
+        ++m_appended;
+    }
+
+    void run(std::stop_token stop);
+    [[nodiscard]] bool writeAll(std::string_view bytes) noexcept;
+    [[nodiscard]] bool sync() noexcept;
+
+    int                        m_fd;
+    Config                     m_config;
+    SpscQueue<Command>         m_ring;
+    std::uint64_t              m_appended = 0;      // producer-only
+    std::atomic<std::uint64_t> m_flushTarget{0};    // producer -> writer: sync through here now
+    std::atomic<std::uint64_t> m_durable{0};
+    std::atomic<bool>          m_failed{false};
+    std::jthread               m_writer;            // last: started once the rest is built
+};
+
+/**
+ * Reads a journal back for replay. A missing file is an empty journal;
+ * reading stops at the first incomplete or malformed record.
+ */
+class JournalReader {
+public:
+    /// nullopt (after reporting why) if `path` exists but is not a journal.
+    [[nodiscard]] static std::optional<JournalReader> load(const std::string& path);
+
+    /// The next record, or nullopt at the end of the valid prefix.
+    [[nodiscard]] std::optional<Command> next() noexcept;
+
+    /// Skip the first `records` records (those a snapshot already covers);
+    /// false if the journal holds fewer.
+    [[nodiscard]] bool skip(std::uint64_t records) noexcept;
+
+    /// Records read (or skipped) so far.
+    [[nodiscard]] std::uint64_t records() const noexcept { return m_records; }
+
+    /// Bytes of the file up to the end of the last complete record.
+    [[nodiscard]] std::size_t validBytes() const noexcept { return m_pos; }
+
+private:
+    explicit JournalReader(std::string data) noexcept;
+
+    std::string   m_data;
+    std::size_t   m_pos;
+    std::uint64_t m_records = 0;
+};
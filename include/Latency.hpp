@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Latency instrumentation
+//
+// Always-on timing of the server's hot path. The transports stamp each
+// received chunk with the TSC (rdtsc: ~20 cycles, no syscall) as it arrives,
+// after it is parsed, after its commands are matched, and once its responses
+// have been handed to the kernel; the differences go into log-linear
+// histograms owned by the recording thread. Recording is a couple of loads
+// and stores into a fixed table — no allocation, no locks, no shared cache
+// lines.
+//
+// Counters are single-writer atomics, so another thread may read a
+// consistent-enough snapshot at any time (STATS, or the periodic dump in
+// main) without stopping the network thread. Ticks are converted to
+// nanoseconds only when reporting, at a rate calibrated once against
+// steady_clock; that assumes an invariant TSC, as on any x86 server of the
+// last decade. Elsewhere the "TSC" is steady_clock in nanoseconds.
+// ---------------------------------------------------------------------------
+
+/// Current TSC value (see above).
+[[nodiscard]] inline std::uint64_t read_tsc() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/// TSC ticks per nanosecond, measured on first call (~10 ms) and cached.
+[[nodiscard]] double tsc_ticks_per_ns();
+
+/**
+ * HDR-style log-linear histogram of tick counts: 32 linear sub-buckets per
+ * power of two, so any recorded value is reported within 1/32 (3.1%) of its
+ * true value, across the full 64-bit range, in a fixed 15 KiB table.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned    kSubBucketBits = 5;
+    static constexpr std::size_t kSubBuckets    = std::size_t{1} << kSubBucketBits;
+    static constexpr std::size_t kBuckets       = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    /// Writer thread only.
+    void record(std::uint64_t ticks) noexcept {
+        bump(m_counts[index(ticks)]);
+        bump(m_count);
+        if (ticks > m_max.load(std::memory_order_relaxed)) m_max.store(ticks, std::memory_order_relaxed);
+    }
+
+    /// Add `other`'s counts into this one (for snapshots; safe to run
+    /// while `other`'s writer records).
+    void merge(const LatencyHistogram& other) noexcept;
+
+    [[nodiscard]] std::uint64_t count() const noexcept { return m_count.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t max() const noexcept { return m_max.load(std::memory_order_relaxed); }
+
+    /// Smallest value at or below which `percent`% of the samples lie, to
+    /// the histogram's precision; 0 when empty.
+    [[nodiscard]] std::uint64_t percentile(double percent) const noexcept;
+
+    [[nodiscard]] static constexpr std::size_t index(std::uint64_t v) noexcept {
+        if (v < kSubBuckets) return static_cast<std::size_t>(v);
+        const unsigned shift = static_cast<unsigned>(std::bit_width(v)) - 1 - kSubBucketBits;
+        return (shift + 1) * kSubBuckets + static_cast<std::size_t>((v >> shift) - kSubBuckets);
+    }
+    /// Largest value that lands in bucket `i`.
+    [[nodiscard]] static constexpr std::uint64_t highest(std::size_t i) noexcept {
+        if (i < kSubBuckets) return i;
+        const std::size_t shift = i / kSubBuckets - 1;
+        const std::uint64_t low = (kSubBuckets + i % kSubBuckets) << shift;
+        return low + ((std::uint64_t{1} << shift) - 1);
+    }
+
+private:
+    static void bump(std::atomic<std::uint64_t>& c) noexcept {
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);  // one writer: no RMW
+    }
+
+    std::array<std::atomic<std::uint64_t>, kBuckets> m_counts{};
+    std::atomic<std::uint64_t>                       m_count{0};
+    std::atomic<std::uint64_t>                       m_max{0};
+};
+
+/// The hot-path intervals the transports time, per received chunk.
+enum class LatencyStage : std::uint8_t {
+    Parse,  // recv -> text lines framed and parsed (text input only)
+    Match,  // -> commands applied and responses formatted (incl. shard round trips)
+    Send,   // -> responses accepted by the kernel
+    Total,  // recv -> send: tick-to-trade as the server sees it
+};
+inline constexpr std::size_t kLatencyStages = 4;
+
+struct LatencyStats {
+    std::array<LatencyHistogram, kLatencyStages> stages;
+
+    void record(LatencyStage stage, std::uint64_t ticks) noexcept {
+        stages[static_cast<std::size_t>(stage)].record(ticks);
+    }
+    [[nodiscard]] const LatencyHistogram& operator[](LatencyStage stage) const noexcept {
+        return stages[static_cast<std::size_t>(stage)];
+    }
+};
+
+/// The calling thread's histograms, allocated and registered on first use
+/// (then a plain TLS access).
+[[nodiscard]] LatencyStats& thread_latency_stats();
+
+/// Merge every thread's histograms (live and exited) into `out`.
+void latency_snapshot(LatencyStats& out);
+
+/**
+ * Append a report of `stats` to `out`, one line per stage, in nanoseconds:
+ *
+ *   STATS <stage> n=<samples> p50=<ns> p90=<ns> p99=<ns> p99.9=<ns> max=<ns>
+ */
+void format_latency_stats(const LatencyStats& stats, std::string& out);
+
+/**
+ * Timestamps of one connection's responses on their way out. The transport
+ * calls arrived() as each chunk comes in; process_input() records Parse and
+ * Match for the chunk; the transport calls sent() to record Send and Total
+ * once everything pending has been handed to the kernel.
+ */
+struct PendingLatency {
+    std::uint64_t received = 0;  // oldest chunk with unsent responses; 0 = none
+    std::uint64_t chunk    = 0;  // latest chunk's arrival
+    std::uint64_t matched  = 0;  // latest chunk's match end
+
+    void arrived(std::uint64_t tsc) noexcept {
+        chunk = tsc;
+        if (received == 0) received = tsc;
+    }
+
+    void sent(LatencyStats& stats) noexcept {
+        if (received == 0) return;
+        const std::uint64_t now = read_tsc();
+        stats.record(LatencyStage::Send, now - matched);
+        stats.record(LatencyStage::Total, now - received);
+        received = 0;
+    }
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// ChunkIndex
+//
+// Indexes every line and token boundary of a received chunk in one pass:
+// each 64-byte block is classified with a few vector compares (AVX2, or SSE2,
+// or a scalar fallback — chosen at compile time from the target ISA) into a
+// whitespace mask and a newline mask, and token starts/ends fall out of the
+// whitespace mask with a shift and two ANDs. Framing then walks the newline
+// list instead of calling find('\n') per line, and the tokenizer walks the
+// token list instead of testing bytes one at a time.
+// ---------------------------------------------------------------------------
+
+class ChunkIndex {
+public:
+    /// [begin, end) of one whitespace-delimited token.
+    struct Token {
+        std::uint32_t begin;
+        std::uint32_t end;
+    };
+
+    /// Index `chunk` (at most 4 GiB); the index refers to it until the next
+    /// build().
+    void build(std::string_view chunk);
+
+    [[nodiscard]] std::string_view chunk() const noexcept { return m_chunk; }
+
+    /// Offsets of every '\n' in the chunk, ascending.
+    [[nodiscard]] std::span<const std::uint32_t> newlines() const noexcept { return m_newlines; }
+
+    /// Every token in the chunk, in order. '\n' is whitespace, so no token
+    /// spans lines.
+    [[nodiscard]] std::span<const Token> tokens() const noexcept { return m_tokens; }
+
+    [[nodiscard]] std::string_view text(Token t) const noexcept { return m_chunk.substr(t.begin, t.end - t.begin); }
+
+private:
+    std::string_view           m_chunk;
+    std::vector<std::uint32_t> m_newlines;
+    std::vector<Token>         m_tokens;
+};
+
+/// Instruction set the scanner was compiled for ("avx2", "sse2", "scalar").
+[[nodiscard]] std::string_view line_scanner_isa() noexcept;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "MatchingEngine.hpp"
+#include "Order.hpp"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// DepthBook
+//
+// Consumer side of the L2 feed: an aggregated view of one book rebuilt from
+// LevelUpdateEvents alone, answering "top N levels" without ever seeing an
+// order or polling dump().
+//
+// Each side is a flat vector sorted worst-first, so the touch — where nearly
+// every update lands — sits at the back: finding a level is a binary search,
+// and adding or removing one near the touch moves only the few elements
+// behind it. A top-N read is a reverse copy of the last N entries.
+// ---------------------------------------------------------------------------
+
+struct DepthLevel {
+    Price    price;
+    Quantity quantity;
+
+    [[nodiscard]] bool operator==(const DepthLevel&) const = default;
+};
+
+class DepthBook {
+public:
+    /// Apply one L2 delta: set the level's quantity, or remove it at 0.
+    void apply(const LevelUpdateEvent& update);
+
+    /// Copy up to `out.size()` best levels of `side` into `out`, best first;
+    /// returns how many were written.
+    std::size_t top(Side side, std::span<DepthLevel> out) const noexcept;
+
+    /// Number of non-empty levels on `side`.
+    [[nodiscard]] std::size_t levels(Side side) const noexcept { return levelsOf(side).size(); }
+
+    void clear() noexcept {
+        m_bids.clear();
+        m_asks.clear();
+    }
+
+private:
+    [[nodiscard]] std::vector<DepthLevel>& levelsOf(Side side) noexcept {
+        return side == Side::Buy ? m_bids : m_asks;
+    }
+    [[nodiscard]] const std::vector<DepthLevel>& levelsOf(Side side) const noexcept {
+        return side == Side::Buy ? m_bids : m_asks;
+    }
+
+    std::vector<DepthLevel> m_bids;  // ascending price: best bid last
+    std::vector<DepthLevel> m_asks;  // descending price: best ask last
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "MatchingEngine.hpp"
+#include "Order.hpp"
+#include "SpscQueue.hpp"
+#include "Symbol.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// ---------------------------------------------------------------------------
+// Market-data ring
+//
+// Single-producer, many-consumer broadcast of fills and book updates through
+// a file in shared memory (typically under /dev/shm). The matching thread
+// publishes; any number of local processes map the same file read-only and
+// tail it — no sockets, no locks, no syscalls on either side once mapped.
+//
+// The ring is an array of cache-line slots, each holding one fixed-size
+// FeedRecord and its sequence number (1, 2, 3, ...). The producer never
+// waits for readers: record n overwrites record n - capacity. Each slot is
+// a seqlock — the producer clears the slot's sequence, writes the payload,
+// then stores the new sequence — so a reader copies the payload between two
+// reads of the sequence and keeps the copy only if both equal the sequence
+// it wanted. A reader that falls more than a ring behind therefore sees a
+// newer sequence in its slot: it is told how many records it lost and skips
+// to the oldest one still in the ring.
+//
+// File layout: FeedRingHeader ("MEMDRING", version, capacity, then the last
+// published sequence on a cache line of its own) followed by `capacity`
+// FeedSlots. Records are in host byte order: the feed never leaves the host.
+// ---------------------------------------------------------------------------
+
+inline constexpr std::string_view kFeedMagic   = "MEMDRING";
+inline constexpr std::uint32_t    kFeedVersion = 1;
+
+enum class FeedType : std::uint8_t {
+    Fill,   // id = taker, maker set; quantity = traded
+    Order,  // L3; action set; quantity = remaining
+    Level,  // L2; quantity = aggregate at the level, 0 = removed
+};
+
+struct FeedRecord {
+    std::uint64_t sequence    = 0;  // position in the feed, from 1; set on publish
+    SymbolCode    symbol      = kNoSymbol;
+    FeedType      type        = FeedType::Fill;
+    BookAction    action      = BookAction::Add;  // FeedType::Order only
+    Side          side        = Side::Buy;        // book side; unused for fills
+    std::uint8_t  reserved[5] = {};
+    OrderId       id          = 0;
+    OrderId       maker       = 0;                // FeedType::Fill only
+    Price         price       = 0;
+    Quantity      quantity    = 0;
+
+    [[nodiscard]] bool operator==(const FeedRecord&) const = default;
+};
+
+inline constexpr std::size_t kFeedWords = sizeof(FeedRecord) / sizeof(std::uint64_t);
+static_assert(sizeof(FeedRecord) == 56 && std::has_unique_object_representations_v<FeedRecord>);
+
+/// One record in the ring. Word 0 of the payload is the sequence itself.
+struct alignas(kCacheLine) FeedSlot {
+    std::atomic<std::uint64_t> words[kFeedWords];  // relaxed; ordered by words[0]
+};
+static_assert(sizeof(FeedSlot) == kCacheLine && std::atomic<std::uint64_t>::is_always_lock_free);
+
+struct alignas(kCacheLine) FeedRingHeader {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t slotSize;
+    std::uint64_t capacity;  // slots; a power of two
+
+    alignas(kCacheLine) std::atomic<std::uint64_t> published;  // last sequence written
+};
+
+/// Producer side. Owns the mapping; single-threaded (the matching thread).
+class MarketDataRing {
+public:
+    static constexpr std::size_t kDefaultCapacity = 1u << 16;  // 4 MiB of slots
+
+    /// Create a fresh ring of `capacity` (rounded up to a power of two)
+    /// records at `path`, replacing any existing file: readers still mapping
+    /// an old one keep it until they reopen. nullptr (after reporting why) on
+    /// failure.
+    [[nodiscard]] static std::unique_ptr<MarketDataRing> create(const std::string& path,
+                                                                std::size_t capacity = kDefaultCapacity);
+
+    ~MarketDataRing();
+
+    MarketDataRing(const MarketDataRing&)            = delete;
+    MarketDataRing& operator=(const MarketDataRing&) = delete;
+
+    /// Append `record` as the next sequence (its `sequence` is ignored).
+    void publish(const FeedRecord& record) noexcept {
+        const std::uint64_t seq = ++m_published;
+        auto words = std::bit_cast<std::array<std::uint64_t, kFeedWords>>(record);
+        words[0]   = seq;
+
+        FeedSlot& slot = m_slots[(seq - 1) & m_mask];
+        slot.words[0].store(0, std::memory_order_relaxed);  // mark the slot torn...
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 1; i < kFeedWords; ++i) slot.words[i].store(words[i], std::memory_order_relaxed);
+        slot.words[0].store(seq, std::memory_order_release);  // ...and whole again
+        m_header->published.store(seq, std::memory_order_release);
+    }
+
+    [[nodiscard]] std::uint64_t published() const noexcept { return m_published; }
+    [[nodiscard]] std::size_t   capacity()  const noexcept { return m_mask + 1; }
+
+private:
+    MarketDataRing(void* base, std::size_t bytes, std::size_t capacity) noexcept;
+
+    void*           m_base;
+    std::size_t     m_bytes;
+    FeedRingHeader* m_header;
+    FeedSlot*       m_slots;
+    std::size_t     m_mask;
+    std::uint64_t   m_published = 0;
+};
+
+/// Consumer side: a read-only mapping of a ring, tailed from where the
+/// producer was when it was opened.
+class MarketDataReader {
+public:
+    enum class Poll : std::uint8_t {
+        Record,   // `out` holds the next record
+        Empty,    // nothing new yet
+        Overrun,  // fell a ring behind: lost() grew, reading resumes at the oldest record left
+    };
+
+    /// nullptr (after reporting why) if `path` cannot be mapped or is not a ring.
+    [[nodiscard]] static std::unique_ptr<MarketDataReader> open(const std::string& path);
+
+    ~MarketDataReader();
+
+    MarketDataReader(const MarketDataReader&)            = delete;
+    MarketDataReader& operator=(const MarketDataReader&) = delete;
+
+    [[nodiscard]] Poll poll(FeedRecord& out) noexcept;
+
+    /// Restart from the oldest record still in the ring.
+    void rewind() noexcept;
+
+    [[nodiscard]] std::uint64_t next() const noexcept { return m_next; }  // sequence poll() wants
+    [[nodiscard]] std::uint64_t lost() const noexcept { return m_lost; }
+
+private:
+    MarketDataReader(const void* base, std::size_t bytes) noexcept;
+
+    [[nodiscard]] std::uint64_t oldest() const noexcept;
+
+    const void*           m_base;
+    std::size_t           m_bytes;
+    const FeedRingHeader* m_header;
+    const FeedSlot*       m_slots;
+    std::size_t           m_mask;
+    std::uint64_t         m_next;
+    std::uint64_t         m_lost = 0;
+};
+
+/**
+ * Sink adapter: forwards trade events to `Inner` (the session's response
+ * sink) and publishes fills and L2/L3 book updates for `symbol` to a ring.
+ */
+template <EventSink Inner>
+class FeedSink {
+public:
+    FeedSink(Inner inner, MarketDataRing& ring, SymbolCode symbol) noexcept
+        : m_inner{inner}, m_ring{&ring}, m_symbol{symbol} {}
+
+    void operator()(const AckEvent& e)       { m_inner(e); }
+    void operator()(const CancelAckEvent& e) { m_inner(e); }
+    void operator()(const RejectEvent& e)    { m_inner(e); }
+
+    void operator()(const FillEvent& e) {
+        m_inner(e);
+        m_ring->publish(FeedRecord{.symbol = m_symbol, .type = FeedType::Fill, .id = e.taker, .maker = e.maker,
+                                   .price = e.price, .quantity = e.quantity});
+    }
+    void operator()(const OrderUpdateEvent& e) const noexcept {
+        m_ring->publish(FeedRecord{.symbol = m_symbol, .type = FeedType::Order, .action = e.action, .side = e.side,
+                                   .id = e.id, .price = e.price, .quantity = e.quantity});
+    }
+    void operator()(const LevelUpdateEvent& e) const noexcept {
+        m_ring->publish(FeedRecord{.symbol = m_symbol, .type = FeedType::Level, .side = e.side, .price = e.price,
+                                   .quantity = e.quantity});
+    }
+
+private:
+    Inner           m_inner;
+    MarketDataRing* m_ring;
+    SymbolCode      m_symbol;
+};
+
+/// Call `apply` with `sink`, or — given a ring — with `sink` wrapped in a
+/// FeedSink publishing `symbol`'s market data. Keeps the no-feed
+/// instantiation exactly the plain sink.
+template <EventSink Sink, class Apply>
+void with_feed(MarketDataRing* ring, SymbolCode symbol, Sink sink, Apply&& apply) {
+    if (ring) apply(FeedSink<Sink>{sink, *ring, symbol});
+    else      apply(sink);
+}
@@ -1,48 +1,24 @@
 #pragma once
 
+#include "Order.hpp"
+#include "OrderIndex.hpp"
+#include "OrderPool.hpp"
+#include "PriceLevels.hpp"
+
 #include <algorithm>
-#include <array>
+#include <bit>
 #include <concepts>
 #include <cstdint>
 #include <format>
-#include <functional>
 #include <iterator>
-#include <list>
-#include <map>
 #include <memory_resource>
 #include <optional>
 #include <ranges>
+#include <span>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <utility>
-#include <variant>
-
-// ---------------------------------------------------------------------------
-// Core domain types
-// ---------------------------------------------------------------------------
-
-using OrderId  = std::int64_t;
-using Price    = std::int64_t;
-using Quantity = std::int64_t;
-
-enum class Side : std::uint8_t { Buy, Sell };
-
-[[nodiscard]] constexpr std::string_view side_label(Side s) noexcept {
-    constexpr std::array labels{std::string_view{"BUY"}, std::string_view{"SELL"}};
-    return labels[std::to_underlying(s)];  // C++23: std::to_underlying
-}
-static_assert(side_label(Side::Buy)  == "BUY",  "side_label: Buy  label mismatch");
-static_assert(side_label(Side::Sell) == "SELL", "side_label: Sell label mismatch");
-
-struct Order {
-    OrderId  id;
-    Side     side;
-    Price    price;
-    Quantity quantity;
-
-    [[nodiscard]] bool operator==(const Order&) const = default;
-};
+#include <vector>
 
 // ---------------------------------------------------------------------------
 // Engine events
@@ -56,11 +32,23 @@ struct Order {
 
 enum class RejectReason : std::uint8_t {
     DuplicateId,   // SUBMIT with an id that is already resting
-    BadQuantity,   // SUBMIT with quantity <= 0
-    UnknownOrder,  // CANCEL for an id that is not resting
+    BadQuantity,   // SUBMIT or MODIFY with quantity <= 0
+    UnknownOrder,  // CANCEL or MODIFY for an id that is not resting
+    WouldCross,    // post-only SUBMIT that would have traded on arrival
+    // Pre-trade risk (RiskLimits), SUBMIT or MODIFY:
+    QuantityLimit,   // quantity above the per-order limit
+    NotionalLimit,   // |price| * quantity above the per-order limit
+    PriceCollar,     // limit price too far through the touch
+    OpenOrderLimit,  // the account already rests its maximum number of orders
+    PositionLimit,   // a full fill would take the account past its position limit
+    TooManyAccounts, // a new account when the book already tracks its limit of accounts
+    SelfTrade,       // self-trade prevention cancelled what was left of the order (after any fills)
+    Killed,          // fill-or-kill SUBMIT the book could not fill in full; nothing traded
+    Throttled,       // over the session's message rate; answered by the session, never a book
+    JournalFailed,   // the session's journal can no longer record commands; likewise from the session
 };
 
-struct AckEvent {  // SUBMIT accepted
+struct AckEvent {  // SUBMIT or MODIFY accepted
     OrderId id;
     [[nodiscard]] bool operator==(const AckEvent&) const = default;
 };
@@ -68,7 +56,7 @@ struct FillEvent {
     OrderId taker; OrderId maker; Price price; Quantity quantity;
     [[nodiscard]] bool operator==(const FillEvent&) const = default;
 };
-struct CancelAckEvent {  // CANCEL succeeded
+struct CancelAckEvent {  // CANCEL succeeded, or self-trade prevention took a resting order out
     OrderId id;
     [[nodiscard]] bool operator==(const CancelAckEvent&) const = default;
 };
@@ -86,12 +74,262 @@ concept EventSink =
     std::invocable<S&, const CancelAckEvent&> &&
     std::invocable<S&, const RejectEvent&>;
 
+// ---------------------------------------------------------------------------
+// Market data
+//
+// A sink that also accepts the two book-update events below receives an
+// incremental feed of the book as a by-product of matching: L3, order by
+// order, and L2, the aggregate quantity per level (kept on each level as
+// orders come and go, never recomputed). The engine checks for them at
+// compile time, so sinks that do not take them pay nothing.
+//
+// Within one command, each order update is delivered before the update of
+// the level it changed, and a level is reported at most once per command.
+// An order that loses its queue position to a MODIFY is reported as a
+// Delete followed by an Add, so L3 consumers re-queue it too.
+// ---------------------------------------------------------------------------
+
+enum class BookAction : std::uint8_t {
+    Add,     // order now resting
+    Modify,  // resting order partially filled or reduced; quantity is what remains
+    Delete,  // resting order filled or cancelled; quantity is 0
+};
+
+struct OrderUpdateEvent {  // L3
+    BookAction action; OrderId id; Side side; Price price; Quantity quantity;
+    [[nodiscard]] bool operator==(const OrderUpdateEvent&) const = default;
+};
+struct LevelUpdateEvent {  // L2: new aggregate quantity; 0 = level removed
+    Side side; Price price; Quantity quantity;
+    [[nodiscard]] bool operator==(const LevelUpdateEvent&) const = default;
+};
+
+template <typename S>
+concept MarketDataSink =
+    EventSink<S>                                &&
+    std::invocable<S&, const OrderUpdateEvent&> &&
+    std::invocable<S&, const LevelUpdateEvent&>;
+
 /// Discards all events. Useful for benchmarks that measure pure engine cost.
 struct NullSink {
     static constexpr void operator()(const auto&) noexcept {}  // C++23: static operator()
 };
 static_assert(EventSink<NullSink>);
 
+// ---------------------------------------------------------------------------
+// Pre-trade risk
+//
+// Limits a book enforces on its own thread before an order can trade: order
+// size and notional, a price collar around the touch, and per-account open
+// orders and position. Account state is a small open-addressed table of
+// counters, keyed by account, that the engine updates as orders rest, leave,
+// shrink and fill. A maker's account is read off the resting order the fill
+// touches anyway, so checking an order costs a few compares and one probe.
+// ---------------------------------------------------------------------------
+
+struct RiskLimits {
+    Quantity      maxQuantity   = 0;     // per order; 0 = unlimited, likewise below
+    Quantity      maxNotional   = 0;     // |price| * quantity per order
+    Price         collar        = 0;     // ticks a limit price may reach through the opposite touch
+    std::uint32_t maxOpenOrders = 0;     // resting orders per account
+    Quantity      maxPosition   = 0;     // |net position| per account, with its open orders on the order's side filled
+    std::uint32_t accountSlots  = 1024;  // accounts tracked; orders from any further account are rejected
+
+    [[nodiscard]] bool perAccount() const noexcept { return maxOpenOrders != 0 || maxPosition != 0; }
+    [[nodiscard]] bool any() const noexcept { return maxQuantity || maxNotional || collar || perAccount(); }
+};
+
+/**
+ * Checks orders against RiskLimits and keeps the per-account counters those
+ * need, only when a per-account limit is set. Every account has a counter
+ * entry of its own, kept for the life of the book; once accountSlots
+ * accounts have one, orders from new accounts are rejected (TooManyAccounts).
+ * Orders without an account share the entry of kNoAccount.
+ */
+class RiskGate {
+public:
+    RiskGate() = default;  // no limits
+    explicit RiskGate(const RiskLimits& limits)
+        : m_limits{limits},
+          m_accounts(limits.perAccount() ? std::bit_ceil(2 * std::max<std::size_t>(limits.accountSlots, 1)) : 0),
+          m_enabled{limits.any()} {}
+
+    [[nodiscard]] bool enabled() const noexcept { return m_enabled; }
+    [[nodiscard]] const RiskLimits& limits() const noexcept { return m_limits; }
+
+    /**
+     * The first limit `order` would break, or nullopt. A nonzero `replacing`
+     * makes the order a MODIFY of one resting with that open quantity: the
+     * open-order limit does not apply and the old quantity no longer counts
+     * as open. The position check assumes every open order of the account
+     * on the order's side fills, and the order too. A market order is never
+     * collared, and its notional is valued at the opposite touch (unchecked
+     * on an empty side).
+     */
+    [[nodiscard]] std::optional<RejectReason> check(const Order& order, std::optional<Price> bestBid,
+                                                    std::optional<Price> bestAsk,
+                                                    Quantity replacing = 0) const noexcept {
+        const bool                 buy      = order.side == Side::Buy;
+        const bool                 market   = order.type == OrderType::Market;
+        const std::optional<Price> opposite = buy ? bestAsk : bestBid;
+
+        if (m_limits.maxQuantity && order.quantity > m_limits.maxQuantity) return RejectReason::QuantityLimit;
+
+        if (m_limits.maxNotional) {
+            const Price px = market ? opposite.value_or(0) : order.price;
+            const Price magnitude = px < 0 ? -px : px;
+            if (magnitude != 0 && order.quantity > m_limits.maxNotional / magnitude)  // no overflow
+                return RejectReason::NotionalLimit;
+        }
+
+        if (m_limits.collar && !market) {
+            // Against the opposite touch, else the order's own side's.
+            if (const std::optional<Price> ref = opposite ? opposite : (buy ? bestBid : bestAsk)) {
+                if (buy ? order.price > *ref + m_limits.collar : order.price < *ref - m_limits.collar)
+                    return RejectReason::PriceCollar;
+            }
+        }
+
+        if (!m_accounts.empty()) {
+            const AccountRisk* const found = find(order.account);
+            if (!found && m_used >= m_limits.accountSlots) return RejectReason::TooManyAccounts;
+            const AccountRisk account = found ? *found : AccountRisk{};
+
+            const bool rests = order.type == OrderType::Limit || order.type == OrderType::PostOnly;
+            if (m_limits.maxOpenOrders && rests && replacing == 0 && account.openOrders >= m_limits.maxOpenOrders)
+                return RejectReason::OpenOrderLimit;
+            if (m_limits.maxPosition) {
+                const Quantity exposure = (buy ? account.openBuy : account.openSell) - replacing + order.quantity;
+                if (buy ? account.position + exposure > m_limits.maxPosition
+                        : account.position - exposure < -m_limits.maxPosition)
+                    return RejectReason::PositionLimit;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // --- per-account bookkeeping, driven by the engine ---
+
+    /// An order of `account` now rests `quantity` on `side`.
+    void rested(Account account, Side side, Quantity quantity) {
+        if (m_accounts.empty()) return;
+        AccountRisk& a = entry(account);
+        ++a.openOrders;
+        open(a, side) += quantity;
+    }
+    /// A resting order of `account` changed size by `delta` without trading.
+    void resized(Account account, Side side, Quantity delta) {
+        if (!m_accounts.empty()) open(entry(account), side) += delta;
+    }
+    /// A resting order of `account` left the book with `remaining` still open.
+    void left(Account account, Side side, Quantity remaining) {
+        if (m_accounts.empty()) return;
+        AccountRisk& a = entry(account);
+        --a.openOrders;
+        open(a, side) -= remaining;
+    }
+    void filled(Side takerSide, Account taker, Account maker, Quantity quantity) {
+        if (m_accounts.empty()) return;
+        const Quantity bought = takerSide == Side::Buy ? quantity : -quantity;
+        entry(taker).position += bought;
+        AccountRisk& m = entry(maker);
+        m.position -= bought;
+        open(m, takerSide == Side::Buy ? Side::Sell : Side::Buy) -= quantity;
+    }
+
+    /// Set `account`'s position outright (snapshot restore).
+    void restorePosition(Account account, Quantity position) {
+        if (!m_accounts.empty()) entry(account).position = position;
+    }
+
+    [[nodiscard]] std::uint32_t openOrders(Account account) const noexcept {
+        const AccountRisk* const a = find(account);
+        return a ? a->openOrders : 0;
+    }
+    [[nodiscard]] Quantity position(Account account) const noexcept {
+        const AccountRisk* const a = find(account);
+        return a ? a->position : 0;
+    }
+    /// Open quantity `account` rests on `side`.
+    [[nodiscard]] Quantity openQuantity(Account account, Side side) const noexcept {
+        const AccountRisk* const a = find(account);
+        return a ? (side == Side::Buy ? a->openBuy : a->openSell) : 0;
+    }
+
+    /// Visit (account, position) for every account holding a slot, flat ones
+    /// included (a slot is kept for the life of the book), in no particular
+    /// order.
+    template <class F>
+    void forEachAccount(F&& fn) const {
+        for (const AccountRisk& a : m_accounts) {
+            if (a.used) fn(a.account, a.position);
+        }
+    }
+
+private:
+    struct AccountRisk {
+        Quantity      position   = 0;
+        Quantity      openBuy    = 0;
+        Quantity      openSell   = 0;
+        Account       account    = kNoAccount;
+        std::uint32_t openOrders = 0;
+        bool          used       = false;
+    };
+
+    [[nodiscard]] static Quantity& open(AccountRisk& a, Side side) noexcept {
+        return side == Side::Buy ? a.openBuy : a.openSell;
+    }
+    /// Index of the account's entry or, if it has none, of the free slot
+    /// where it would go: linear probing from a Fibonacci hash. The table is
+    /// kept at most half full, so probes stay short.
+    [[nodiscard]] std::size_t slotOf(Account account) const noexcept {
+        const std::size_t mask = m_accounts.size() - 1;
+        std::size_t       i    = (account * std::uint64_t{0x9E3779B97F4A7C15} >> 32) & mask;
+        while (m_accounts[i].used && m_accounts[i].account != account) i = (i + 1) & mask;
+        return i;
+    }
+
+    [[nodiscard]] const AccountRisk* find(Account account) const noexcept {
+        if (m_accounts.empty()) return nullptr;
+        const AccountRisk& a = m_accounts[slotOf(account)];
+        return a.used ? &a : nullptr;
+    }
+
+    /// The account's entry, created if new. check() keeps the accounts that
+    /// trade within accountSlots; a restore may bring more, so the table grows.
+    [[nodiscard]] AccountRisk& entry(Account account) {
+        std::size_t i = slotOf(account);
+        if (m_accounts[i].used) return m_accounts[i];
+        if (2 * (m_used + 1) > m_accounts.size()) {
+            grow();
+            i = slotOf(account);
+        }
+        ++m_used;
+        return m_accounts[i] = AccountRisk{.account = account, .used = true};
+    }
+
+    void grow() {
+        std::vector<AccountRisk> old(2 * m_accounts.size());
+        old.swap(m_accounts);
+        for (const AccountRisk& a : old) {
+            if (a.used) m_accounts[slotOf(a.account)] = a;
+        }
+    }
+
+    RiskLimits               m_limits;
+    std::vector<AccountRisk> m_accounts;  // power-of-two size; empty without per-account limits
+    std::size_t              m_used    = 0;
+    bool                     m_enabled = false;
+};
+
+/// One price level as the engine's depth observers report it.
+struct LevelDepth {
+    Price         price;
+    Quantity      quantity;  // total resting quantity
+    std::uint32_t orders;    // resting orders
+    [[nodiscard]] bool operator==(const LevelDepth&) const = default;
+};
+
 template <typename R>
 concept OrderRange = std::ranges::input_range<R> &&
                      std::same_as<std::ranges::range_value_t<R>, Order>;
@@ -100,35 +338,54 @@ concept OrderRange = std::ranges::input_range<R> &&
 // MatchingEngine
 //
 // Price/time-priority limit order book:
-//   - price levels:  std::pmr::map (bids descending, asks ascending)
-//   - level queues:  std::pmr::list, FIFO within a level
-//   - cancel index:  id -> {level iterator, queue iterator} for O(1) cancels
+//   - price levels:  a level-storage policy (see PriceLevels.hpp) — MapLevels
+//                    (std::pmr::map) or LadderLevels (tick-indexed array)
+//   - level queues:  intrusive FIFO of OrderPool slots, linked by 32-bit
+//                    handles; each slot also points back at its level
+//   - cancel index:  flat Robin Hood table id -> slot handle for O(1) cancels
 //
-// All node allocations are served from an unsynchronized_pool_resource owned
-// by the engine, so steady-state submit/cancel traffic recycles fixed-size
-// blocks instead of hitting the global allocator.
+// All allocations are served from an unsynchronized_pool_resource owned by
+// the engine, so steady-state submit/cancel traffic recycles fixed-size
+// blocks (and order slots) instead of hitting the global allocator.
 //
 // Single-threaded by design (the pool resource is unsynchronized). The engine
 // is neither copyable nor movable: its containers hold a pointer to the
 // member arena, which must not be re-seated.
 // ---------------------------------------------------------------------------
 
-class MatchingEngine {
+template <class Levels>
+class BasicMatchingEngine {
 public:
-    explicit MatchingEngine(std::size_t expectedOpenOrders = 1u << 16) {
+    explicit BasicMatchingEngine(std::size_t expectedOpenOrders = 1u << 16, const RiskLimits& risk = {})
+        : m_orders{&m_arena, expectedOpenOrders}, m_risk{risk} {
         m_index.reserve(expectedOpenOrders);
     }
 
-    MatchingEngine(const MatchingEngine&)            = delete;
-    MatchingEngine& operator=(const MatchingEngine&) = delete;
+    BasicMatchingEngine(const BasicMatchingEngine&)            = delete;
+    BasicMatchingEngine& operator=(const BasicMatchingEngine&) = delete;
 
     /**
      * Submit a new order.
      *
      * Matches the incoming order against resting orders on the opposite side
      * (best price first, FIFO within a level), emitting a FillEvent per
-     * execution at the maker's price. Leftover quantity rests in the book.
-     * Emits AckEvent on acceptance or RejectEvent (DuplicateId/BadQuantity).
+     * execution at the maker's price. What is left depends on the order's
+     * type: a limit order rests it; IOC and market orders drop it; a
+     * fill-or-kill order that the book cannot fill in full trades nothing
+     * and is rejected (Killed).
+     * A post-only order rests without matching.
+     *
+     * Self-trade prevention: if the order carries an account and an stp
+     * mode, resting orders of the same account never fill against it;
+     * they are cancelled or decremented as the mode says instead (see
+     * SelfTradePrevention). Each resting order that leaves the book that
+     * way is reported with a CancelAckEvent on this sink; a decrement that
+     * leaves some of it is reported only in its market-data update.
+     *
+     * Emits AckEvent on acceptance or RejectEvent (DuplicateId/BadQuantity,
+     * a RiskLimits breach, WouldCross for a post-only order that would
+     * have traded, Killed for a fill-or-kill order, or SelfTrade, after any fills, when self-trade
+     * prevention cancelled the rest of the order).
      */
     template <EventSink S>
     void submit(const Order& order, S&& sink) {
@@ -140,52 +397,134 @@ public:
             sink(RejectEvent{order.id, RejectReason::BadQuantity});
             return;
         }
-
-        Order incoming = order;  // mutable working copy
-
-        switch (incoming.side) {
-            using enum Side;
-            case Buy:  matchAgainst(m_asks, incoming, sink); break;
-            case Sell: matchAgainst(m_bids, incoming, sink); break;
-            default:   std::unreachable();  // C++23
+        if (m_risk.enabled()) {
+            if (const auto breach = m_risk.check(order, bestBid(), bestAsk())) {
+                sink(RejectEvent{order.id, *breach});
+                return;
+            }
         }
 
-        if (incoming.quantity > 0) {
-            if (incoming.side == Side::Buy) rest(m_bids, incoming);
-            else                            rest(m_asks, incoming);
+        // One switch picks a per-type instantiation; within it every type
+        // check is compile-time, so limit orders run the same code as ever.
+        switch (order.type) {
+            using enum OrderType;
+            case Limit:             submitAs<Limit>(order, sink);             return;
+            case ImmediateOrCancel: submitAs<ImmediateOrCancel>(order, sink); return;
+            case FillOrKill:        submitAs<FillOrKill>(order, sink);        return;
+            case Market:            submitAs<Market>(order, sink);            return;
+            case PostOnly:          submitAs<PostOnly>(order, sink);          return;
         }
-
-        sink(AckEvent{order.id});
+        std::unreachable();  // C++23: decoders only produce valid types
     }
 
-    /// Submit a range of orders (span, vector, array, ...) in sequence.
+    /**
+     * Submit a burst of orders (span, vector, array, ...) as one pipeline.
+     * The outcome is exactly that of submit() per order in sequence, but
+     *   - the id index and order slab are grown once, up front, for the
+     *     whole burst rather than whenever an insert finds them full;
+     *   - each order's index bucket is prefetched a few orders ahead, so its
+     *     duplicate check and insert do not stall on a cache miss.
+     * Pass an EventLog (EventLog.hpp) as `sink` to collect the burst's
+     * events in one contiguous log and hand them on with a single flush().
+     */
     template <OrderRange R, EventSink S>
     void submitBatch(R&& orders, S&& sink) {
-        for (const Order& o : orders) submit(o, sink);
+        if constexpr (std::ranges::sized_range<R>) reserve(openOrders() + std::ranges::size(orders));
+
+        if constexpr (std::ranges::random_access_range<R>) {
+            const auto n     = std::ranges::ssize(orders);
+            const auto first = std::ranges::begin(orders);
+            for (std::ptrdiff_t i = 0; i < std::min(n, kPrefetchDistance); ++i) m_index.prefetch(first[i].id);
+            for (std::ptrdiff_t i = 0; i < n; ++i) {
+                if (i + kPrefetchDistance < n) m_index.prefetch(first[i + kPrefetchDistance].id);
+                submit(first[i], sink);
+            }
+        } else {
+            for (const Order& o : orders) submit(o, sink);
+        }
     }
 
     /**
-     * Cancel a resting order by id in O(1) via the locator index.
+     * Cancel a resting order by id in O(1) via the handle index.
      * Emits CancelAckEvent on success or RejectEvent{UnknownOrder}.
      */
     template <EventSink S>
     void cancel(OrderId id, S&& sink) {
-        const auto it = m_index.find(id);
-        if (it == m_index.end()) {
+        const auto found = m_index.extract(id);
+        if (!found) {
             sink(RejectEvent{id, RejectReason::UnknownOrder});
             return;
         }
 
-        std::visit([this](const auto& loc) {
-            auto& queue = loc.level->second;
-            queue.erase(loc.order);
-            if (queue.empty()) bookFor(loc).erase(loc.level);
-        }, it->second);
-
-        m_index.erase(it);
+        remove(*found, sink);
         sink(CancelAckEvent{id});
     }
 
+    /**
+     * Amend a resting order to `price` and `quantity` (its new open
+     * quantity) in place of a CANCEL + SUBMIT pair.
+     *
+     * A size reduction at the same price keeps the order's queue position.
+     * A size increase sends it to the back of its level; a price change
+     * takes it out of the book and enters it again as a new limit order
+     * would, matching first if the new price crosses. Emits any FillEvents, then
+     * AckEvent; or RejectEvent (UnknownOrder/BadQuantity, or a RiskLimits
+     * breach by the amended order). A re-entered order is subject to
+     * self-trade prevention like a new one, and answered RejectEvent
+     * {SelfTrade} if that cancels it; it no longer rests then.
+     */
+    template <EventSink S>
+    void modify(OrderId id, Price price, Quantity quantity, S&& sink) {
+        const OrderHandle* const found = m_index.find(id);
+        if (!found) {
+            sink(RejectEvent{id, RejectReason::UnknownOrder});
+            return;
+        }
+        if (quantity <= 0) {
+            sink(RejectEvent{id, RejectReason::BadQuantity});
+            return;
+        }
+
+        const OrderHandle h       = *found;
+        Order&            resting = m_orders[h].order;
+        Level&            level   = *m_orders[h].level;
+
+        if (m_risk.enabled()) {
+            const Order amended{.id = id, .side = resting.side, .account = resting.account, .price = price,
+                                .quantity = quantity};
+            if (const auto breach = m_risk.check(amended, bestBid(), bestAsk(), resting.quantity)) {
+                sink(RejectEvent{id, *breach});
+                return;
+            }
+        }
+
+        if (price != resting.price) {
+            const Order replacement{.id = id, .side = resting.side, .stp = resting.stp, .account = resting.account,
+                                    .price = price, .quantity = quantity};
+            m_index.erase(id);
+            remove(h, sink);
+            if (enter(replacement, sink)) {
+                sink(RejectEvent{id, RejectReason::SelfTrade});
+                return;
+            }
+        } else if (quantity != resting.quantity) {
+            level.quantity += quantity - resting.quantity;
+            m_risk.resized(resting.account, resting.side, quantity - resting.quantity);
+            if (quantity > resting.quantity) {  // priority is only kept for reductions
+                m_orders.unlink(level.queue, h);
+                m_orders.pushBack(level.queue, h);
+                publish(sink, OrderUpdateEvent{BookAction::Delete, id, resting.side, price, 0});
+                publish(sink, OrderUpdateEvent{BookAction::Add, id, resting.side, price, quantity});
+            } else {
+                publish(sink, OrderUpdateEvent{BookAction::Modify, id, resting.side, price, quantity});
+            }
+            resting.quantity = quantity;
+            publish(sink, LevelUpdateEvent{resting.side, price, level.quantity});
+        }
+
+        sink(AckEvent{id});
+    }
+
     /// Render the book state as text (debug/diagnostic; not a hot path).
     [[nodiscard]] std::string dump() const {
         std::string out;
@@ -198,39 +537,232 @@ public:
     // --- observers (handy for tests and snapshots) ---
     [[nodiscard]] std::size_t openOrders() const noexcept { return m_index.size(); }
 
+    /// Risk limits and per-account counters (open orders and quantity, position).
+    [[nodiscard]] const RiskGate& risk() const noexcept { return m_risk; }
+
     [[nodiscard]] std::optional<Price> bestBid() const noexcept {
-        if (m_bids.empty()) return std::nullopt;
-        return m_bids.begin()->first;
+        if (const Level* l = m_bids.best()) return l->price;
+        return std::nullopt;
     }
 
     [[nodiscard]] std::optional<Price> bestAsk() const noexcept {
-        if (m_asks.empty()) return std::nullopt;
-        return m_asks.begin()->first;
+        if (const Level* l = m_asks.best()) return l->price;
+        return std::nullopt;
+    }
+
+    /// Total quantity and order count resting at `price` on `side` (zeros
+    /// if none), read off the level's running totals: no queue walk.
+    [[nodiscard]] LevelDepth depthAt(Side side, Price price) const {
+        const Level* const level = side == Side::Buy ? m_bids.find(price) : m_asks.find(price);
+        return level ? LevelDepth{price, level->quantity, level->orders} : LevelDepth{price, 0, 0};
+    }
+
+    /// Copy up to `out.size()` best levels of `side` into `out`, best first;
+    /// returns how many were written. Touches only the levels it reports.
+    std::size_t topLevels(Side side, std::span<LevelDepth> out) const {
+        return side == Side::Buy ? topOf(m_bids, out) : topOf(m_asks, out);
+    }
+
+    // --- bulk state transfer (snapshots) ---
+
+    /// Visit every resting order: bids then asks, each side best level first
+    /// and FIFO within a level — the order restoreLevel() rebuilds from.
+    template <class F>
+    void forEachResting(F&& fn) const {
+        const auto visitSide = [&](const auto& book) {
+            book.forEach([&](const Level& level) { m_orders.forEach(level.queue, fn); });
+        };
+        visitSide(m_bids);
+        visitSide(m_asks);
+    }
+
+    /// Set an account's position in the risk counters (snapshot restore);
+    /// no-op without a per-account limit.
+    void restorePosition(Account account, Quantity position) { m_risk.restorePosition(account, position); }
+
+    /// Presize the order slab and id index for `orders` resting orders
+    /// (never shrinks either).
+    void reserve(std::size_t orders) {
+        m_orders.reserve(orders);
+        m_index.reserve(orders);
+    }
+
+    /**
+     * Append `orders` to the back of their level's FIFO as-is: no matching,
+     * no events. Bulk restore from a snapshot, one level per call.
+     *
+     * The orders must share one side and price, none may be resting (or
+     * repeat an id), every quantity must be positive, and the level must not
+     * cross the opposite side. Returns false at the first order that breaks
+     * one of these, leaving the orders before it restored.
+     */
+    template <OrderRange R>
+    [[nodiscard]] bool restoreLevel(R&& orders) {
+        // Ids within a level are in arrival order, not id order, so their
+        // index buckets are scattered: prefetch a few inserts ahead.
+        if constexpr (std::ranges::random_access_range<R>) {
+            const auto n = std::ranges::ssize(orders);
+            for (std::ptrdiff_t i = 0; i < std::min(n, kPrefetchDistance); ++i)
+                m_index.prefetch(std::ranges::begin(orders)[i].id);
+        }
+
+        Level*         level = nullptr;
+        Side           side  = Side::Buy;
+        std::ptrdiff_t i     = 0;
+        for (const Order& o : orders) {
+            if constexpr (std::ranges::random_access_range<R>) {
+                if (i + kPrefetchDistance < std::ranges::ssize(orders))
+                    m_index.prefetch(std::ranges::begin(orders)[i + kPrefetchDistance].id);
+                ++i;
+            }
+            if (o.quantity <= 0 || m_index.contains(o.id)) return false;
+            if (!level) {  // checked before the level exists, so a refusal leaves none empty
+                if (o.side == Side::Buy ? crosses(m_asks, o.price) : crosses(m_bids, o.price)) return false;
+                side  = o.side;
+                level = side == Side::Buy ? &m_bids.level(o.price) : &m_asks.level(o.price);
+            } else if (o.side != side || o.price != level->price) {
+                return false;
+            }
+            const OrderHandle h = m_orders.acquire(o, level);
+            m_orders.pushBack(level->queue, h);
+            m_index.insert(o.id, h);
+            level->quantity += o.quantity;
+            ++level->orders;
+            m_risk.rested(o.account, o.side, o.quantity);
+        }
+        return true;
     }
 
 private:
-    using LevelQueue = std::pmr::list<Order>;
+    using BidBook = typename Levels::template Book<Side::Buy>;   // best() = highest bid
+    using AskBook = typename Levels::template Book<Side::Sell>;  // best() = lowest ask
+    using Level   = PriceLevel;
+
+    /// How many orders ahead bulk paths prefetch index buckets.
+    static constexpr std::ptrdiff_t kPrefetchDistance = 8;
+
+    template <OrderType Type, EventSink S>
+    void submitAs(const Order& order, S& sink) {
+        if constexpr (Type == OrderType::FillOrKill) {
+            const bool fillable = order.side == Side::Buy ? canFill(m_asks, order) : canFill(m_bids, order);
+            if (!fillable) {
+                sink(RejectEvent{order.id, RejectReason::Killed});
+                return;
+            }
+        } else if constexpr (Type == OrderType::PostOnly) {
+            const bool wouldCross = order.side == Side::Buy ? crosses(m_asks, order.price)
+                                                            : crosses(m_bids, order.price);
+            if (wouldCross) {
+                sink(RejectEvent{order.id, RejectReason::WouldCross});
+                return;
+            }
+        }
+        if (enter<Type>(order, sink)) sink(RejectEvent{order.id, RejectReason::SelfTrade});
+        else                          sink(AckEvent{order.id});
+    }
 
-    template <class Compare>
-    using BookOf = std::pmr::map<Price, LevelQueue, Compare>;
+    /// Match a new order against the opposite side, then rest what is left
+    /// if its type allows (limit and post-only orders). Returns whether
+    /// self-trade prevention cancelled what was left instead.
+    template <OrderType Type = OrderType::Limit, EventSink S>
+    bool enter(Order incoming, S& sink) {
+        bool selfTraded = false;
+        if constexpr (Type != OrderType::PostOnly) {  // checked not to cross
+            switch (incoming.side) {
+                using enum Side;
+                case Buy:  selfTraded = matchAgainst<Type != OrderType::Market>(m_asks, incoming, sink); break;
+                case Sell: selfTraded = matchAgainst<Type != OrderType::Market>(m_bids, incoming, sink); break;
+                default:   std::unreachable();  // C++23
+            }
+        }
 
-    using BidBook = BookOf<std::greater<>>;  // begin() = highest bid
-    using AskBook = BookOf<std::less<>>;     // begin() = lowest ask
+        if constexpr (Type == OrderType::Limit || Type == OrderType::PostOnly) {
+            if (incoming.quantity > 0) {
+                if (incoming.side == Side::Buy) rest(m_bids, incoming, sink);
+                else                            rest(m_asks, incoming, sink);
+            }
+        }
+        return selfTraded;
+    }
 
-    /// Where an order lives: its price level and its slot in the FIFO queue.
+    /// Whether an order at `price` would trade against `book` on arrival.
     template <class BookT>
-    struct Locator {
-        typename BookT::iterator level;
-        LevelQueue::iterator     order;
-    };
+    [[nodiscard]] static bool crosses(const BookT& book, Price price) noexcept {
+        const Level* const best = book.best();
+        return best && !typename BookT::key_compare{}(price, best->price);
+    }
+
+    /// Whether `book` holds the order's whole quantity at its price or
+    /// better — read off the level aggregates, best level first, without
+    /// touching orders. Under self-trade prevention, orders of its own
+    /// account cannot fill it, so those levels are walked order by order.
+    template <class BookT>
+    [[nodiscard]] bool canFill(const BookT& book, const Order& order) const {
+        const typename BookT::key_compare sortsBefore{};
+        const bool preventing = preventsSelfTrade(order);
+        Quantity available = 0;
+        book.forEachWhile([&](const Level& level) {
+            if (sortsBefore(order.price, level.price)) return false;  // not crossed
+            if (!preventing) {
+                available += level.quantity;
+                return available < order.quantity;
+            }
+            return m_orders.forEachWhile(level.queue, [&](const Order& resting) {
+                if (resting.account != order.account)                  available += resting.quantity;
+                else if (order.stp != SelfTradePrevention::CancelOldest) return false;  // matching ends here
+                return available < order.quantity;
+            });
+        });
+        return available >= order.quantity;
+    }
 
-    using OrderLocator = std::variant<Locator<BidBook>, Locator<AskBook>>;
+    template <class BookT>
+    [[nodiscard]] static std::size_t topOf(const BookT& book, std::span<LevelDepth> out) {
+        std::size_t n = 0;
+        if (out.empty()) return 0;
+        book.forEachWhile([&](const Level& level) {
+            out[n++] = LevelDepth{level.price, level.quantity, level.orders};
+            return n < out.size();
+        });
+        return n;
+    }
 
-    [[nodiscard]] BidBook& bookFor(const Locator<BidBook>&) noexcept { return m_bids; }
-    [[nodiscard]] AskBook& bookFor(const Locator<AskBook>&) noexcept { return m_asks; }
+    [[nodiscard]] static bool preventsSelfTrade(const Order& order) noexcept {
+        return order.account != kNoAccount && order.stp != SelfTradePrevention::None;
+    }
+
+    /// Take a resting order out of its level (the caller has already
+    /// dropped it from the index), erasing the level if it empties.
+    template <EventSink S>
+    void remove(OrderHandle h, S& sink) {
+        const OrderSlot& slot  = m_orders[h];
+        Level&           level = *slot.level;
+        const Side       side  = slot.order.side;
+
+        level.quantity -= slot.order.quantity;
+        --level.orders;
+        m_risk.left(slot.order.account, side, slot.order.quantity);
+        publish(sink, OrderUpdateEvent{BookAction::Delete, slot.order.id, side, level.price, 0});
+        publish(sink, LevelUpdateEvent{side, level.price, level.quantity});
+
+        m_orders.unlink(level.queue, h);
+        m_orders.release(h);
+        if (level.queue.empty()) {
+            if (side == Side::Buy) m_bids.erase(level);
+            else                   m_asks.erase(level);
+        }
+    }
 
     /**
-     * Match `incoming` against the opposite book, best level first.
+     * Match `incoming` against the opposite book, best level first — down
+     * to its limit price if `PriceLimited`, else (market orders) until it
+     * is filled or the book is empty.
+     *
+     * A resting order of the incoming order's own account does not fill
+     * under self-trade prevention; selfTrade() settles it instead, and a
+     * CancelAckEvent reports it if it leaves the book. Returns whether that
+     * left the incoming order with nothing. The account check reads the
+     * resting order the fill would read anyway.
      *
      * Works for both sides through the book's own ordering predicate: a book
      * orders its levels best-first, so the incoming order crosses the best
@@ -239,62 +771,146 @@ private:
      *   asks (less):    stop when incoming.price <  best ask
      *   bids (greater): stop when incoming.price >  best bid
      */
-    template <class BookT, EventSink S>
-    void matchAgainst(BookT& book, Order& incoming, S&& sink) {
-        const typename BookT::key_compare sortsBefore{};
-
-        while (incoming.quantity > 0 && !book.empty()) {
-            const auto  levelIt = book.begin();
-            const Price levelPx = levelIt->first;
-            if (sortsBefore(incoming.price, levelPx)) break;  // best level not crossed
-
-            auto& queue = levelIt->second;
-            for (auto it = queue.begin(); incoming.quantity > 0 && it != queue.end();) {
-                Order& resting = *it;
-                const Quantity traded = std::min(incoming.quantity, resting.quantity);
+    template <bool PriceLimited, class BookT, EventSink S>
+    bool matchAgainst(BookT& book, Order& incoming, S&& sink) {
+        [[maybe_unused]] const typename BookT::key_compare sortsBefore{};
+        const Side bookSide   = incoming.side == Side::Buy ? Side::Sell : Side::Buy;
+        const bool preventing = preventsSelfTrade(incoming);
+        bool       selfTraded = false;
+
+        while (incoming.quantity > 0) {
+            Level* const level = book.best();
+            if (!level) break;
+            const Price levelPx = level->price;
+            if constexpr (PriceLimited) {
+                if (sortsBefore(incoming.price, levelPx)) break;  // best level not crossed
+            }
 
-                incoming.quantity -= traded;
-                resting.quantity  -= traded;
+            // FIFO: every fill but the last consumes the head order outright,
+            // so the walk only ever pops from the front of the queue.
+            auto& queue = level->queue;
+            const Quantity before = level->quantity;
+            while (incoming.quantity > 0 && !queue.empty()) {
+                const OrderHandle h = queue.head;
+                Order& resting = m_orders[h].order;
+
+                Quantity taken;  // off the resting order
+                bool     settled = false;
+                if (preventing && resting.account == incoming.account) [[unlikely]] {
+                    taken      = selfTrade(incoming, resting);
+                    selfTraded = incoming.quantity == 0;
+                    if (taken == 0) break;  // cancelled the incoming order only
+                    settled = true;
+                    m_risk.resized(resting.account, bookSide, -taken);
+                } else {
+                    taken = std::min(incoming.quantity, resting.quantity);
+                    incoming.quantity -= taken;
+                    m_risk.filled(incoming.side, incoming.account, resting.account, taken);
+                    sink(FillEvent{incoming.id, resting.id, levelPx, taken});
+                }
+                resting.quantity -= taken;
+                level->quantity  -= taken;
 
-                sink(FillEvent{incoming.id, resting.id, levelPx, traded});
+                publish(sink, OrderUpdateEvent{resting.quantity == 0 ? BookAction::Delete : BookAction::Modify,
+                                               resting.id, bookSide, levelPx, resting.quantity});
 
                 if (resting.quantity == 0) {
-                    m_index.erase(resting.id);  // erase index BEFORE the node it points at
-                    it = queue.erase(it);
-                } else {
-                    ++it;
+                    const OrderId id = resting.id;
+                    --level->orders;
+                    m_risk.left(resting.account, bookSide, 0);
+                    m_index.erase(id);
+                    m_orders.unlink(queue, h);
+                    m_orders.release(h);
+                    if (settled) sink(CancelAckEvent{id});
                 }
             }
 
-            if (queue.empty()) book.erase(levelIt);
+            if (level->quantity != before) publish(sink, LevelUpdateEvent{bookSide, levelPx, level->quantity});
+            if (queue.empty()) book.erase(*level);
         }
+        return selfTraded;
+    }
+
+    /// Settle `incoming` meeting `resting` of its own account per the
+    /// incoming order's stp mode: cut `incoming` and return how much to take
+    /// off `resting` (0: leave it be).
+    [[nodiscard]] static Quantity selfTrade(Order& incoming, const Order& resting) noexcept {
+        switch (incoming.stp) {
+            using enum SelfTradePrevention;
+            case CancelNewest:
+                incoming.quantity = 0;
+                return 0;
+            case CancelOldest:
+                return resting.quantity;
+            case CancelBoth:
+                incoming.quantity = 0;
+                return resting.quantity;
+            case Decrement: {
+                const Quantity overlap = std::min(incoming.quantity, resting.quantity);
+                incoming.quantity -= overlap;
+                return overlap;
+            }
+            case None:
+                break;
+        }
+        std::unreachable();  // C++23: only called with prevention on
     }
 
     /// Insert leftover quantity as a resting order and record its locator.
-    template <class BookT>
-    void rest(BookT& book, const Order& order) {
-        const auto levelIt = book.try_emplace(order.price).first;
-        auto& queue = levelIt->second;  // pmr propagates: queue allocates from m_arena
-        queue.push_back(order);
-        m_index.emplace(order.id, Locator<BookT>{levelIt, std::prev(queue.end())});
+    template <class BookT, EventSink S>
+    void rest(BookT& book, Order order, S& sink) {
+        if (book.drifted()) {
+            book.recenter([this](Level& moved) {
+                for (OrderHandle h = moved.queue.head; h != kNullOrder; h = m_orders[h].next)
+                    m_orders[h].level = &moved;
+            });
+        }
+        Level& level = book.level(order.price);
+        const OrderHandle h = m_orders.acquire(order, &level);
+        m_orders.pushBack(level.queue, h);
+        m_index.insert(order.id, h);
+        level.quantity += order.quantity;
+        ++level.orders;
+        m_risk.rested(order.account, order.side, order.quantity);
+
+        publish(sink, OrderUpdateEvent{BookAction::Add, order.id, order.side, order.price, order.quantity});
+        publish(sink, LevelUpdateEvent{order.side, order.price, level.quantity});
+    }
+
+    /// Deliver a market-data event to sinks that take them.
+    template <class S, class E>
+    static void publish(S& sink, const E& event) {
+        if constexpr (MarketDataSink<S>) sink(event);
     }
 
     template <class BookT>
-    static void dumpSide(std::string& out, std::string_view header, const BookT& book) {
+    void dumpSide(std::string& out, std::string_view header, const BookT& book) const {
         out += header;
-        for (const auto& [price, queue] : book) {
-            std::format_to(std::back_inserter(out), "{}: ", price);
-            for (const Order& o : queue) {
+        book.forEach([&](const Level& level) {
+            std::format_to(std::back_inserter(out), "{}: ", level.price);
+            m_orders.forEach(level.queue, [&out](const Order& o) {
                 std::format_to(std::back_inserter(out), "{}({}) ", o.id, o.quantity);
-            }
+            });
             out += '\n';
-        }
+        });
     }
 
     // Arena must be declared before (and thus destroyed after) the containers.
     std::pmr::unsynchronized_pool_resource m_arena{};
 
-    BidBook m_bids{&m_arena};
-    AskBook m_asks{&m_arena};
-    std::pmr::unordered_map<OrderId, OrderLocator> m_index{&m_arena};
+    OrderPool m_orders;  // resting-order slots; level queues link through them
+    BidBook   m_bids{&m_arena};
+    AskBook   m_asks{&m_arena};
+    OrderIndex m_index{&m_arena};
+    RiskGate   m_risk;
 };
+
+// Level storage is chosen at compile time: -DMATCHING_ENGINE_LADDER_BOOK (CMake
+// option ENABLE_LADDER_BOOK) makes the tick-indexed ladder the default book.
+#ifdef MATCHING_ENGINE_LADDER_BOOK
+using DefaultLevels = LadderLevels<>;
+#else
+using DefaultLevels = MapLevels;
+#endif
+
+using MatchingEngine = BasicMatchingEngine<DefaultLevels>;
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+// ---------------------------------------------------------------------------
+// Core domain types
+// ---------------------------------------------------------------------------
+
+using OrderId  = std::int64_t;
+using Price    = std::int64_t;
+using Quantity = std::int64_t;
+
+enum class Side : std::uint8_t { Buy, Sell };
+
+[[nodiscard]] constexpr std::string_view side_label(Side s) noexcept {
+    constexpr std::array labels{std::string_view{"BUY"}, std::string_view{"SELL"}};
+    return labels[std::to_underlying(s)];  // C++23: std::to_underlying
+}
+static_assert(side_label(Side::Buy)  == "BUY",  "side_label: Buy  label mismatch");
+static_assert(side_label(Side::Sell) == "SELL", "side_label: Sell label mismatch");
+
+/// How an order treats quantity it cannot trade on arrival.
+enum class OrderType : std::uint8_t {
+    Limit,              // rests the remainder
+    ImmediateOrCancel,  // trades what it can at its price or better; cancels the rest
+    FillOrKill,         // trades its whole quantity at once, or nothing
+    Market,             // IOC at any price; `price` is ignored
+    PostOnly,           // rests without trading; rejected if it would cross
+};
+
+/// Owner of an order, for self-trade prevention. kNoAccount opts out.
+using Account = std::uint32_t;
+inline constexpr Account kNoAccount = 0;
+
+/// What an incoming order does on meeting a resting order of its own
+/// account. Only the incoming (newest) order's mode applies.
+enum class SelfTradePrevention : std::uint8_t {
+    None,          // trade with it as with anyone else
+    CancelNewest,  // cancel the incoming order's remainder; the resting order stays
+    CancelOldest,  // cancel the resting order and keep matching
+    CancelBoth,    // cancel both
+    Decrement,     // reduce both by the smaller quantity, without a fill, and keep matching
+};
+
+struct Order {
+    OrderId             id;
+    Side                side;
+    // type, stp and account sit in what would be padding: Order stays 32 bytes
+    OrderType           type    = OrderType::Limit;
+    SelfTradePrevention stp     = SelfTradePrevention::None;
+    Account             account = kNoAccount;
+    Price               price;
+    Quantity            quantity;
+
+    [[nodiscard]] bool operator==(const Order&) const = default;
+};
+static_assert(sizeof(Order) == 32);
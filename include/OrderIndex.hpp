@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Order.hpp"
+#include "OrderPool.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// OrderIndex
+//
+// Flat open-addressing map OrderId -> OrderHandle using Robin Hood linear
+// probing. Every slot is 16 bytes (four per cache line) and lives in one
+// contiguous array, so a lookup is a hash, one likely-cached line and a short
+// linear scan — no node allocation, no pointer chase.
+//
+// Each occupied slot records its probe distance from its home bucket. Insert
+// displaces any slot that is closer to home than the incoming key ("takes
+// from the rich"), which bounds probe-length variance and lets a miss stop as
+// soon as it passes a slot closer to home than the probe. Deletion shifts the
+// following run back by one instead of leaving a tombstone, so the table never
+// degrades under submit/cancel churn and never needs a cleanup rehash.
+//
+// The hash keeps the id's low bits as the bucket and folds the bits above the
+// table size in through a Fibonacci multiply. Gateways mostly hand out
+// sequential ids, which therefore land in adjacent buckets with no
+// collisions — a cancel sweep walks the table almost linearly — while ids a
+// multiple of the capacity apart are still scattered.
+// ---------------------------------------------------------------------------
+
+class OrderIndex {
+public:
+    explicit OrderIndex(std::pmr::memory_resource* mr) : m_slots{mr} {}
+
+    /// Size the table so `n` ids fit without rehashing.
+    void reserve(std::size_t n) {
+        std::size_t cap = kMinCapacity;
+        while (cap - cap / 8 < n) cap *= 2;
+        if (cap > m_slots.size()) rehash(cap);
+    }
+
+    [[nodiscard]] std::size_t size()  const noexcept { return m_size; }
+    [[nodiscard]] bool        empty() const noexcept { return m_size == 0; }
+
+    [[nodiscard]] bool contains(OrderId id) const noexcept { return find(id) != nullptr; }
+
+    [[nodiscard]] const OrderHandle* find(OrderId id) const noexcept {
+        if (m_slots.empty()) return nullptr;
+        std::size_t   i    = home(id);
+        std::uint32_t dist = 1;
+        for (;; i = (i + 1) & m_mask, ++dist) {
+            const Slot& s = m_slots[i];
+            if (s.dist < dist) return nullptr;  // empty, or richer than us: absent
+            if (s.key == id)   return &s.value;
+        }
+    }
+
+    /// Pull `id`'s home bucket toward the cache ahead of an insert or
+    /// lookup; for bulk loads that would otherwise miss on every id.
+    void prefetch(OrderId id) const noexcept {
+        if (!m_slots.empty()) __builtin_prefetch(&m_slots[home(id)], 1);
+    }
+
+    /// Insert a new mapping. Precondition: `id` is not present.
+    void insert(OrderId id, OrderHandle h) {
+        if (m_size + 1 > m_slots.size() - m_slots.size() / 8)
+            rehash(m_slots.empty() ? kMinCapacity : m_slots.size() * 2);
+
+        Slot carry{id, h, 1};
+        for (std::size_t i = home(id);; i = (i + 1) & m_mask, ++carry.dist) {
+            Slot& s = m_slots[i];
+            if (s.dist == 0) {
+                s = carry;
+                ++m_size;
+                return;
+            }
+            if (s.dist < carry.dist) std::swap(s, carry);
+        }
+    }
+
+    /// Remove `id` and return its handle, in a single probe sequence.
+    [[nodiscard]] std::optional<OrderHandle> extract(OrderId id) noexcept {
+        if (m_slots.empty()) return std::nullopt;
+        std::size_t   i    = home(id);
+        std::uint32_t dist = 1;
+        for (;; i = (i + 1) & m_mask, ++dist) {
+            const Slot& s = m_slots[i];
+            if (s.dist < dist) return std::nullopt;
+            if (s.key == id)   break;
+        }
+
+        const OrderHandle h = m_slots[i].value;
+        // Backward-shift: pull each displaced successor one step toward home.
+        for (;;) {
+            const std::size_t next = (i + 1) & m_mask;
+            if (m_slots[next].dist <= 1) break;  // empty or already at home
+            m_slots[i] = m_slots[next];
+            --m_slots[i].dist;
+            i = next;
+        }
+        m_slots[i].dist = 0;
+        --m_size;
+        return h;
+    }
+
+    bool erase(OrderId id) noexcept { return extract(id).has_value(); }
+
+private:
+    static constexpr std::size_t kMinCapacity = 16;
+
+    struct Slot {
+        OrderId       key;
+        OrderHandle   value;
+        std::uint32_t dist;  // 0 = empty, else probe distance from home + 1
+    };
+    static_assert(sizeof(Slot) == 16);
+
+    [[nodiscard]] std::size_t home(OrderId id) const noexcept {
+        const auto x = static_cast<std::uint64_t>(id);
+        return static_cast<std::size_t>(x ^ ((x >> m_bits) * 0x9E3779B97F4A7C15ull)) & m_mask;
+    }
+
+    void rehash(std::size_t cap) {
+        std::pmr::vector<Slot> old{cap, Slot{}, m_slots.get_allocator()};
+        old.swap(m_slots);
+        m_mask  = cap - 1;
+        m_bits  = static_cast<unsigned>(std::countr_zero(cap));
+        m_size  = 0;
+        for (const Slot& s : old)
+            if (s.dist != 0) insert(s.key, s.value);
+    }
+
+    std::pmr::vector<Slot> m_slots;
+    std::size_t            m_mask  = 0;
+    unsigned               m_bits  = 0;
+    std::size_t            m_size  = 0;
+};
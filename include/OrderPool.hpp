@@ -0,0 +1,140 @@
+#pragma once
+
+#include "Order.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Order slab
+//
+// Resting orders live in fixed-size slots carved out of large blocks drawn
+// from the engine arena. A slot is addressed by a 32-bit handle (block index
+// in the high bits, offset in the low bits), so the id index and the FIFO
+// links between orders are 4 bytes each instead of 8-byte pointers, and a
+// slot never moves once allocated. Released slots go onto an intrusive free
+// list threaded through their `next` links and are reused LIFO, which keeps
+// the most recently touched (cache-warm) slots in circulation.
+// ---------------------------------------------------------------------------
+
+struct PriceLevel;
+
+using OrderHandle = std::uint32_t;
+inline constexpr OrderHandle kNullOrder = ~OrderHandle{0};
+
+/// One resting order plus its intrusive FIFO links and owning level.
+struct OrderSlot {
+    Order       order;
+    PriceLevel* level;
+    OrderHandle prev;
+    OrderHandle next;
+};
+
+/// Head/tail of an intrusive doubly-linked FIFO of slots.
+struct LevelQueue {
+    OrderHandle head = kNullOrder;
+    OrderHandle tail = kNullOrder;
+
+    [[nodiscard]] bool empty() const noexcept { return head == kNullOrder; }
+};
+
+class OrderPool {
+public:
+    static constexpr unsigned    kBlockBits = 12;
+    static constexpr std::size_t kBlockSize = std::size_t{1} << kBlockBits;
+
+    explicit OrderPool(std::pmr::memory_resource* mr, std::size_t expectedOrders = 0)
+        : m_blocks{mr}, m_mr{mr} {
+        reserve(expectedOrders);
+    }
+
+    ~OrderPool() {
+        for (OrderSlot* block : m_blocks)
+            m_mr->deallocate(block, kBlockSize * sizeof(OrderSlot), alignof(OrderSlot));
+    }
+
+    OrderPool(const OrderPool&)            = delete;
+    OrderPool& operator=(const OrderPool&) = delete;
+
+    [[nodiscard]] OrderSlot& operator[](OrderHandle h) noexcept {
+        return m_blocks[h >> kBlockBits][h & (kBlockSize - 1)];
+    }
+    [[nodiscard]] const OrderSlot& operator[](OrderHandle h) const noexcept {
+        return m_blocks[h >> kBlockBits][h & (kBlockSize - 1)];
+    }
+
+    /// Take a slot for `order` owned by `level`; links are left unset.
+    [[nodiscard]] OrderHandle acquire(const Order& order, PriceLevel* level) {
+        if (m_free == kNullOrder) {
+            if (m_used == capacity()) grow();
+            const auto h = static_cast<OrderHandle>(m_used++);
+            (*this)[h] = OrderSlot{order, level, kNullOrder, kNullOrder};
+            return h;
+        }
+        const OrderHandle h = m_free;
+        OrderSlot& slot = (*this)[h];
+        m_free = slot.next;
+        slot = OrderSlot{order, level, kNullOrder, kNullOrder};
+        return h;
+    }
+
+    void release(OrderHandle h) noexcept {
+        (*this)[h].next = m_free;
+        m_free = h;
+    }
+
+    // --- intrusive FIFO operations ---
+
+    void pushBack(LevelQueue& q, OrderHandle h) noexcept {
+        OrderSlot& slot = (*this)[h];
+        slot.prev = q.tail;
+        slot.next = kNullOrder;
+        if (q.tail == kNullOrder) q.head = h;
+        else                      (*this)[q.tail].next = h;
+        q.tail = h;
+    }
+
+    void unlink(LevelQueue& q, OrderHandle h) noexcept {
+        const OrderSlot& slot = (*this)[h];
+        if (slot.prev == kNullOrder) q.head = slot.next;
+        else                         (*this)[slot.prev].next = slot.next;
+        if (slot.next == kNullOrder) q.tail = slot.prev;
+        else                         (*this)[slot.next].prev = slot.prev;
+    }
+
+    /// Visit the orders of `q` front to back.
+    template <class F>
+    void forEach(const LevelQueue& q, F&& fn) const {
+        for (OrderHandle h = q.head; h != kNullOrder; h = (*this)[h].next) fn((*this)[h].order);
+    }
+
+    /// Visit the orders of `q` front to back while `fn` returns true;
+    /// returns false if it stopped early.
+    template <class F>
+    bool forEachWhile(const LevelQueue& q, F&& fn) const {
+        for (OrderHandle h = q.head; h != kNullOrder; h = (*this)[h].next) {
+            if (!fn((*this)[h].order)) return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return m_blocks.size() * kBlockSize; }
+
+    /// Grow (never shrink) to at least `orders` slots.
+    void reserve(std::size_t orders) {
+        while (capacity() < orders) grow();
+    }
+
+private:
+    void grow() {
+        void* raw = m_mr->allocate(kBlockSize * sizeof(OrderSlot), alignof(OrderSlot));
+        m_blocks.push_back(static_cast<OrderSlot*>(raw));
+    }
+
+    std::pmr::vector<OrderSlot*> m_blocks;
+    std::pmr::memory_resource*   m_mr;
+    std::size_t                  m_used = 0;           // slots ever handed out
+    OrderHandle                  m_free = kNullOrder;  // free-list head
+};
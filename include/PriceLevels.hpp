@@ -0,0 +1,334 @@
+#pragma once
+
+#include "Order.hpp"
+#include "OrderPool.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Price levels
+//
+// One side of the book is a set of price levels ordered best-first, each
+// holding a FIFO queue of resting orders. The engine only needs a handful of
+// operations on a side, so the level storage is a policy:
+//
+//   best()          best non-empty level, or nullptr
+//   level(px)       level at px, created empty if absent
+//   find(px)        level at px, or nullptr — a read-only lookup
+//   erase(level)    drop a level whose queue has just emptied
+//   forEach(fn)     visit levels best-first (dump, diagnostics)
+//   forEachWhile(fn) ...until fn returns false; false if it stopped early
+//   drifted()       true when the storage wants recenter() before the next
+//                   level() call
+//   recenter(fn)    re-lay levels around the touch, calling fn(level) for
+//                   each level that moved so its orders can be re-pointed
+//
+// Two implementations are provided:
+//   MapBook     std::pmr::map keyed by price — unbounded, O(log n) per level
+//   LadderBook  contiguous tick-indexed array around an anchor price with an
+//               occupancy bitmap and a best-price cursor; prices outside the
+//               band fall back to a MapBook
+//
+// Level addresses are stable for as long as the level exists (map nodes never
+// move; the ladder array is sized once) or until recenter() reports it
+// moved, so the engine can hold Level* locators directly.
+// ---------------------------------------------------------------------------
+
+/// A price, the intrusive FIFO (in the engine's OrderPool) resting at it, and
+/// the FIFO's total quantity and length, which the engine keeps current as
+/// it changes.
+struct PriceLevel {
+    explicit PriceLevel(Price px) noexcept : price{px} {}
+
+    Price         price;
+    LevelQueue    queue;
+    Quantity      quantity = 0;  // both back to 0 whenever the queue empties
+    std::uint32_t orders   = 0;
+};
+
+/// Level ordering for a side: bids best = highest, asks best = lowest.
+template <Side S>
+using LevelCompare = std::conditional_t<S == Side::Buy, std::greater<>, std::less<>>;
+
+template <Side S>
+class MapBook {
+public:
+    using Level       = PriceLevel;
+    using key_compare = LevelCompare<S>;
+
+    explicit MapBook(std::pmr::memory_resource* mr) : m_levels{mr} {}
+
+    [[nodiscard]] bool empty() const noexcept { return m_levels.empty(); }
+
+    [[nodiscard]] Level* best() noexcept {
+        return m_levels.empty() ? nullptr : &m_levels.begin()->second;
+    }
+    [[nodiscard]] const Level* best() const noexcept {
+        return m_levels.empty() ? nullptr : &m_levels.begin()->second;
+    }
+
+    [[nodiscard]] Level& level(Price px) {
+        return m_levels.try_emplace(px, px).first->second;
+    }
+
+    [[nodiscard]] const Level* find(Price px) const {
+        const auto it = m_levels.find(px);
+        return it == m_levels.end() ? nullptr : &it->second;
+    }
+
+    void erase(const Level& lvl) { m_levels.erase(lvl.price); }
+
+    [[nodiscard]] bool drifted() const noexcept { return false; }
+
+    template <class F>
+    void recenter(F&&) noexcept {}
+
+    template <class F>
+    void forEach(F&& fn) const {
+        for (const auto& entry : m_levels) fn(entry.second);
+    }
+
+    template <class F>
+    bool forEachWhile(F&& fn) const {
+        for (const auto& entry : m_levels)
+            if (!fn(entry.second)) return false;
+        return true;
+    }
+
+private:
+    std::pmr::map<Price, Level, key_compare> m_levels;
+};
+
+/**
+ * Tick-indexed ladder of `Ticks` levels covering [base, base + Ticks).
+ *
+ * The band is anchored around the first price rested on an empty side (and
+ * re-anchored whenever the side empties again), so it follows the touch
+ * across quiet periods. A book that drifts while old orders keep it
+ * non-empty would otherwise push every new level into the overflow map, so
+ * level() counts overflow hits and, once kRecenterAfter of them have
+ * landed while the touch is outside the band, drifted() asks for a
+ * recenter() that re-anchors the band on the touch, moving levels between
+ * the ladder and the overflow map. In-band levels are found by index; a
+ * bitmap marks non-empty slots so the best-price cursor can skip runs of
+ * empty levels a word at a time. Out-of-band prices live in an overflow
+ * MapBook; since they are all strictly outside the band, each one is either
+ * better than every in-band level or worse than all of them.
+ */
+template <Side S, std::size_t Ticks>
+class LadderBook {
+    static_assert(Ticks > 0 && Ticks % 64 == 0, "LadderBook: Ticks must be a positive multiple of 64");
+
+public:
+    using Level       = PriceLevel;
+    using key_compare = LevelCompare<S>;
+
+    explicit LadderBook(std::pmr::memory_resource* mr) : m_ladder{mr}, m_overflow{mr} {
+        m_ladder.reserve(Ticks);
+        for (std::size_t i = 0; i < Ticks; ++i) m_ladder.emplace_back(Price{0});
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return m_inBand == 0 && m_overflow.empty(); }
+
+    [[nodiscard]] Level* best() noexcept {
+        return const_cast<Level*>(std::as_const(*this).best());
+    }
+    [[nodiscard]] const Level* best() const noexcept {
+        const Level* ladderBest = m_inBand ? &m_ladder[m_best] : nullptr;
+        const Level* spillBest  = m_overflow.best();
+        if (!spillBest) return ladderBest;
+        if (!ladderBest || key_compare{}(spillBest->price, ladderBest->price)) return spillBest;
+        return ladderBest;
+    }
+
+    [[nodiscard]] Level& level(Price px) {
+        if (empty()) {
+            m_base         = px - static_cast<Price>(Ticks / 2);
+            m_overflowHits = 0;
+        }
+
+        const std::size_t idx = slot(px);
+        if (idx >= Ticks) {
+            ++m_overflowHits;
+            return m_overflow.level(px);
+        }
+
+        Level& lvl = m_ladder[idx];
+        if (!test(idx)) {
+            lvl.price = px;
+            set(idx);
+            if (m_inBand++ == 0 || better(idx, m_best)) m_best = idx;
+        }
+        return lvl;
+    }
+
+    [[nodiscard]] const Level* find(Price px) const {
+        const std::size_t idx = slot(px);
+        if (idx >= Ticks) return m_overflow.find(px);
+        return test(idx) ? &m_ladder[idx] : nullptr;
+    }
+
+    void erase(const Level& lvl) {
+        const std::size_t idx = slot(lvl.price);
+        if (idx >= Ticks) {
+            m_overflow.erase(lvl);
+            return;
+        }
+        clear(idx);
+        if (--m_inBand != 0 && idx == m_best) m_best = nextWorse(idx);
+    }
+
+    [[nodiscard]] bool drifted() const noexcept {
+        if (m_overflowHits < kRecenterAfter) return false;
+        const Level* touch = best();
+        return touch && slot(touch->price) >= Ticks;
+    }
+
+    /// Re-anchor the band around the touch: in-band levels that fall outside
+    /// the new band move to the overflow map and overflow levels inside it
+    /// move onto the ladder. `moved(level)` is called at each level's new
+    /// address. O(levels moved + in-band levels); rare by construction.
+    template <class F>
+    void recenter(F&& moved) {
+        const Level* touch = best();
+        if (!touch) return;
+        const Price base = touch->price - static_cast<Price>(Ticks / 2);
+
+        std::pmr::vector<Level> held{m_ladder.get_allocator()};
+        held.reserve(m_inBand);
+        if (m_inBand)
+            for (std::size_t i = m_best; i != npos; i = nextWorse(i)) {
+                held.push_back(m_ladder[i]);
+                m_ladder[i] = Level{Price{0}};  // level() expects vacated slots zeroed
+            }
+        const std::size_t fromLadder = held.size();
+        m_overflow.forEach([&](const Level& lvl) {
+            if (static_cast<std::uint64_t>(lvl.price) - static_cast<std::uint64_t>(base) < Ticks)
+                held.push_back(lvl);
+        });
+        for (std::size_t i = fromLadder; i < held.size(); ++i) m_overflow.erase(held[i]);
+
+        for (std::uint64_t& word : m_bits) word = 0;
+        m_inBand       = 0;
+        m_base         = base;
+        m_overflowHits = 0;
+        for (const Level& lvl : held) {
+            const std::size_t idx = slot(lvl.price);
+            Level& dst = idx < Ticks ? m_ladder[idx] : m_overflow.level(lvl.price);
+            dst = lvl;
+            if (idx < Ticks) {
+                set(idx);
+                if (m_inBand++ == 0 || better(idx, m_best)) m_best = idx;
+            }
+            moved(dst);
+        }
+    }
+
+    template <class F>
+    void forEach(F&& fn) const {
+        forEachWhile([&fn](const Level& lvl) {
+            fn(lvl);
+            return true;
+        });
+    }
+
+    template <class F>
+    bool forEachWhile(F&& fn) const {
+        // Overflow levels beyond the best edge of the band come first, then
+        // the band itself, then overflow levels beyond its worst edge.
+        bool bandDone = m_inBand == 0;
+        const bool finished = m_overflow.forEachWhile([&](const Level& lvl) {
+            if (!bandDone && !beyondBestEdge(lvl.price)) {
+                bandDone = true;
+                if (!forEachInBand(fn)) return false;
+            }
+            return fn(lvl);
+        });
+        return finished && (bandDone || forEachInBand(fn));
+    }
+
+private:
+    static constexpr std::size_t kWords = Ticks / 64;
+    static constexpr std::size_t npos   = Ticks;
+
+    /// Overflow hits tolerated before a touch outside the band triggers a
+    /// recenter; keeps a touch hovering at the band edge from thrashing.
+    static constexpr std::size_t kRecenterAfter = 64;
+
+    /// Index of `px` in the band; >= Ticks when out of band (incl. below base).
+    [[nodiscard]] std::size_t slot(Price px) const noexcept {
+        return static_cast<std::size_t>(static_cast<std::uint64_t>(px) - static_cast<std::uint64_t>(m_base));
+    }
+
+    [[nodiscard]] static constexpr bool better(std::size_t a, std::size_t b) noexcept {
+        if constexpr (S == Side::Buy) return a > b;
+        else                          return a < b;
+    }
+
+    [[nodiscard]] bool beyondBestEdge(Price px) const noexcept {
+        if constexpr (S == Side::Buy) return px >= m_base + static_cast<Price>(Ticks);
+        else                          return px < m_base;
+    }
+
+    [[nodiscard]] bool test(std::size_t i) const noexcept { return (m_bits[i / 64] >> (i % 64)) & 1u; }
+    void set(std::size_t i)   noexcept { m_bits[i / 64] |=  (std::uint64_t{1} << (i % 64)); }
+    void clear(std::size_t i) noexcept { m_bits[i / 64] &= ~(std::uint64_t{1} << (i % 64)); }
+
+    /// Next occupied slot strictly worse than `i` (lower for bids, higher for
+    /// asks), scanning the bitmap a word at a time; npos if none.
+    [[nodiscard]] std::size_t nextWorse(std::size_t i) const noexcept {
+        std::size_t w = i / 64;
+        const unsigned b = i % 64;
+        if constexpr (S == Side::Buy) {
+            std::uint64_t bits = m_bits[w] & ((std::uint64_t{1} << b) - 1);
+            while (bits == 0) {
+                if (w == 0) return npos;
+                bits = m_bits[--w];
+            }
+            return w * 64 + 63 - static_cast<std::size_t>(std::countl_zero(bits));
+        } else {
+            std::uint64_t bits = b == 63 ? 0 : m_bits[w] & (~std::uint64_t{0} << (b + 1));
+            while (bits == 0) {
+                if (++w >= kWords) return npos;
+                bits = m_bits[w];
+            }
+            return w * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+        }
+    }
+
+    template <class F>
+    bool forEachInBand(F& fn) const {
+        for (std::size_t i = m_best; i != npos; i = nextWorse(i))
+            if (!fn(m_ladder[i])) return false;
+        return true;
+    }
+
+    std::pmr::vector<Level>      m_ladder;     // sized once: addresses stay stable
+    std::uint64_t                m_bits[kWords]{};
+    std::size_t                  m_best   = 0; // valid while m_inBand > 0
+    std::size_t                  m_inBand = 0; // occupied in-band levels
+    Price                        m_base   = 0;
+    std::size_t                  m_overflowHits = 0; // overflow level() calls since the last anchor
+    MapBook<S>                   m_overflow;
+};
+
+// ---------------------------------------------------------------------------
+// Level storage policies for BasicMatchingEngine
+// ---------------------------------------------------------------------------
+
+struct MapLevels {
+    template <Side S> using Book = MapBook<S>;
+};
+
+template <std::size_t Ticks = 4096>
+struct LadderLevels {
+    template <Side S> using Book = LadderBook<S, Ticks>;
+};
@@ -1,22 +1,36 @@
 #pragma once
 
+#include "BookRegistry.hpp"
+#include "LineScanner.hpp"
 #include "MatchingEngine.hpp"
+#include "ShardedEngine.hpp"
+#include "Symbol.hpp"
+#include "TextFormat.hpp"
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <expected>
-#include <format>
-#include <iterator>
+#include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <variant>
+#include <vector>
 
 // ---------------------------------------------------------------------------
 // Text wire protocol
 //
-//   SUBMIT <id> <B|S> <price> <qty>
-//   CANCEL <id>
-//   DUMP
+//   SUBMIT [<symbol>] <id> <B|S> <price> <qty> [IOC|FOK|MARKET|POST]
+//          [ACCT=<account>] [STP=NEWEST|OLDEST|BOTH|DECREMENT]
+//   CANCEL [<symbol>] <id>
+//   MODIFY [<symbol>] <id> <price> <qty>
+//   DUMP   [<symbol>]
+//
+// The optional symbol (1-8 chars, leading letter) routes the command to that
+// instrument's book; without it the command targets the default book, so the
+// original single-instrument grammar is unchanged.
 //
 // Parsing is allocation-free (std::string_view tokens + std::from_chars) and
 // reports failures through std::expected instead of sentinel strings.
@@ -24,17 +38,19 @@
 
 enum class ParseError : std::uint8_t {
     Empty,           // blank/whitespace-only line: a no-op, not an error reply
-    BadSubmit,       // SUBMIT with missing/malformed fields
+    BadSubmit,       // SUBMIT with missing/malformed fields or an unknown option
     BadSide,         // side token is not B/S (case-insensitive)
     BadCancel,       // CANCEL with missing/malformed id
+    BadModify,       // MODIFY with missing/malformed fields
     UnknownCommand,
 };
 
-struct SubmitCommand { Order order; };
-struct CancelCommand { OrderId id; };
-struct DumpCommand   {};
+struct SubmitCommand { Order order;  SymbolCode symbol = kNoSymbol; };
+struct CancelCommand { OrderId id;   SymbolCode symbol = kNoSymbol; };
+struct ModifyCommand { OrderId id;   Price price; Quantity quantity; SymbolCode symbol = kNoSymbol; };
+struct DumpCommand   {               SymbolCode symbol = kNoSymbol; };
 
-using Command = std::variant<SubmitCommand, CancelCommand, DumpCommand>;
+using Command = std::variant<SubmitCommand, CancelCommand, ModifyCommand, DumpCommand>;
 
 /**
  * Parse one protocol line into a Command.
@@ -45,6 +61,22 @@ using Command = std::variant<SubmitCommand, CancelCommand, DumpCommand>;
  */
 [[nodiscard]] std::expected<Command, ParseError> parse_command(std::string_view line) noexcept;
 
+/// Reusable state and output of parse_commands().
+struct CommandBatch {
+    ChunkIndex                                      index;         // boundaries of the last chunk
+    std::vector<std::expected<Command, ParseError>> commands;      // one per complete line
+    std::size_t                                     consumed = 0;  // bytes through the last '\n'
+};
+
+/**
+ * Parse every complete line of `chunk` in one pass: a single vectorised scan
+ * indexes all line and token boundaries (ChunkIndex), then each line is
+ * parsed off that index with the same grammar as parse_command(). Line i of
+ * the result ends at batch.index.newlines()[i]; a trailing partial line is
+ * left unparsed (batch.consumed stops before it).
+ */
+std::span<const std::expected<Command, ParseError>> parse_commands(std::string_view chunk, CommandBatch& batch);
+
 /**
  * Formats engine events into the text wire protocol, appending to a caller-
  * owned response buffer:
@@ -53,46 +85,147 @@ using Command = std::variant<SubmitCommand, CancelCommand, DumpCommand>;
  *   FillEvent                          -> "FILL <taker> <maker> <px> <qty>\n"
  *   RejectEvent{DuplicateId}           -> "ERR DUPLICATE_ID <id>\n"
  *   RejectEvent{BadQuantity}           -> "ERR BAD_QTY\n"
- *   RejectEvent{UnknownOrder} (cancel) -> "ACK <id> NOT_FOUND\n"
+ *   RejectEvent{WouldCross}            -> "ERR WOULD_CROSS <id>\n"
+ *   RejectEvent{QuantityLimit}         -> "ERR RISK_QTY <id>\n"
+ *   RejectEvent{NotionalLimit}         -> "ERR RISK_NOTIONAL <id>\n"
+ *   RejectEvent{PriceCollar}           -> "ERR RISK_COLLAR <id>\n"
+ *   RejectEvent{OpenOrderLimit}        -> "ERR RISK_OPEN_ORDERS <id>\n"
+ *   RejectEvent{PositionLimit}         -> "ERR RISK_POSITION <id>\n"
+ *   RejectEvent{TooManyAccounts}       -> "ERR RISK_ACCOUNTS <id>\n"
+ *   RejectEvent{SelfTrade}             -> "ERR SELF_TRADE <id>\n"
+ *   RejectEvent{Killed}                -> "ERR KILLED <id>\n"
+ *   RejectEvent{Throttled}             -> "ERR THROTTLED <id>\n"
+ *   RejectEvent{JournalFailed}         -> "ERR JOURNAL_FAILED <id>\n"
+ *   RejectEvent{UnknownOrder}          -> "ACK <id> NOT_FOUND\n" (cancel, modify)
+ *
+ * A command naming a symbol that is not hosted yields "ERR UNKNOWN_SYMBOL\n".
  */
 class FormattingSink {
 public:
     explicit FormattingSink(std::string& out) noexcept : m_out{&out} {}
 
-    void operator()(const AckEvent& e) const {
-        std::format_to(std::back_inserter(*m_out), "ACK {}\n", e.id);
-    }
+    void operator()(const AckEvent& e) const { idLine("ACK ", e.id, "\n"); }
 
     void operator()(const FillEvent& e) const {
-        std::format_to(std::back_inserter(*m_out), "FILL {} {} {} {}\n",
-                       e.taker, e.maker, e.price, e.quantity);
+        append_line(*m_out, 5 + 4 * (kMaxIntChars + 1), [&e](char* p) noexcept {
+            p = write_int(write_chars(p, "FILL "), e.taker);
+            p = write_int(write_chars(p, " "), e.maker);
+            p = write_int(write_chars(p, " "), e.price);
+            p = write_int(write_chars(p, " "), e.quantity);
+            return write_chars(p, "\n");
+        });
     }
 
-    void operator()(const CancelAckEvent& e) const {
-        std::format_to(std::back_inserter(*m_out), "ACK {}\n", e.id);
-    }
+    void operator()(const CancelAckEvent& e) const { idLine("ACK ", e.id, "\n"); }
 
     void operator()(const RejectEvent& e) const {
         switch (e.reason) {
             using enum RejectReason;
             case DuplicateId:
-                std::format_to(std::back_inserter(*m_out), "ERR DUPLICATE_ID {}\n", e.id);
+                idLine("ERR DUPLICATE_ID ", e.id, "\n");
                 return;
             case BadQuantity:
                 *m_out += "ERR BAD_QTY\n";
                 return;
             case UnknownOrder:
-                std::format_to(std::back_inserter(*m_out), "ACK {} NOT_FOUND\n", e.id);
+                idLine("ACK ", e.id, " NOT_FOUND\n");
+                return;
+            case WouldCross:
+                idLine("ERR WOULD_CROSS ", e.id, "\n");
+                return;
+            case QuantityLimit:
+                idLine("ERR RISK_QTY ", e.id, "\n");
+                return;
+            case NotionalLimit:
+                idLine("ERR RISK_NOTIONAL ", e.id, "\n");
+                return;
+            case PriceCollar:
+                idLine("ERR RISK_COLLAR ", e.id, "\n");
+                return;
+            case OpenOrderLimit:
+                idLine("ERR RISK_OPEN_ORDERS ", e.id, "\n");
+                return;
+            case PositionLimit:
+                idLine("ERR RISK_POSITION ", e.id, "\n");
+                return;
+            case TooManyAccounts:
+                idLine("ERR RISK_ACCOUNTS ", e.id, "\n");
+                return;
+            case SelfTrade:
+                idLine("ERR SELF_TRADE ", e.id, "\n");
+                return;
+            case Killed:
+                idLine("ERR KILLED ", e.id, "\n");
+                return;
+            case Throttled:
+                idLine("ERR THROTTLED ", e.id, "\n");
+                return;
+            case JournalFailed:
+                idLine("ERR JOURNAL_FAILED ", e.id, "\n");
                 return;
         }
         std::unreachable();  // C++23: all enumerators handled above
     }
 
 private:
+    /// "<prefix><id><suffix>", written in place.
+    void idLine(std::string_view prefix, OrderId id, std::string_view suffix) const {
+        append_line(*m_out, prefix.size() + kMaxIntChars + suffix.size(), [&](char* p) noexcept {
+            return write_chars(write_int(write_chars(p, prefix), id), suffix);
+        });
+    }
+
     std::string* m_out;
 };
 static_assert(EventSink<FormattingSink>);
 
+class Journal;         // Journal.hpp
+class MarketDataRing;  // MarketDataRing.hpp
+
+/**
+ * Message-rate limit for one session: at most `perSecond` SUBMITs and
+ * MODIFYs per one-second window, the rest rejected as Throttled before
+ * they reach a journal or book. CANCELs always pass, so a throttled client
+ * can still pull its orders. 0 = unlimited, and then the clock is never read.
+ */
+class MessageThrottle {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit MessageThrottle(std::uint32_t perSecond = 0) noexcept : m_limit{perSecond} {}
+
+    [[nodiscard]] bool admit() noexcept { return m_limit == 0 || admit(Clock::now()); }
+
+    [[nodiscard]] bool admit(Clock::time_point now) noexcept {
+        if (m_limit == 0) return true;
+        if (now >= m_windowEnd) {
+            m_windowEnd = now + std::chrono::seconds{1};
+            m_used      = 0;
+        }
+        if (m_used == m_limit) return false;
+        ++m_used;
+        return true;
+    }
+
+private:
+    std::uint32_t     m_limit;
+    std::uint32_t     m_used = 0;
+    Clock::time_point m_windowEnd{};
+};
+
+/// Whether `command` is subject to a MessageThrottle, and the id to reject.
+[[nodiscard]] constexpr std::optional<OrderId> throttled_id(const Command& command) noexcept {
+    if (const auto* submit = std::get_if<SubmitCommand>(&command)) return submit->order.id;
+    if (const auto* modify = std::get_if<ModifyCommand>(&command)) return modify->id;
+    return std::nullopt;
+}
+
+/// The order id a SUBMIT, CANCEL or MODIFY names; nullopt for DUMP.
+[[nodiscard]] constexpr std::optional<OrderId> command_id(const Command& command) noexcept {
+    if (const auto* cancel = std::get_if<CancelCommand>(&command)) return cancel->id;
+    return throttled_id(command);
+}
+
 /**
  * Parse a single protocol line and apply it to `engine`.
  *
@@ -103,3 +236,76 @@ static_assert(EventSink<FormattingSink>);
  * @return true if a response should be sent; false for empty/no-op input.
  */
 [[nodiscard]] bool process_line(std::string_view line, MatchingEngine& engine, std::string& response);
+
+/// As above, routing each command to the book for its symbol in `books`.
+[[nodiscard]] bool process_line(std::string_view line, BookRegistry& books, std::string& response);
+
+/// Apply an already-parsed line (see parse_commands) to `books`, appending
+/// the response to `out` (not cleared). Returns false for a blank line.
+/// Commands that reach a book are first recorded in `journal`, if given;
+/// their fills and book updates are published to `feed`, if given. With a
+/// `throttle`, SUBMITs and MODIFYs over its rate are rejected first. Once
+/// the journal has failed, every SUBMIT, CANCEL and MODIFY is rejected as
+/// JournalFailed without reaching a book.
+bool process_command(const std::expected<Command, ParseError>& parsed, BookRegistry& books, std::string& out,
+                     Journal* journal = nullptr, MarketDataRing* feed = nullptr,
+                     MessageThrottle* throttle = nullptr);
+
+/// Encoding a connection speaks (see BinaryProtocol.hpp for the switch).
+enum class WireFormat : std::uint8_t { Text, Binary };
+
+/**
+ * Protocol front end for a ShardedEngine — the sharded counterpart of
+ * process_line() and process_message().
+ *
+ * line() parses a text command (message() decodes a binary one) and posts
+ * it to the shard hosting its symbol (parse errors and unknown symbols are
+ * answered at once); flush() waits for every posted request to complete and
+ * appends the responses, encoded in the session's current format.
+ * Responses are grouped per shard, so lines for different symbols may come
+ * back in a different order than they were sent, but each symbol's
+ * responses keep their request order and each request's FILLs stay
+ * contiguous with its ACK. DUMP flushes first, then reads the quiescent book.
+ *
+ * Drives the engine from the calling (front-end) thread only.
+ */
+class ShardedSession {
+public:
+    /// Commands posted to a shard are first recorded in `journal`, if given,
+    /// and rejected as JournalFailed once it has failed; SUBMITs and MODIFYs
+    /// beyond `messagesPerSecond` (0 = no limit) are rejected as Throttled
+    /// without being posted.
+    explicit ShardedSession(ShardedEngine& engine, std::uint32_t session = 0, Journal* journal = nullptr,
+                            std::uint32_t messagesPerSecond = 0);
+
+    /// Handle one text protocol line; returns false for empty/no-op input.
+    bool line(std::string_view line, std::string& tx) { return command(parse_command(line), tx); }
+
+    /// Handle one already-parsed text line (see parse_commands).
+    bool command(const std::expected<Command, ParseError>& parsed, std::string& tx);
+
+    /// Handle one complete binary message.
+    void message(std::string_view msg, std::string& tx);
+
+    /// Block until every posted request has completed; append the responses.
+    void flush(std::string& tx);
+
+    [[nodiscard]] WireFormat format() const noexcept { return m_format; }
+
+    /// Precondition: flushed, so no response is pending in the old format.
+    void setFormat(WireFormat format) noexcept { m_format = format; }
+
+private:
+    /// Route a submit/cancel/modify to its shard; false if the symbol is not hosted.
+    bool post(const Command& command);
+    void enqueue(ShardId shard, const ShardRequest& request);
+    void drain(ShardId shard);
+
+    ShardedEngine*           m_engine;
+    Journal*                 m_journal;
+    MessageThrottle          m_throttle;
+    std::uint32_t            m_session;
+    WireFormat               m_format = WireFormat::Text;
+    std::vector<std::size_t> m_outstanding;  // per shard: requests awaiting a terminal event
+    std::vector<std::string> m_pending;      // per shard: formatted responses not yet flushed
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "BinaryProtocol.hpp"
+#include "BookRegistry.hpp"
+#include "Journal.hpp"
+#include "Latency.hpp"
+#include "Protocol.hpp"
+#include "ShardedEngine.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <variant>
+
+// ---------------------------------------------------------------------------
+// Server plumbing shared by the network transports
+//
+// A transport owns sockets and byte buffers; everything protocol-shaped goes
+// through a per-connection Session: complete lines (or, once the connection
+// has switched to the binary protocol, messages) in, response bytes out.
+// The session type depends on the matching mode the server was started in —
+// inline against a BookRegistry, or posted to a ShardedEngine — and is a
+// closed std::variant so transports stay plain, non-template code.
+// ---------------------------------------------------------------------------
+
+/// Per-connection command processor: line() handles one text line (command()
+/// one already parsed by parse_commands) and message() one binary message,
+/// appending any response to `tx`; flush() completes deferred work before the
+/// batch's responses are sent.
+template <typename P>
+concept SessionProcessor = requires(P& p, std::string_view in, std::string& tx, WireFormat f,
+                                    const std::expected<Command, ParseError>& parsed) {
+    { p.line(in, tx) } -> std::same_as<bool>;
+    { p.command(parsed, tx) } -> std::same_as<bool>;
+    p.message(in, tx);
+    p.flush(tx);
+    { p.format() } -> std::same_as<WireFormat>;
+    p.setFormat(f);
+};
+
+/// Matches inline on the network thread against a BookRegistry.
+class InlineSession {
+public:
+    explicit InlineSession(BookRegistry& books, Journal* journal = nullptr, MarketDataRing* feed = nullptr,
+                           std::uint32_t messagesPerSecond = 0) noexcept
+        : m_books{&books}, m_journal{journal}, m_feed{feed}, m_throttle{messagesPerSecond} {}
+
+    bool line(std::string_view line, std::string& tx) { return command(parse_command(line), tx); }
+
+    bool command(const std::expected<Command, ParseError>& parsed, std::string& tx) {
+        return process_command(parsed, *m_books, tx, m_journal, m_feed, &m_throttle);
+    }
+
+    void message(std::string_view msg, std::string& tx) {
+        process_message(msg, *m_books, tx, m_journal, m_feed, &m_throttle);
+    }
+
+    static void flush(std::string&) noexcept {}
+
+    [[nodiscard]] WireFormat format() const noexcept { return m_format; }
+    void setFormat(WireFormat format) noexcept { m_format = format; }
+
+private:
+    BookRegistry*   m_books;
+    Journal*        m_journal;
+    MarketDataRing* m_feed;
+    MessageThrottle m_throttle;
+    WireFormat      m_format = WireFormat::Text;
+};
+static_assert(SessionProcessor<InlineSession>);
+static_assert(SessionProcessor<ShardedSession>);
+
+using Session = std::variant<InlineSession, ShardedSession>;
+
+/// Builds the session for each new connection in the server's matching
+/// mode; with a journal, every session records into it, and with a feed
+/// (inline matching only) every session publishes to it. Each session gets
+/// its own MessageThrottle at the factory's message rate.
+class SessionFactory {
+public:
+    explicit SessionFactory(BookRegistry& books, Journal* journal = nullptr, MarketDataRing* feed = nullptr) noexcept
+        : m_books{&books}, m_journal{journal}, m_feed{feed} {}
+    explicit SessionFactory(ShardedEngine& engine, Journal* journal = nullptr) noexcept
+        : m_sharded{&engine}, m_journal{journal} {}
+
+    /// Per-session SUBMIT/MODIFY rate for sessions made from here on; 0 = no limit.
+    void setMessageRate(std::uint32_t perSecond) noexcept { m_messagesPerSecond = perSecond; }
+
+    [[nodiscard]] Session make(std::uint32_t sessionId) const {
+        if (m_sharded) {
+            return Session{std::in_place_type<ShardedSession>, *m_sharded, sessionId, m_journal,
+                           m_messagesPerSecond};
+        }
+        return Session{std::in_place_type<InlineSession>, *m_books, m_journal, m_feed, m_messagesPerSecond};
+    }
+
+private:
+    BookRegistry*   m_books   = nullptr;
+    ShardedEngine*  m_sharded = nullptr;
+    Journal*        m_journal = nullptr;
+    MarketDataRing* m_feed    = nullptr;
+    std::uint32_t   m_messagesPerSecond = 0;
+};
+
+/// Re-apply every record of `journal` through `session`, discarding the
+/// responses (startup recovery). Returns the number of records replayed.
+std::size_t replay_journal(JournalReader& journal, Session& session);
+
+/**
+ * Run every complete line (or binary message) at the front of `rx` through
+ * `session`, then flush it, appending all responses to `tx` (one batch per
+ * received chunk). Text lines are framed and parsed together by
+ * parse_commands() into `scratch`, which the transport reuses across calls.
+ * A "BINARY" line switches the session to binary messages for the rest of
+ * `rx` and all later input; a "STATS" line is answered with the server's
+ * latency histograms (format_latency_stats).
+ *
+ * With `latency` (stamped by the transport as the chunk arrived), the
+ * chunk's parse and match times are recorded into this thread's
+ * LatencyStats and `latency->matched` is set for the transport's sent().
+ *
+ * @return Bytes consumed; the caller keeps rx[consumed..] (a partial line
+ *         or message).
+ */
+std::size_t process_input(std::string_view rx, Session& session, std::string& tx, CommandBatch& scratch,
+                          PendingLatency* latency = nullptr);
+
+struct EpollServerConfig {
+    std::size_t readBudget   = 64 * 1024;  // bytes read per connection per turn
+    std::size_t maxTxBacklog = 4u << 20;   // stop reading a client this far behind
+};
+
+/**
+ * Serve any number of clients concurrently from the calling thread with an
+ * edge-triggered epoll loop. All connections share the books behind
+ * `sessions`. Returns 0 once `stop` is requested, non-zero on fatal error.
+ */
+int run_epoll_server(int listenFd, const SessionFactory& sessions,
+                     const EpollServerConfig& config = {}, std::stop_token stop = {});
+
+struct IoUringServerConfig {
+    unsigned    queueDepth     = 1024;       // submission queue entries
+    unsigned    recvBuffers    = 1024;       // provided receive buffers (power of two)
+    std::size_t recvBufferSize = 4096;
+    unsigned    sendBuffers    = 64;         // registered send buffers (counts against RLIMIT_MEMLOCK)
+    std::size_t sendBufferSize = 64 * 1024;
+    std::size_t maxTxBacklog   = 4u << 20;   // stop reading a client this far behind
+};
+
+/// True if the running kernel offers everything run_io_uring_server needs
+/// (multishot accept/recv, provided-buffer rings; Linux 6.0+).
+[[nodiscard]] bool io_uring_supported() noexcept;
+
+/**
+ * Serve any number of clients concurrently from the calling thread through
+ * io_uring: multishot recv into a provided-buffer ring, responses written
+ * from registered buffers, one batched submission per loop. Same contract as
+ * run_epoll_server.
+ */
+int run_io_uring_server(int listenFd, const SessionFactory& sessions,
+                        const IoUringServerConfig& config = {}, std::stop_token stop = {});
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "MatchingEngine.hpp"
+#include "SpscQueue.hpp"
+#include "Symbol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <latch>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// ShardedEngine
+//
+// Multi-core runtime: instruments are hashed across N shard threads, each
+// pinned to its own core and owning its own MatchingEngines (and therefore
+// their arenas — nothing is shared between shards). A single front-end
+// thread (the network thread) posts requests into one SPSC queue per shard
+// and drains each shard's SPSC output queue for the resulting events.
+//
+// Every request for a given symbol travels the same FIFO to the same thread,
+// so per-symbol sequencing is exactly that of a single-threaded engine;
+// requests for different symbols proceed in parallel.
+//
+// Each request produces exactly one terminal event — AckEvent or RejectEvent
+// for a submit or modify, CancelAckEvent or RejectEvent for a cancel —
+// preceded by any FillEvents and self-trade-prevention CancelAckEvents for
+// other orders. The shard marks it, so the front end can count outstanding
+// requests per shard.
+//
+// Threading contract: post(), poll() and book() are front-end-thread only.
+// book() may only be read while that shard has no outstanding requests (all
+// terminal events drained): the queue's release/acquire pairing then orders
+// every write the shard made before the front end's read.
+// ---------------------------------------------------------------------------
+
+using ShardId = std::uint16_t;
+
+/// Where a symbol lives: its shard and the book's index within that shard.
+struct ShardRoute {
+    ShardId       shard;
+    std::uint32_t book;
+};
+
+struct ShardRequest {
+    enum class Kind : std::uint8_t { Submit, Cancel, Modify };
+
+    Kind          kind;
+    std::uint32_t session;  // opaque to the shard; echoed on every event
+    std::uint32_t book;
+    Order         order;    // Cancel uses order.id only; Modify id, price and quantity
+};
+
+using EngineEvent = std::variant<AckEvent, FillEvent, CancelAckEvent, RejectEvent>;  // trade events
+
+struct ShardEvent {
+    std::uint32_t session;
+    EngineEvent   event;
+    bool          terminal;  // the request's own answer: the last event it produces
+};
+
+class ShardedEngine {
+public:
+    struct Config {
+        std::size_t shards        = 2;
+        std::size_t queueCapacity = 1u << 16;
+        std::size_t ordersPerBook = 1u << 12;
+        int         firstCpu      = 1;  // shard i pins to firstCpu + i; -1 disables pinning
+        RiskLimits  risk          = {};  // enforced by every book
+    };
+
+    /// Start the shard threads hosting `symbols` plus the default book
+    /// (kNoSymbol, always on shard 0). Returns once every book is allocated.
+    ShardedEngine(std::span<const SymbolCode> symbols, const Config& config);
+    ~ShardedEngine();  // stops and joins the shard threads
+
+    ShardedEngine(const ShardedEngine&)            = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+
+    [[nodiscard]] std::size_t shardCount() const noexcept { return m_shards.size(); }
+
+    [[nodiscard]] std::optional<ShardRoute> route(SymbolCode symbol) const noexcept {
+        const auto it = m_routes.find(symbol);
+        if (it == m_routes.end()) return std::nullopt;
+        return it->second;
+    }
+
+    /// Enqueue `request` on `shard`; false if its input queue is full. A
+    /// caller retrying must keep polling that shard's output meanwhile — a
+    /// shard blocked on a full output queue stops consuming input.
+    [[nodiscard]] bool tryPost(ShardId shard, const ShardRequest& request) noexcept {
+        return m_shards[shard]->in.tryPush(request);
+    }
+
+    /// Hand every event currently queued by `shard` to `fn`; returns the count.
+    template <class F>
+    std::size_t poll(ShardId shard, F&& fn) {
+        return m_shards[shard]->out.drain(fn);
+    }
+
+    /// Direct access to a book; see the threading contract above.
+    [[nodiscard]] const MatchingEngine& book(ShardRoute r) const noexcept {
+        return *m_shards[r.shard]->books[r.book];
+    }
+
+private:
+    struct Shard {
+        explicit Shard(std::size_t capacity) : in{capacity}, out{capacity} {}
+
+        SpscQueue<ShardRequest>                      in;
+        SpscQueue<ShardEvent>                        out;
+        std::vector<std::unique_ptr<MatchingEngine>> books;  // built on the shard thread
+        std::jthread                                 thread;
+    };
+
+    static void run(std::stop_token stop, Shard& shard, std::size_t bookCount,
+                    std::size_t ordersPerBook, const RiskLimits& risk, int cpu, std::latch& ready);
+
+    std::vector<std::unique_ptr<Shard>>        m_shards;
+    std::unordered_map<SymbolCode, ShardRoute> m_routes;  // read-only after construction
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "BookRegistry.hpp"
+#include "MatchingEngine.hpp"
+#include "Symbol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// ---------------------------------------------------------------------------
+// Book snapshots
+//
+// A flat, little-endian image of every book in a BookRegistry, written and
+// read through mmap. Restoring one is a sequential walk of the mapped file
+// into MatchingEngine::restoreLevel() — each level is looked up once and its
+// orders are appended straight onto the slab, FIFO order preserved, with no
+// matching and no events — instead of one submit() per order as a journal
+// replay does. The id index is rebuilt as the orders are placed (presized
+// once per book), not stored: its contents are implied by the orders.
+//
+// Each book also carries every account slot and its filled position when it
+// enforces a per-account limit — flat accounts too, since a slot is held for
+// the life of the book and counts against accountSlots — so the risk
+// decisions a journal tail replays after it see what they saw live. Open order counts and quantities are not
+// stored: restoreLevel() rebuilds them with the orders.
+//
+// A snapshot records the journal position it reflects, so recovery is
+// "load snapshot, skip that many journal records, replay the tail".
+//
+//   SnapshotHeader                       "MESNAPSH", version, book count, journal position
+//   per book:   SnapshotBook             symbol, level, order and position counts
+//     per level (bids best-first, then asks best-first):
+//               SnapshotLevel            price, side, order count
+//               SnapshotOrder * count    id, quantity, account, stp mode — FIFO order
+//     SnapshotPosition * positions       account, position (zero for a flat account)
+//
+// Every record is a multiple of 8 bytes, so all fields stay naturally
+// aligned in the mapping.
+// ---------------------------------------------------------------------------
+
+inline constexpr std::string_view kSnapshotMagic   = "MESNAPSH";
+inline constexpr std::uint32_t    kSnapshotVersion = 4;  // 2: order account; 3: positions; 4: order stp mode
+
+struct SnapshotHeader {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t books;
+    std::uint64_t journalRecords;  // journal position this image reflects
+    std::uint64_t reserved;
+};
+
+struct SnapshotBook {
+    SymbolCode    symbol;
+    std::uint64_t levels;
+    std::uint64_t orders;
+    std::uint64_t positions;
+};
+
+struct SnapshotLevel {
+    Price         price;
+    std::uint32_t orders;
+    Side          side;
+    std::uint8_t  reserved[3];
+};
+
+struct SnapshotOrder {
+    OrderId             id;
+    Quantity            quantity;
+    Account             account;  // for self-trade prevention against later orders
+    SelfTradePrevention stp;      // its own mode, should a MODIFY re-enter it
+    std::uint8_t        reserved[3];
+};
+
+struct SnapshotPosition {
+    Quantity      position;
+    Account       account;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 32 && sizeof(SnapshotBook) == 32);
+static_assert(sizeof(SnapshotLevel) == 16 && sizeof(SnapshotOrder) == 24 && sizeof(SnapshotPosition) == 16);
+static_assert(std::has_unique_object_representations_v<SnapshotHeader> &&
+              std::has_unique_object_representations_v<SnapshotBook> &&
+              std::has_unique_object_representations_v<SnapshotLevel> &&
+              std::has_unique_object_representations_v<SnapshotOrder> &&
+              std::has_unique_object_representations_v<SnapshotPosition>,
+              "snapshot records must have no padding");
+
+/**
+ * Write every book in `books` to `path`, tagged with the journal position
+ * `journalRecords`. The image goes to `path`.tmp first and is synced, then
+ * renamed over `path`, so a crash leaves the previous snapshot intact.
+ * Returns false (after reporting why) on failure.
+ */
+[[nodiscard]] bool write_snapshot(const std::string& path, const BookRegistry& books, std::uint64_t journalRecords);
+
+/**
+ * Restore the books in `path` into `books`, registering any symbol it does
+ * not host yet; every book restored into must be empty.
+ *
+ * @return The journal position the snapshot reflects (0 if `path` does not
+ *         exist), or nullopt (after reporting why) if it is unreadable or
+ *         malformed — `books` may then be partially restored.
+ */
+[[nodiscard]] std::optional<std::uint64_t> load_snapshot(const std::string& path, BookRegistry& books);
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// ---------------------------------------------------------------------------
+// SpscQueue
+//
+// Bounded lock-free ring for exactly one producer thread and one consumer
+// thread. The producer owns the tail index and the consumer the head; each
+// side also keeps a private cached copy of the other side's index and only
+// re-reads the shared atomic (an acquire load, i.e. a potential cache miss)
+// when the cached value says the ring looks full/empty. Indices grow without
+// bound and are masked on access, so "full" is simply tail - head == capacity.
+//
+// Producer and consumer state sit on separate cache lines to avoid false
+// sharing. Elements must be trivially copyable: slots are overwritten in
+// place and never destroyed.
+// ---------------------------------------------------------------------------
+
+inline constexpr std::size_t kCacheLine = 64;
+
+template <class T>
+class SpscQueue {
+    static_assert(std::is_trivially_copyable_v<T>, "SpscQueue: T must be trivially copyable");
+
+public:
+    /// Capacity is rounded up to a power of two.
+    explicit SpscQueue(std::size_t capacity)
+        : m_mask{std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity) - 1},
+          m_slots{std::make_unique<T[]>(m_mask + 1)} {}
+
+    SpscQueue(const SpscQueue&)            = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // --- producer side ---
+
+    [[nodiscard]] bool tryPush(const T& value) noexcept {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headCache > m_mask) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail - m_headCache > m_mask) return false;  // genuinely full
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // --- consumer side ---
+
+    [[nodiscard]] bool tryPop(T& out) noexcept {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tailCache) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tailCache) return false;  // genuinely empty
+        }
+        out = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop everything currently visible (up to `limit`) into `fn`, publishing
+    /// the new head once for the whole batch. Returns the number consumed.
+    template <class F>
+    std::size_t drain(F&& fn, std::size_t limit = ~std::size_t{0}) {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        m_tailCache = m_tail.load(std::memory_order_acquire);
+        std::size_t n = m_tailCache - head;
+        if (n > limit) n = limit;
+        for (std::size_t i = 0; i < n; ++i) fn(std::as_const(m_slots[(head + i) & m_mask]));
+        if (n) m_head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return m_mask + 1; }
+
+private:
+    const std::size_t    m_mask;
+    std::unique_ptr<T[]> m_slots;
+
+    alignas(kCacheLine) std::atomic<std::size_t> m_head{0};  // written by consumer
+    std::size_t                                  m_tailCache = 0;
+    alignas(kCacheLine) std::atomic<std::size_t> m_tail{0};  // written by producer
+    std::size_t                                  m_headCache = 0;
+};
+
+/// Wait strategy for a spinning SPSC endpoint: pause-spin briefly, then
+/// yield, so an idle spinner doesn't starve a peer sharing its core (e.g. on
+/// machines with fewer cores than threads).
+class SpinBackoff {
+public:
+    void idle() noexcept {
+        if (++m_spins < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    void reset() noexcept { m_spins = 0; }
+
+private:
+    unsigned m_spins = 0;
+};
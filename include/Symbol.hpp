@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// ---------------------------------------------------------------------------
+// Instrument symbols
+//
+// A symbol is an up-to-8-character ticker packed little-endian into a 64-bit
+// code, so routing a message is an integer hash rather than a string compare.
+// Symbols start with a letter (which keeps them distinguishable from order
+// ids on the wire) and contain no whitespace. Code 0 means "no symbol".
+// ---------------------------------------------------------------------------
+
+using SymbolCode = std::uint64_t;
+inline constexpr SymbolCode kNoSymbol = 0;
+
+[[nodiscard]] constexpr bool is_symbol_lead(char c) noexcept {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+/// Pack `name` into a SymbolCode; nullopt if empty, too long or not a symbol.
+[[nodiscard]] constexpr std::optional<SymbolCode> encode_symbol(std::string_view name) noexcept {
+    if (name.empty() || name.size() > 8 || !is_symbol_lead(name.front())) return std::nullopt;
+    SymbolCode code = 0;
+    for (std::size_t i = 0; i < name.size(); ++i) {
+        const auto c = static_cast<unsigned char>(name[i]);
+        if (c <= ' ' || c >= 0x7f) return std::nullopt;
+        code |= SymbolCode{c} << (8 * i);
+    }
+    return code;
+}
+static_assert(encode_symbol("A") == SymbolCode{'A'});
+static_assert(!encode_symbol("1ABC") && !encode_symbol("TOOLONGSYM"));
+
+/// Inverse of encode_symbol (diagnostics, logging).
+[[nodiscard]] inline std::string symbol_name(SymbolCode code) {
+    std::string name;
+    for (; code != 0; code >>= 8) name += static_cast<char>(code & 0xff);
+    return name;
+}
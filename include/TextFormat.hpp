@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+
+// ---------------------------------------------------------------------------
+// Text formatting fast path
+//
+// The text protocol's responses are short lines of literals and integers
+// ("FILL 12 7 100 5\n"). std::format_to through a back_inserter parses the
+// format string and pushes one char at a time; here a line is written with
+// plain stores into space reserved once for its worst-case length, and
+// integers are emitted two digits per step from a 200-byte digit-pair table
+// after an exact digit count (one multiply and one table compare, no loop).
+// ---------------------------------------------------------------------------
+
+/// Longest decimal rendering of any int64: "-9223372036854775808".
+inline constexpr std::size_t kMaxIntChars = 20;
+
+inline constexpr std::array<char, 200> kDigitPairs = [] {
+    std::array<char, 200> pairs{};
+    for (std::size_t i = 0; i < 100; ++i) {
+        pairs[2 * i]     = static_cast<char>('0' + i / 10);
+        pairs[2 * i + 1] = static_cast<char>('0' + i % 10);
+    }
+    return pairs;
+}();
+
+inline constexpr std::array<std::uint64_t, 20> kPowersOf10 = [] {
+    std::array<std::uint64_t, 20> powers{};
+    std::uint64_t p = 1;
+    for (auto& power : powers) {
+        power = p;
+        p *= 10;
+    }
+    return powers;
+}();
+
+/// Decimal digits in `v` (1 for 0).
+[[nodiscard]] constexpr std::size_t digit_count(std::uint64_t v) noexcept {
+    // floor(log10(2) * bit width) is the count or one short of it.
+    const auto guess = static_cast<std::size_t>(std::bit_width(v | 1) * 1233 >> 12);
+    return guess + ((v | 1) >= kPowersOf10[guess] ? 1 : 0);
+}
+
+/// Write `v` in decimal at `p`; returns one past the last digit.
+[[nodiscard]] inline char* write_uint(char* p, std::uint64_t v) noexcept {
+    char* const end = p + digit_count(v);
+    char*       out = end;
+    while (v >= 100) {
+        out -= 2;
+        std::memcpy(out, &kDigitPairs[2 * (v % 100)], 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        std::memcpy(out - 2, &kDigitPairs[2 * v], 2);
+    } else {
+        out[-1] = static_cast<char>('0' + v);
+    }
+    return end;
+}
+
+/// Write `v` in decimal (with a leading '-' if negative) at `p`.
+template <std::signed_integral T>
+[[nodiscard]] inline char* write_int(char* p, T v) noexcept {
+    static_assert(std::numeric_limits<T>::digits <= 63);
+    auto magnitude = static_cast<std::uint64_t>(v);
+    if (v < 0) {
+        *p++      = '-';
+        magnitude = 0 - magnitude;  // well-defined for the minimum value too
+    }
+    return write_uint(p, magnitude);
+}
+
+/// Copy `s` to `p`; returns one past its end.
+[[nodiscard]] inline char* write_chars(char* p, std::string_view s) noexcept {
+    std::memcpy(p, s.data(), s.size());
+    return p + s.size();
+}
+
+/**
+ * Append one line to `out` in place: `write(first)` stores at most
+ * `capacity` bytes from `first` and returns one past the last. The string
+ * grows (geometrically) at most once per call and nothing is zero-filled.
+ */
+template <class Writer>
+inline void append_line(std::string& out, std::size_t capacity, Writer&& write) {
+    const std::size_t used = out.size();
+    out.resize_and_overwrite(used + capacity, [&](char* buf, std::size_t) noexcept {
+        return static_cast<std::size_t>(write(buf + used) - buf);
+    });
+}
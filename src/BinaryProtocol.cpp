@@ -0,0 +1,119 @@
+#include "BinaryProtocol.hpp"
+#include "Journal.hpp"
+#include "MarketDataRing.hpp"
+
+#include <algorithm>
+#include <concepts>
+#include <cstring>
+#include <variant>
+
+void encode_submit(std::string& out, const Order& order, SymbolCode symbol) {
+    append_message(out, SubmitMsg{binary_header<SubmitMsg>(MsgType::Submit), order.side, order.type, order.stp, 0,
+                                  to_wire(order.account), 0, to_wire(symbol), to_wire(order.id),
+                                  to_wire(order.price), to_wire(order.quantity)});
+}
+
+void encode_cancel(std::string& out, OrderId id, SymbolCode symbol) {
+    append_message(out, CancelMsg{binary_header<CancelMsg>(MsgType::Cancel), 0, to_wire(symbol), to_wire(id)});
+}
+
+void encode_modify(std::string& out, OrderId id, Price price, Quantity quantity, SymbolCode symbol) {
+    append_message(out, ModifyMsg{binary_header<ModifyMsg>(MsgType::Modify), 0, to_wire(symbol), to_wire(id),
+                                  to_wire(price), to_wire(quantity)});
+}
+
+std::size_t binary_message_size(std::string_view rx) noexcept {
+    if (rx.size() < sizeof(BinaryHeader)) return 0;
+    std::uint16_t length;
+    std::memcpy(&length, rx.data(), sizeof(length));
+    const std::size_t n = std::max<std::size_t>(from_wire(length), sizeof(BinaryHeader));
+    return rx.size() < n ? 0 : n;
+}
+
+namespace {
+
+/// Copy a message of exactly type M out of the (unaligned) receive buffer.
+template <class M>
+[[nodiscard]] std::optional<M> read_message(std::string_view msg) noexcept {
+    if (msg.size() != sizeof(M)) return std::nullopt;
+    M m;
+    std::memcpy(&m, msg.data(), sizeof(M));
+    return m;
+}
+
+}  // namespace
+
+std::optional<Command> decode_message(std::string_view msg) noexcept {
+    if (msg.size() < sizeof(BinaryHeader)) return std::nullopt;
+
+    switch (static_cast<MsgType>(msg[2])) {
+        case MsgType::Submit: {
+            const auto m = read_message<SubmitMsg>(msg);
+            if (!m || (m->side != Side::Buy && m->side != Side::Sell) || m->type > OrderType::PostOnly ||
+                m->stp > SelfTradePrevention::Decrement)
+                return std::nullopt;
+            return SubmitCommand{Order{.id       = from_wire(m->id),
+                                       .side     = m->side,
+                                       .type     = m->type,
+                                       .stp      = m->stp,
+                                       .account  = from_wire(m->account),
+                                       .price    = from_wire(m->price),
+                                       .quantity = from_wire(m->quantity)},
+                                 from_wire(m->symbol)};
+        }
+        case MsgType::Cancel: {
+            const auto m = read_message<CancelMsg>(msg);
+            if (!m) return std::nullopt;
+            return CancelCommand{from_wire(m->id), from_wire(m->symbol)};
+        }
+        case MsgType::Modify: {
+            const auto m = read_message<ModifyMsg>(msg);
+            if (!m) return std::nullopt;
+            return ModifyCommand{from_wire(m->id), from_wire(m->price), from_wire(m->quantity), from_wire(m->symbol)};
+        }
+        default:
+            return std::nullopt;  // server-to-client types are not valid input
+    }
+}
+
+void process_message(std::string_view msg, BookRegistry& books, std::string& tx, Journal* journal,
+                     MarketDataRing* feed, MessageThrottle* throttle) {
+    const BinarySink sink{tx};
+    const auto command = decode_message(msg);
+    if (!command) {
+        sink.reject(0, RejectCode::BadMessage);
+        return;
+    }
+    if (const auto id = command_id(*command); id && journal && !journal->healthy()) {
+        sink(RejectEvent{*id, RejectReason::JournalFailed});
+        return;
+    }
+    if (const auto id = throttled_id(*command); id && throttle && !throttle->admit()) {
+        sink(RejectEvent{*id, RejectReason::Throttled});
+        return;
+    }
+
+    std::visit([&](const auto& c) {
+        using T = std::remove_cvref_t<decltype(c)>;
+        if constexpr (std::same_as<T, DumpCommand>) {
+            std::unreachable();  // not expressible in binary
+        } else {
+            MatchingEngine* const engine = books.find(c.symbol);
+            if constexpr (std::same_as<T, SubmitCommand>) {
+                if (!engine) return sink.reject(c.order.id, RejectCode::UnknownSymbol);
+                if (journal) journal->append(c);
+                with_feed(feed, c.symbol, sink, [&](auto&& out) { engine->submit(c.order, out); });
+            } else if constexpr (std::same_as<T, CancelCommand>) {
+                if (!engine) return sink.reject(c.id, RejectCode::UnknownSymbol);
+                if (journal) journal->append(c);
+                with_feed(feed, c.symbol, sink, [&](auto&& out) { engine->cancel(c.id, out); });
+            } else {
+                static_assert(std::same_as<T, ModifyCommand>);
+                if (!engine) return sink.reject(c.id, RejectCode::UnknownSymbol);
+                if (journal) journal->append(c);
+                with_feed(feed, c.symbol, sink,
+                          [&](auto&& out) { engine->modify(c.id, c.price, c.quantity, out); });
+            }
+        }
+    }, *command);
+}
@@ -0,0 +1,281 @@
+#include "Log.hpp"
+#include "Server.hpp"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * Edge-triggered epoll transport.
+ *
+ * Edge triggering means a readiness notification arrives once per burst, so
+ * a connection must be drained until EAGAIN before epoll will report it
+ * again. To keep one chatty client from monopolising the thread, each
+ * connection is only read up to `readBudget` bytes per turn; a connection
+ * that still has unread input goes onto a ready list and is serviced again,
+ * round-robin with the others, before the loop blocks in epoll_wait.
+ *
+ * Per connection, each received chunk is framed and processed exactly like
+ * the original blocking server (offset line walk, one compaction, responses
+ * batched into the tx buffer) and the tx buffer is written once per turn.
+ * When the socket can't take it all, the remainder waits for EPOLLOUT and
+ * reading pauses once the backlog exceeds `maxTxBacklog`, so a client that
+ * doesn't read its responses can't grow server memory without bound.
+ */
+
+namespace {
+
+constexpr std::size_t kChunk     = 4096;
+constexpr int         kMaxEvents = 64;
+
+struct Connection {
+    Connection(int fd_, Session s) : fd{fd_}, session{std::move(s)} {
+        rx.reserve(kChunk);
+        tx.reserve(kChunk);
+    }
+
+    int         fd;
+    Session     session;
+    std::string rx;                 // unparsed bytes carried across reads
+    std::string tx;                 // responses not yet written
+    std::size_t txSent     = 0;     // prefix of tx already written
+    PendingLatency latency;         // stamps of the responses in tx
+    bool        readable   = false; // edge seen, EAGAIN not yet hit
+    bool        queued     = false; // on the ready list
+    bool        writeArmed = false; // EPOLLOUT registered
+};
+
+class EpollServer {
+public:
+    EpollServer(int listenFd, int epfd, const SessionFactory& sessions, const EpollServerConfig& config)
+        : m_listenFd{listenFd}, m_epfd{epfd}, m_sessions{sessions}, m_config{config} {}
+
+    ~EpollServer() {
+        for (const auto& [fd, conn] : m_conns) ::close(fd);
+    }
+
+    int run(const std::stop_token& stop) {
+        std::array<epoll_event, kMaxEvents> events{};
+
+        while (!stop.stop_requested()) {
+            // Busy connections mean there is work now: poll without blocking.
+            const int timeout = !m_ready.empty() ? 0 : stop.stop_possible() ? 50 : -1;
+            const int n = ::epoll_wait(m_epfd, events.data(), kMaxEvents, timeout);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::perror("epoll_wait");
+                return 1;
+            }
+
+            for (int i = 0; i < n; ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == m_listenFd) {
+                    acceptAll();
+                    continue;
+                }
+                const auto it = m_conns.find(fd);
+                if (it == m_conns.end()) continue;
+                Connection& conn = *it->second;
+
+                if (events[i].events & EPOLLOUT) {
+                    if (!flushTx(conn)) continue;  // closed
+                }
+                // Errors and hangups surface as recv() results, so treat them as input.
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    conn.readable = true;
+                    enqueue(conn);
+                }
+            }
+
+            // One fair round: every connection that had input at the start of
+            // the round gets one budgeted turn.
+            for (std::size_t turns = m_ready.size(); turns > 0; --turns) {
+                const int fd = m_ready.front();
+                m_ready.pop_front();
+                const auto it = m_conns.find(fd);
+                if (it == m_conns.end()) continue;
+                Connection& conn = *it->second;
+                conn.queued = false;
+                if (service(conn)) enqueue(conn);
+            }
+        }
+        return 0;
+    }
+
+private:
+    void enqueue(Connection& conn) {
+        if (conn.queued || !conn.readable || backlogged(conn)) return;
+        conn.queued = true;
+        m_ready.push_back(conn.fd);
+    }
+
+    [[nodiscard]] bool backlogged(const Connection& conn) const noexcept {
+        return conn.tx.size() - conn.txSent >= m_config.maxTxBacklog;
+    }
+
+    void acceptAll() {
+        for (;;) {
+            const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) std::perror("accept4");
+                return;
+            }
+
+            // Disable Nagle: small request/response messages go out immediately.
+            int nodelay = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+            epoll_event ev{};
+            ev.events  = EPOLLIN | EPOLLRDHUP | EPOLLET;
+            ev.data.fd = fd;
+            if (::epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                std::perror("epoll_ctl(ADD)");
+                ::close(fd);
+                continue;
+            }
+
+            m_conns.insert_or_assign(fd, std::make_unique<Connection>(fd, m_sessions.make(m_nextSession++)));
+            logln("Client connected ({} open).", m_conns.size());
+        }
+    }
+
+    /// One budgeted read/process/write turn. Returns true if the connection
+    /// is still open and may have more input to read.
+    bool service(Connection& conn) {
+        std::size_t budget = m_config.readBudget;
+        while (budget > 0 && conn.readable && !backlogged(conn)) {
+            const std::size_t kept = conn.rx.size();
+            ssize_t got = 0;
+            conn.rx.resize_and_overwrite(kept + kChunk, [&](char* buf, std::size_t) {
+                got = ::recv(conn.fd, buf + kept, kChunk, 0);
+                return kept + static_cast<std::size_t>(std::max<ssize_t>(got, 0));
+            });
+
+            if (got == 0) {
+                close(conn, "Client closed connection.");
+                return false;
+            }
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    conn.readable = false;
+                    break;
+                }
+                std::perror("recv");
+                close(conn, "Client connection error.");
+                return false;
+            }
+
+            conn.latency.arrived(read_tsc());
+            budget -= std::min(budget, static_cast<std::size_t>(got));
+            const std::size_t consumed = process_input(conn.rx, conn.session, conn.tx, m_scratch, &conn.latency);
+            conn.rx.erase(0, consumed);  // keep only the trailing partial line/message
+        }
+
+        if (!flushTx(conn)) return false;
+        return conn.readable;
+    }
+
+    /// Write as much pending tx as the socket takes; (dis)arm EPOLLOUT to
+    /// match. Returns false if the connection was closed.
+    bool flushTx(Connection& conn) {
+        while (conn.txSent < conn.tx.size()) {
+            const ssize_t n = ::send(conn.fd, conn.tx.data() + conn.txSent,
+                                     conn.tx.size() - conn.txSent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return armWrite(conn, true);
+                std::perror("send");
+                close(conn, "Client connection error.");
+                return false;
+            }
+            conn.txSent += static_cast<std::size_t>(n);
+        }
+        conn.latency.sent(m_stats);
+        conn.tx.clear();
+        conn.txSent = 0;
+        if (!armWrite(conn, false)) return false;
+        enqueue(conn);  // reading may have paused on backlog
+        return true;
+    }
+
+    bool armWrite(Connection& conn, bool on) {
+        if (conn.writeArmed == on) return true;
+        epoll_event ev{};
+        ev.events  = EPOLLIN | EPOLLRDHUP | EPOLLET | (on ? EPOLLOUT : 0u);
+        ev.data.fd = conn.fd;
+        if (::epoll_ctl(m_epfd, EPOLL_CTL_MOD, conn.fd, &ev) < 0) {
+            std::perror("epoll_ctl(MOD)");
+            close(conn, "Client connection error.");
+            return false;
+        }
+        conn.writeArmed = on;
+        return true;
+    }
+
+    void close(Connection& conn, const char* why) {
+        const int fd = conn.fd;
+        ::close(fd);          // also drops it from the epoll set
+        m_conns.erase(fd);    // destroys conn
+        logln("{} ({} open)", why, m_conns.size());
+    }
+
+    int                                                  m_listenFd;
+    int                                                  m_epfd;
+    const SessionFactory&                                m_sessions;
+    EpollServerConfig                                    m_config;
+    std::unordered_map<int, std::unique_ptr<Connection>> m_conns;
+    std::deque<int>                                      m_ready;  // fds with unread input
+    CommandBatch                                         m_scratch;  // parse scratch, shared by all connections
+    LatencyStats&                                        m_stats = thread_latency_stats();
+    std::uint32_t                                        m_nextSession = 0;
+};
+
+}  // namespace
+
+int run_epoll_server(int listenFd, const SessionFactory& sessions,
+                     const EpollServerConfig& config, std::stop_token stop) {
+    const int flags = ::fcntl(listenFd, F_GETFL, 0);
+    if (flags < 0 || ::fcntl(listenFd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        std::perror("fcntl(O_NONBLOCK)");
+        return 1;
+    }
+
+    const int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        std::perror("epoll_create1");
+        return 1;
+    }
+
+    epoll_event ev{};
+    ev.events  = EPOLLIN | EPOLLET;
+    ev.data.fd = listenFd;
+    if (::epoll_ctl(epfd, EPOLL_CTL_ADD, listenFd, &ev) < 0) {
+        std::perror("epoll_ctl(listen)");
+        ::close(epfd);
+        return 1;
+    }
+
+    int rc = 0;
+    {
+        EpollServer server{listenFd, epfd, sessions, config};
+        rc = server.run(stop);
+    }
+    ::close(epfd);
+    return rc;
+}
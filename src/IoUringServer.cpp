@@ -0,0 +1,670 @@
+#include "Log.hpp"
+#include "Server.hpp"
+
+#if __has_include(<linux/io_uring.h>)
+
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * io_uring transport.
+ *
+ * Talks to the kernel through the raw io_uring syscalls (no liburing
+ * dependency) and keeps the per-message syscall count near zero:
+ *
+ *  - One multishot accept on the listening socket for the server's lifetime.
+ *  - One multishot recv per connection drawing from a provided-buffer ring:
+ *    the kernel picks a free buffer, fills it and posts a completion, with no
+ *    re-arm and no user-side read buffer. Lines are parsed straight out of
+ *    the provided buffer; only a trailing partial line is copied aside. The
+ *    buffer goes back on the ring as soon as the chunk is processed.
+ *  - Responses are copied into a send buffer registered with the kernel up
+ *    front (IORING_OP_WRITE_FIXED), so no per-send page pinning. Connections
+ *    beyond the registered pool fall back to plain IORING_OP_SEND.
+ *  - Every submission produced while handling a batch of completions goes to
+ *    the kernel in a single io_uring_enter, which also waits for the next
+ *    batch.
+ *
+ * Back-pressure mirrors the epoll transport: a connection more than
+ * `maxTxBacklog` behind has its recv cancelled and re-armed once it drains.
+ */
+
+namespace {
+
+// --- raw syscalls ---
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* params) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags,
+                       const void* arg, std::size_t argSize) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned count) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+template <class T>
+T* at_offset(void* base, std::uint32_t offset) noexcept {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+// ---------------------------------------------------------------------------
+// Ring: the submission and completion queues shared with the kernel.
+// Single-threaded: only the thread that opened it may touch it.
+// ---------------------------------------------------------------------------
+
+class Ring {
+public:
+    Ring() = default;
+    Ring(const Ring&)            = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    ~Ring() {
+        if (m_sqes != MAP_FAILED) ::munmap(m_sqes, m_sqesBytes);
+        if (m_rings != MAP_FAILED) ::munmap(m_rings, m_ringBytes);
+        if (m_fd >= 0) ::close(m_fd);
+    }
+
+    /// Create the ring; on failure returns false with errno set.
+    [[nodiscard]] bool open(unsigned entries) {
+        // Completions are only reaped inside io_uring_enter on this thread, so
+        // let the kernel defer its task work to then instead of interrupting.
+        // Older kernels reject the newer flags; retry with the portable set.
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN |
+                       IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+        params.cq_entries = entries * 2;
+        m_fd = sys_io_uring_setup(entries, &params);
+        if (m_fd < 0 && errno == EINVAL) {
+            params = io_uring_params{};
+            params.flags      = IORING_SETUP_CQSIZE;
+            params.cq_entries = entries * 2;
+            m_fd = sys_io_uring_setup(entries, &params);
+        }
+        if (m_fd < 0) return false;
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+            errno = ENOTSUP;
+            return false;
+        }
+
+        m_ringBytes = std::max(params.sq_off.array + params.sq_entries * sizeof(std::uint32_t),
+                               params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        m_rings = ::mmap(nullptr, m_ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         m_fd, IORING_OFF_SQ_RING);
+        if (m_rings == MAP_FAILED) return false;
+
+        m_sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = ::mmap(nullptr, m_sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        m_fd, IORING_OFF_SQES);
+        if (m_sqes == MAP_FAILED) return false;
+
+        m_sqHead    = at_offset<std::uint32_t>(m_rings, params.sq_off.head);
+        m_sqTailPtr = at_offset<std::uint32_t>(m_rings, params.sq_off.tail);
+        m_sqMask    = *at_offset<std::uint32_t>(m_rings, params.sq_off.ring_mask);
+        m_sqEntries = params.sq_entries;
+        m_cqHead    = at_offset<std::uint32_t>(m_rings, params.cq_off.head);
+        m_cqTail    = at_offset<std::uint32_t>(m_rings, params.cq_off.tail);
+        m_cqMask    = *at_offset<std::uint32_t>(m_rings, params.cq_off.ring_mask);
+        m_cqes      = at_offset<io_uring_cqe>(m_rings, params.cq_off.cqes);
+
+        // SQ slot i always carries SQE i: fill the indirection array once.
+        auto* array = at_offset<std::uint32_t>(m_rings, params.sq_off.array);
+        for (std::uint32_t i = 0; i < m_sqEntries; ++i) array[i] = i;
+        m_sqTail = *m_sqTailPtr;
+        return true;
+    }
+
+    [[nodiscard]] int fd() const noexcept { return m_fd; }
+
+    /// Next free SQE, zeroed. Submits queued entries first if the SQ is full.
+    [[nodiscard]] io_uring_sqe* sqe() {
+        while (m_sqTail - std::atomic_ref{*m_sqHead}.load(std::memory_order_acquire) >= m_sqEntries) {
+            if (submit(0, nullptr) < 0 && errno != EBUSY && errno != EAGAIN) return nullptr;
+        }
+        io_uring_sqe* sqe = &static_cast<io_uring_sqe*>(m_sqes)[m_sqTail & m_sqMask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++m_sqTail;
+        return sqe;
+    }
+
+    /// Publish queued SQEs and, if `timeout` is given, wait until at least one
+    /// completion is ready or it expires. One syscall either way.
+    int submit(unsigned waitFor, const __kernel_timespec* timeout) {
+        const unsigned pending = m_sqTail - m_sqSubmitted;
+        std::atomic_ref{*m_sqTailPtr}.store(m_sqTail, std::memory_order_release);
+
+        io_uring_getevents_arg arg{};
+        arg.ts = reinterpret_cast<std::uint64_t>(timeout);
+        const unsigned flags = IORING_ENTER_EXT_ARG | (waitFor ? IORING_ENTER_GETEVENTS : 0u);
+        const int rc = sys_io_uring_enter(m_fd, pending, waitFor, flags, &arg, sizeof(arg));
+        if (rc > 0) m_sqSubmitted += static_cast<unsigned>(rc);
+        return rc;
+    }
+
+    /// Hand every ready completion to `fn`, then release them all at once.
+    template <class F>
+    unsigned reap(F&& fn) {
+        std::uint32_t       head = *m_cqHead;  // only we write it
+        const std::uint32_t tail = std::atomic_ref{*m_cqTail}.load(std::memory_order_acquire);
+        const unsigned      n    = tail - head;
+        for (; head != tail; ++head) fn(m_cqes[head & m_cqMask]);
+        std::atomic_ref{*m_cqHead}.store(head, std::memory_order_release);
+        return n;
+    }
+
+private:
+    int           m_fd        = -1;
+    void*         m_rings     = MAP_FAILED;
+    std::size_t   m_ringBytes = 0;
+    void*         m_sqes      = MAP_FAILED;
+    std::size_t   m_sqesBytes = 0;
+
+    std::uint32_t* m_sqHead      = nullptr;
+    std::uint32_t* m_sqTailPtr   = nullptr;
+    std::uint32_t  m_sqMask      = 0;
+    std::uint32_t  m_sqEntries   = 0;
+    std::uint32_t  m_sqTail      = 0;  // local tail, published by submit()
+    std::uint32_t  m_sqSubmitted = 0;
+    std::uint32_t* m_cqHead      = nullptr;
+    std::uint32_t* m_cqTail      = nullptr;
+    std::uint32_t  m_cqMask      = 0;
+    io_uring_cqe*  m_cqes        = nullptr;
+};
+
+// ---------------------------------------------------------------------------
+// ProvidedBuffers: a ring of equal-sized receive buffers the kernel picks
+// from for multishot recv (IORING_REGISTER_PBUF_RING).
+// ---------------------------------------------------------------------------
+
+class ProvidedBuffers {
+public:
+    static constexpr std::uint16_t kGroup = 0;
+
+    ProvidedBuffers() = default;
+    ProvidedBuffers(const ProvidedBuffers&)            = delete;
+    ProvidedBuffers& operator=(const ProvidedBuffers&) = delete;
+
+    ~ProvidedBuffers() {
+        if (m_ring != MAP_FAILED) ::munmap(m_ring, m_ringBytes);
+    }
+
+    /// `count` must be a power of two no larger than 32768.
+    [[nodiscard]] bool open(const Ring& ring, unsigned count, std::size_t size) {
+        m_ringBytes = count * sizeof(io_uring_buf);
+        m_ring = ::mmap(nullptr, m_ringBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m_ring == MAP_FAILED) return false;
+        m_data = std::make_unique<char[]>(count * size);
+        m_size = size;
+        m_mask = static_cast<std::uint16_t>(count - 1);
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr    = reinterpret_cast<std::uint64_t>(m_ring);
+        reg.ring_entries = count;
+        reg.bgid         = kGroup;
+        if (sys_io_uring_register(ring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return false;
+
+        for (unsigned bid = 0; bid < count; ++bid) recycle(static_cast<std::uint16_t>(bid));
+        publish();
+        return true;
+    }
+
+    [[nodiscard]] const char* data(std::uint16_t bid) const noexcept { return m_data.get() + bid * m_size; }
+
+    /// Queue buffer `bid` for reuse; visible to the kernel after publish().
+    void recycle(std::uint16_t bid) noexcept {
+        // Index the ring as a plain io_uring_buf array: in C++ the uapi
+        // header's flexible-array wrapper gains a 1-byte empty struct, which
+        // shifts io_uring_buf_ring::bufs off offset 0.
+        io_uring_buf& buf = static_cast<io_uring_buf*>(m_ring)[(m_tail + m_queued++) & m_mask];
+        buf.addr = reinterpret_cast<std::uint64_t>(m_data.get() + bid * m_size);
+        buf.len  = static_cast<std::uint32_t>(m_size);
+        buf.bid  = bid;
+    }
+
+    void publish() noexcept {
+        if (m_queued == 0) return;
+        m_tail = static_cast<std::uint16_t>(m_tail + m_queued);
+        m_queued = 0;
+        std::atomic_ref{static_cast<io_uring_buf_ring*>(m_ring)->tail}.store(m_tail, std::memory_order_release);
+    }
+
+private:
+    void*                   m_ring      = MAP_FAILED;
+    std::size_t             m_ringBytes = 0;
+    std::unique_ptr<char[]> m_data;
+    std::size_t             m_size   = 0;
+    std::uint16_t           m_mask   = 0;
+    std::uint16_t           m_tail   = 0;
+    std::uint16_t           m_queued = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Server
+// ---------------------------------------------------------------------------
+
+enum class Op : std::uint8_t { Accept, Recv, Write, Cancel };
+
+constexpr std::uint64_t tag(Op op, std::uint32_t conn = 0) noexcept {
+    return (std::uint64_t{static_cast<std::uint8_t>(op)} << 32) | conn;
+}
+constexpr Op            tag_op(std::uint64_t t) noexcept { return static_cast<Op>(t >> 32); }
+constexpr std::uint32_t tag_conn(std::uint64_t t) noexcept { return static_cast<std::uint32_t>(t); }
+
+constexpr int kNoSlot = -1;
+
+struct Connection {
+    Connection(int fd_, std::uint32_t id_, Session s) : fd{fd_}, id{id_}, session{std::move(s)} {}
+
+    int           fd;
+    std::uint32_t id;
+    Session       session;
+    std::string   rx;                   // trailing partial line/message carried across chunks
+    std::string   tx;                   // responses not yet handed to the kernel
+    std::size_t   txTaken    = 0;       // prefix of tx already copied out for writing
+    PendingLatency latency;             // stamps of the responses in tx
+    PendingLatency writeLatency;        // ... and of those in the current write
+    std::string   inflight;             // write source when there is no registered slot
+    std::size_t   writeLen   = 0;       // bytes of the current write
+    std::size_t   writeDone  = 0;       // ... of which the kernel has accepted
+    int           slot       = kNoSlot; // registered send buffer, if holding one
+    bool          recvArmed  = false;
+    bool          writing    = false;
+    bool          paused     = false;   // recv cancelled for back-pressure
+    bool          closing    = false;
+
+    [[nodiscard]] std::size_t backlog() const noexcept { return tx.size() - txTaken + (writeLen - writeDone); }
+};
+
+class IoUringServer {
+public:
+    IoUringServer(int listenFd, const SessionFactory& sessions, const IoUringServerConfig& config)
+        : m_listenFd{listenFd}, m_sessions{sessions}, m_config{config} {}
+
+    ~IoUringServer() {
+        for (const auto& [id, conn] : m_conns) {
+            ::shutdown(conn->fd, SHUT_RDWR);
+            ::close(conn->fd);
+        }
+    }
+
+    [[nodiscard]] bool open() {
+        if (!m_ring.open(m_config.queueDepth)) {
+            std::perror("io_uring_setup");
+            return false;
+        }
+        if (!m_recvBuffers.open(m_ring, m_config.recvBuffers, m_config.recvBufferSize)) {
+            std::perror("io_uring_register(PBUF_RING)");
+            return false;
+        }
+
+        // Registered buffers count against RLIMIT_MEMLOCK; without them every
+        // connection simply uses the plain send path.
+        m_sendData = std::make_unique<char[]>(m_config.sendBuffers * m_config.sendBufferSize);
+        std::vector<iovec> iov(m_config.sendBuffers);
+        for (unsigned i = 0; i < m_config.sendBuffers; ++i)
+            iov[i] = {m_sendData.get() + i * m_config.sendBufferSize, m_config.sendBufferSize};
+        if (!iov.empty() &&
+            sys_io_uring_register(m_ring.fd(), IORING_REGISTER_BUFFERS, iov.data(),
+                                  static_cast<unsigned>(iov.size())) < 0) {
+            std::perror("io_uring_register(BUFFERS); sending without registered buffers");
+            iov.clear();
+        }
+        for (unsigned i = static_cast<unsigned>(iov.size()); i > 0; --i)
+            m_freeSlots.push_back(static_cast<int>(i - 1));
+        return true;
+    }
+
+    int run(const std::stop_token& stop) {
+        if (!armAccept()) return 1;
+
+        // Wake periodically only when someone can ask us to stop.
+        const __kernel_timespec tick{.tv_sec = 0, .tv_nsec = 50'000'000};
+        const __kernel_timespec* timeout = stop.stop_possible() ? &tick : nullptr;
+
+        while (!stop.stop_requested()) {
+            if (m_ring.submit(1, timeout) < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+                std::perror("io_uring_enter");
+                return 1;
+            }
+            bool fatal = false;
+            m_ring.reap([&](const io_uring_cqe& cqe) { fatal |= !complete(cqe); });
+            m_recvBuffers.publish();
+            if (fatal) return 1;
+        }
+        return 0;
+    }
+
+private:
+    /// Dispatch one completion. Returns false on a fatal server error.
+    bool complete(const io_uring_cqe& cqe) {
+        const Op op = tag_op(cqe.user_data);
+        if (op == Op::Accept) return accepted(cqe);
+        if (op != Op::Recv && op != Op::Write) return true;  // cancel results
+
+        const auto it = m_conns.find(tag_conn(cqe.user_data));
+        if (it == m_conns.end()) {
+            // Late recv completion for a connection already gone: still owns a buffer.
+            if (cqe.flags & IORING_CQE_F_BUFFER)
+                m_recvBuffers.recycle(static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+            return true;
+        }
+        Connection& conn = *it->second;
+        if (op == Op::Recv) received(conn, cqe);
+        else                wrote(conn, cqe);
+        reapIfDone(conn);
+        return true;
+    }
+
+    bool armAccept() {
+        io_uring_sqe* sqe = m_ring.sqe();
+        if (!sqe) return false;
+        sqe->opcode       = IORING_OP_ACCEPT;
+        sqe->fd           = m_listenFd;
+        sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data    = tag(Op::Accept);
+        return true;
+    }
+
+    bool accepted(const io_uring_cqe& cqe) {
+        if (cqe.res < 0) {
+            if (cqe.res != -EINTR && cqe.res != -ECONNABORTED) {
+                errno = -cqe.res;
+                std::perror("accept");
+            }
+        } else {
+            const int fd = cqe.res;
+            // Disable Nagle: small request/response messages go out immediately.
+            int nodelay = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+            const std::uint32_t id = m_nextConn++;
+            auto conn = std::make_unique<Connection>(fd, id, m_sessions.make(id));
+            conn->rx.reserve(m_config.recvBufferSize);
+            conn->tx.reserve(m_config.recvBufferSize);
+            Connection& c = *m_conns.insert_or_assign(id, std::move(conn)).first->second;
+            logln("Client connected ({} open).", m_conns.size());
+            armRecv(c);
+        }
+        // A multishot accept ends on error or overflow; start a fresh one.
+        return (cqe.flags & IORING_CQE_F_MORE) || armAccept();
+    }
+
+    void armRecv(Connection& conn) {
+        io_uring_sqe* sqe = m_ring.sqe();
+        if (!sqe) return close(conn, "Client connection error.");
+        sqe->opcode    = IORING_OP_RECV;
+        sqe->fd        = conn.fd;
+        sqe->ioprio    = IORING_RECV_MULTISHOT;
+        sqe->flags     = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = ProvidedBuffers::kGroup;
+        sqe->user_data = tag(Op::Recv, conn.id);
+        conn.recvArmed = true;
+    }
+
+    void received(Connection& conn, const io_uring_cqe& cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE)) conn.recvArmed = false;
+
+        if (cqe.res > 0) {
+            const auto bid = static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            conn.latency.arrived(read_tsc());
+            if (!conn.closing) consume(conn, {m_recvBuffers.data(bid), static_cast<std::size_t>(cqe.res)});
+            m_recvBuffers.recycle(bid);
+        } else if (cqe.res == 0) {
+            return close(conn, "Client closed connection.");
+        } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+            errno = -cqe.res;
+            std::perror("recv");
+            return close(conn, "Client connection error.");
+        }
+
+        // Multishot stops when buffers run dry (re-arm once they're back) or
+        // when we cancelled it for back-pressure (re-armed by wrote()).
+        if (!conn.recvArmed && !conn.paused && !conn.closing) armRecv(conn);
+    }
+
+    void consume(Connection& conn, std::string_view chunk) {
+        // Common case: nothing partial pending, so parse straight out of the
+        // provided buffer and copy only the unterminated tail.
+        if (conn.rx.empty()) {
+            const std::size_t consumed = process_input(chunk, conn.session, conn.tx, m_scratch, &conn.latency);
+            conn.rx.assign(chunk.substr(consumed));
+        } else {
+            conn.rx.append(chunk);
+            const std::size_t consumed = process_input(conn.rx, conn.session, conn.tx, m_scratch, &conn.latency);
+            conn.rx.erase(0, consumed);
+        }
+        startWrite(conn);
+
+        if (conn.backlog() >= m_config.maxTxBacklog && conn.recvArmed && !conn.paused) {
+            conn.paused = true;
+            cancel(conn);
+        }
+    }
+
+    void startWrite(Connection& conn) {
+        if (conn.writing || conn.closing || conn.txTaken == conn.tx.size()) return;
+        if (conn.slot == kNoSlot && !m_freeSlots.empty()) {
+            conn.slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+
+        io_uring_sqe* sqe = m_ring.sqe();
+        if (!sqe) return close(conn, "Client connection error.");
+        const std::size_t pending = conn.tx.size() - conn.txTaken;
+        if (conn.slot != kNoSlot) {
+            char* const buf = sendBuffer(conn.slot);
+            conn.writeLen = std::min(pending, m_config.sendBufferSize);
+            std::memcpy(buf, conn.tx.data() + conn.txTaken, conn.writeLen);
+            conn.txTaken += conn.writeLen;
+            sqe->opcode    = IORING_OP_WRITE_FIXED;
+            sqe->addr      = reinterpret_cast<std::uint64_t>(buf);
+            sqe->buf_index = static_cast<std::uint16_t>(conn.slot);
+        } else {
+            // Hand the whole pending tx to the kernel; new responses go to a
+            // fresh buffer (the old inflight's, to keep its capacity).
+            conn.tx.erase(0, conn.txTaken);
+            conn.inflight.swap(conn.tx);
+            conn.tx.clear();
+            conn.writeLen  = conn.inflight.size();
+            sqe->opcode    = IORING_OP_SEND;
+            sqe->addr      = reinterpret_cast<std::uint64_t>(conn.inflight.data());
+            sqe->msg_flags = MSG_NOSIGNAL;
+        }
+        conn.writeLatency = conn.latency;
+        if (conn.txTaken == conn.tx.size()) {
+            conn.tx.clear();
+            conn.txTaken = 0;
+            conn.latency.received = 0;  // all of it is in this write now
+        }
+        sqe->fd        = conn.fd;
+        sqe->len       = static_cast<std::uint32_t>(conn.writeLen);
+        sqe->user_data = tag(Op::Write, conn.id);
+        conn.writeDone = 0;
+        conn.writing   = true;
+    }
+
+    void wrote(Connection& conn, const io_uring_cqe& cqe) {
+        conn.writing = false;
+        if (conn.closing) return;
+        if (cqe.res < 0 && cqe.res != -EAGAIN && cqe.res != -EINTR) {
+            if (cqe.res != -EPIPE && cqe.res != -ECONNRESET) {
+                errno = -cqe.res;
+                std::perror("send");
+            }
+            return close(conn, "Client connection error.");
+        }
+
+        conn.writeDone += static_cast<std::size_t>(std::max(cqe.res, 0));
+        if (conn.writeDone < conn.writeLen) {
+            resumeWrite(conn);  // short write: push out the rest first
+            return;
+        }
+        conn.writeLen = conn.writeDone = 0;
+        conn.writeLatency.sent(m_stats);
+        startWrite(conn);
+
+        if (conn.paused && conn.backlog() < m_config.maxTxBacklog) {
+            conn.paused = false;
+            if (!conn.recvArmed) armRecv(conn);
+        }
+    }
+
+    void resumeWrite(Connection& conn) {
+        io_uring_sqe* sqe = m_ring.sqe();
+        if (!sqe) return close(conn, "Client connection error.");
+        const char* base = conn.slot != kNoSlot ? sendBuffer(conn.slot) : conn.inflight.data();
+        sqe->opcode = conn.slot != kNoSlot ? IORING_OP_WRITE_FIXED : IORING_OP_SEND;
+        if (conn.slot != kNoSlot) sqe->buf_index = static_cast<std::uint16_t>(conn.slot);
+        else                      sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->fd        = conn.fd;
+        sqe->addr      = reinterpret_cast<std::uint64_t>(base + conn.writeDone);
+        sqe->len       = static_cast<std::uint32_t>(conn.writeLen - conn.writeDone);
+        sqe->user_data = tag(Op::Write, conn.id);
+        conn.writing   = true;
+    }
+
+    void cancel(Connection& conn) {
+        io_uring_sqe* sqe = m_ring.sqe();
+        if (!sqe) return;
+        sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+        sqe->addr      = tag(Op::Recv, conn.id);
+        sqe->user_data = tag(Op::Cancel, conn.id);
+    }
+
+    /// Begin closing: shutting the socket down terminates the multishot recv
+    /// and any write in flight. The connection is freed by reapIfDone() once
+    /// the kernel no longer references its buffers.
+    void close(Connection& conn, const char* why) {
+        if (conn.closing) return;
+        conn.closing = true;
+        ::shutdown(conn.fd, SHUT_RDWR);
+        if (conn.recvArmed) cancel(conn);
+        logln("{} ({} open)", why, m_conns.size() - 1);
+    }
+
+    void reapIfDone(Connection& conn) {
+        if (!conn.closing || conn.recvArmed || conn.writing) return;
+        ::close(conn.fd);
+        if (conn.slot != kNoSlot) m_freeSlots.push_back(conn.slot);
+        m_conns.erase(conn.id);  // destroys conn
+    }
+
+    [[nodiscard]] char* sendBuffer(int slot) const noexcept {
+        return m_sendData.get() + static_cast<std::size_t>(slot) * m_config.sendBufferSize;
+    }
+
+    int                                                            m_listenFd;
+    const SessionFactory&                                          m_sessions;
+    IoUringServerConfig                                            m_config;
+    ProvidedBuffers                                                m_recvBuffers;
+    std::unique_ptr<char[]>                                        m_sendData;   // registered send buffers, back to back
+    std::vector<int>                                               m_freeSlots;  // unclaimed registered send buffers
+    CommandBatch                                                   m_scratch;    // parse scratch, shared by all connections
+    LatencyStats&                                                  m_stats = thread_latency_stats();
+    std::unordered_map<std::uint32_t, std::unique_ptr<Connection>> m_conns;
+    std::uint32_t                                                  m_nextConn = 0;
+    Ring                                                           m_ring;  // last: torn down (cancelling
+                                                                            // in-flight I/O) before the buffers
+};
+
+}  // namespace
+
+bool io_uring_supported() noexcept {
+    ProvidedBuffers buffers;  // declared first: outlives the ring and its armed recv
+    Ring ring;
+    if (!ring.open(4)) return false;
+
+    // Every opcode the server submits...
+    constexpr unsigned kOps = 256;
+    std::vector<char> raw(sizeof(io_uring_probe) + kOps * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(raw.data());
+    if (sys_io_uring_register(ring.fd(), IORING_REGISTER_PROBE, probe, kOps) < 0) return false;
+    const auto supported = [&](unsigned op) {
+        return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    };
+    if (!supported(IORING_OP_ACCEPT) || !supported(IORING_OP_RECV) || !supported(IORING_OP_SEND) ||
+        !supported(IORING_OP_WRITE_FIXED) || !supported(IORING_OP_ASYNC_CANCEL))
+        return false;
+
+    // ...a provided-buffer ring (5.19)...
+    if (!buffers.open(ring, 1, 64)) return false;
+
+    // ...and multishot recv drawing from it (6.0, the newest feature used).
+    // Older kernels reject the unknown ioprio flag with -EINVAL; a live
+    // multishot recv answers with IORING_CQE_F_MORE set.
+    int pair[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) return false;
+    bool multishot = false;
+    if (io_uring_sqe* sqe = ring.sqe()) {
+        sqe->opcode    = IORING_OP_RECV;
+        sqe->fd        = pair[0];
+        sqe->ioprio    = IORING_RECV_MULTISHOT;
+        sqe->flags     = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = ProvidedBuffers::kGroup;
+        const __kernel_timespec timeout{.tv_sec = 1, .tv_nsec = 0};
+        if (::send(pair[1], "x", 1, MSG_NOSIGNAL) == 1 && ring.submit(1, &timeout) >= 0) {
+            ring.reap([&](const io_uring_cqe& cqe) {
+                multishot = cqe.res == 1 && (cqe.flags & IORING_CQE_F_MORE);
+            });
+        }
+    }
+    ::close(pair[0]);
+    ::close(pair[1]);
+    return multishot;  // the ring's teardown cancels the still-armed recv
+}
+
+int run_io_uring_server(int listenFd, const SessionFactory& sessions,
+                        const IoUringServerConfig& config, std::stop_token stop) {
+    // WRITE_FIXED has no MSG_NOSIGNAL; keep a dead peer's SIGPIPE pending on
+    // this thread instead of killing the process (main also ignores it).
+    sigset_t pipe, saved;
+    sigemptyset(&pipe);
+    sigaddset(&pipe, SIGPIPE);
+    ::pthread_sigmask(SIG_BLOCK, &pipe, &saved);
+
+    int rc = 1;
+    {
+        IoUringServer server{listenFd, sessions, config};
+        if (server.open()) rc = server.run(stop);
+    }
+    const timespec now{};
+    while (::sigtimedwait(&pipe, nullptr, &now) == SIGPIPE) {}  // discard before unblocking
+    ::pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+    return rc;
+}
+
+#else  // no io_uring headers: the transport is never available
+
+bool io_uring_supported() noexcept { return false; }
+
+int run_io_uring_server(int, const SessionFactory&, const IoUringServerConfig&, std::stop_token) {
+    logln("io_uring support was not compiled in.");
+    return 1;
+}
+
+#endif
@@ -0,0 +1,215 @@
+#include "BinaryProtocol.hpp"
+#include "Journal.hpp"
+#include "Log.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <concepts>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace {
+
+[[nodiscard]] std::string journal_header() {
+    std::string header{kJournalMagic};
+    const std::uint32_t fields[2] = {to_wire(kJournalVersion), 0};
+    header.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+    return header;
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// JournalReader
+// ---------------------------------------------------------------------------
+
+JournalReader::JournalReader(std::string data) noexcept
+    : m_data{std::move(data)}, m_pos{m_data.empty() ? 0 : kJournalHeaderSize} {}
+
+std::optional<JournalReader> JournalReader::load(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) return JournalReader{std::string{}};
+        std::perror(path.c_str());
+        return std::nullopt;
+    }
+    std::string data;
+    struct stat st{};
+    if (::fstat(fd, &st) == 0) data.reserve(static_cast<std::size_t>(st.st_size));
+    char chunk[64 * 1024];
+    for (;;) {
+        const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n > 0) {
+            data.append(chunk, static_cast<std::size_t>(n));
+        } else if (n == 0) {
+            break;
+        } else if (errno != EINTR) {
+            std::perror(path.c_str());
+            ::close(fd);
+            return std::nullopt;
+        }
+    }
+    ::close(fd);
+
+    const std::string header = journal_header();
+    if (data.size() < kJournalHeaderSize) {
+        // Only a crash while creating the file leaves a short header.
+        if (header.starts_with(data)) return JournalReader{std::string{}};
+    } else if (std::string_view{data}.starts_with(header)) {
+        return JournalReader{std::move(data)};
+    }
+    logln("{}: not a version {} journal.", path, kJournalVersion);
+    return std::nullopt;
+}
+
+std::optional<Command> JournalReader::next() noexcept {
+    const std::string_view rest = std::string_view{m_data}.substr(m_pos);
+    const std::size_t n = binary_message_size(rest);
+    if (n == 0) return std::nullopt;
+    auto command = decode_message(rest.substr(0, n));
+    if (command) {  // a malformed record ends the valid prefix
+        m_pos += n;
+        ++m_records;
+    }
+    return command;
+}
+
+bool JournalReader::skip(std::uint64_t records) noexcept {
+    while (m_records < records)
+        if (!next()) return false;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Journal
+// ---------------------------------------------------------------------------
+
+std::unique_ptr<Journal> Journal::open(const std::string& path, const Config& config) {
+    auto reader = JournalReader::load(path);
+    if (!reader) return nullptr;
+    while (reader->next()) {}
+
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::perror(path.c_str());
+        return nullptr;
+    }
+    // Drop a torn final record (or a torn header) so appends follow the last
+    // whole record.
+    if (::ftruncate(fd, static_cast<off_t>(reader->validBytes())) < 0) {
+        std::perror("ftruncate");
+        ::close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<Journal> journal{new Journal{fd, config, reader->records()}};
+    if (reader->validBytes() == 0 && (!journal->writeAll(journal_header()) || !journal->sync())) return nullptr;
+    journal->m_writer = std::jthread{[j = journal.get()](std::stop_token stop) { j->run(stop); }};
+    return journal;
+}
+
+Journal::Journal(int fd, const Config& config, std::uint64_t records)
+    : m_fd{fd}, m_config{config}, m_ring{config.ringCapacity}, m_appended{records}, m_durable{records} {}
+
+Journal::~Journal() {
+    if (m_writer.joinable()) {
+        m_writer.request_stop();
+        m_writer.join();  // the writer's last pass syncs everything appended
+    }
+    ::close(m_fd);
+}
+
+void Journal::flush() noexcept {
+    m_flushTarget.store(m_appended, std::memory_order_relaxed);
+    SpinBackoff backoff;
+    while (durable() < m_appended && healthy()) backoff.idle();
+}
+
+void Journal::run(std::stop_token stop) {
+    using Clock = std::chrono::steady_clock;
+
+    std::string   batch;
+    std::uint64_t written  = durable();  // records already in the file
+    std::size_t   unsynced = 0;
+    auto          lastSync = Clock::now();
+
+    // Idle passes spent spinning (SpinBackoff) before sleeping between them.
+    constexpr unsigned kSpinningPasses = 1024;
+
+    SpinBackoff backoff;
+    unsigned    idlePasses = 0;
+    for (;;) {
+        // Sample the stop flag first: the producer has stopped appending by
+        // then, so the drain below is guaranteed to see its final records.
+        const bool stopping = stop.stop_requested();
+
+        batch.clear();
+        const std::size_t n = m_ring.drain([&batch](const Command& command) {
+            std::visit([&batch](const auto& c) {
+                using T = std::remove_cvref_t<decltype(c)>;
+                if constexpr (std::same_as<T, SubmitCommand>)      encode_submit(batch, c.order, c.symbol);
+                else if constexpr (std::same_as<T, CancelCommand>) encode_cancel(batch, c.id, c.symbol);
+                else if constexpr (std::same_as<T, ModifyCommand>)
+                    encode_modify(batch, c.id, c.price, c.quantity, c.symbol);
+            }, command);
+        });
+        if (n != 0 && healthy()) {  // after a failure, records are only drained
+            if (!writeAll(batch)) m_failed.store(true, std::memory_order_relaxed);
+            written  += n;
+            unsynced += n;
+        }
+
+        if (unsynced != 0 && healthy()) {
+            const auto now = Clock::now();
+            const bool due = m_config.sync == Sync::None || unsynced >= m_config.syncBatch ||
+                             now - lastSync >= m_config.syncInterval ||
+                             m_flushTarget.load(std::memory_order_relaxed) > durable() || stopping;
+            if (due) {
+                if (!sync()) m_failed.store(true, std::memory_order_relaxed);
+                if (healthy()) m_durable.store(written, std::memory_order_release);
+                unsynced = 0;
+                lastSync = now;
+            }
+        }
+
+        if (stopping && n == 0) return;
+        if (n != 0) {
+            backoff.reset();
+            idlePasses = 0;
+        } else if (++idlePasses < kSpinningPasses) {
+            backoff.idle();
+        } else {
+            std::this_thread::sleep_for(m_config.syncInterval);
+        }
+    }
+}
+
+bool Journal::writeAll(std::string_view bytes) noexcept {
+    while (!bytes.empty()) {
+        const ssize_t n = ::write(m_fd, bytes.data(), bytes.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::perror("journal write");
+            return false;
+        }
+        bytes.remove_prefix(static_cast<std::size_t>(n));
+    }
+    return true;
+}
+
+bool Journal::sync() noexcept {
+    int rc = 0;
+    switch (m_config.sync) {
+        using enum Sync;
+        case None: return true;
+        case Data: rc = ::fdatasync(m_fd); break;
+        case Full: rc = ::fsync(m_fd);     break;
+    }
+    if (rc < 0) std::perror("journal sync");
+    return rc == 0;
+}
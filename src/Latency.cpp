@@ -0,0 +1,121 @@
+#include "Latency.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::array<const char*, kLatencyStages> kStageNames{"parse", "match", "send", "total"};
+
+/// Every thread's LatencyStats. Threads register on first use and fold their
+/// counts into `retired` when they exit, so a snapshot still covers them.
+struct LatencyRegistry {
+    std::mutex                 mutex;
+    std::vector<LatencyStats*> live;
+    LatencyStats               retired;
+};
+
+LatencyRegistry& registry() {
+    static LatencyRegistry instance;  // never destroyed before a thread_local that uses it
+    return instance;
+}
+
+class ThreadLatency {
+public:
+    ThreadLatency() : m_stats{std::make_unique<LatencyStats>()} {
+        LatencyRegistry& r = registry();
+        const std::lock_guard lock{r.mutex};
+        r.live.push_back(m_stats.get());
+    }
+
+    ~ThreadLatency() {
+        LatencyRegistry& r = registry();
+        const std::lock_guard lock{r.mutex};
+        std::erase(r.live, m_stats.get());
+        for (std::size_t s = 0; s < kLatencyStages; ++s) r.retired.stages[s].merge(m_stats->stages[s]);
+    }
+
+    ThreadLatency(const ThreadLatency&)            = delete;
+    ThreadLatency& operator=(const ThreadLatency&) = delete;
+
+    [[nodiscard]] LatencyStats& stats() noexcept { return *m_stats; }
+
+private:
+    std::unique_ptr<LatencyStats> m_stats;  // 60 KiB: kept off the TLS block
+};
+
+}  // namespace
+
+double tsc_ticks_per_ns() {
+    static const double rate = [] {
+        using Clock = std::chrono::steady_clock;
+        const auto          t0 = Clock::now();
+        const std::uint64_t c0 = read_tsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        const std::uint64_t c1 = read_tsc();
+        const auto          ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+        return ns > 0 && c1 > c0 ? static_cast<double>(c1 - c0) / static_cast<double>(ns) : 1.0;
+    }();
+    return rate;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) noexcept {
+    std::uint64_t added = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        const std::uint64_t n = other.m_counts[i].load(std::memory_order_relaxed);
+        if (n == 0) continue;
+        m_counts[i].store(m_counts[i].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        added += n;
+    }
+    // The bucket sum, not other.count(): a concurrent record() may have
+    // bumped one but not yet the other.
+    m_count.store(count() + added, std::memory_order_relaxed);
+    m_max.store(std::max(max(), other.max()), std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::percentile(double percent) const noexcept {
+    const std::uint64_t total = count();
+    if (total == 0) return 0;
+    const auto rank = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(std::ceil(std::clamp(percent, 0.0, 100.0) / 100.0 * static_cast<double>(total))));
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += m_counts[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(highest(i), max());
+    }
+    return max();
+}
+
+LatencyStats& thread_latency_stats() {
+    thread_local ThreadLatency self;
+    return self.stats();
+}
+
+void latency_snapshot(LatencyStats& out) {
+    LatencyRegistry& r = registry();
+    const std::lock_guard lock{r.mutex};
+    for (std::size_t s = 0; s < kLatencyStages; ++s) {
+        out.stages[s].merge(r.retired.stages[s]);
+        for (const LatencyStats* stats : r.live) out.stages[s].merge(stats->stages[s]);
+    }
+}
+
+void format_latency_stats(const LatencyStats& stats, std::string& out) {
+    const double perNs = tsc_ticks_per_ns();
+    const auto   ns    = [perNs](std::uint64_t ticks) {
+        return static_cast<std::uint64_t>(static_cast<double>(ticks) / perNs + 0.5);
+    };
+    for (std::size_t s = 0; s < kLatencyStages; ++s) {
+        const LatencyHistogram& h = stats.stages[s];
+        std::format_to(std::back_inserter(out), "STATS {} n={} p50={} p90={} p99={} p99.9={} max={}\n",
+                       kStageNames[s], h.count(), ns(h.percentile(50)), ns(h.percentile(90)),
+                       ns(h.percentile(99)), ns(h.percentile(99.9)), ns(h.max()));
+    }
+}
@@ -0,0 +1,110 @@
+#include "LineScanner.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+namespace {
+
+struct BlockMasks {
+    std::uint64_t space;    // ' ', '\t', '\n', '\v', '\f', '\r'
+    std::uint64_t newline;  // '\n'
+};
+
+/// Classify the 64 bytes at `p`.
+[[nodiscard]] BlockMasks classify(const char* p) noexcept {
+#if defined(__AVX2__)
+    const __m256i nl   = _mm256_set1_epi8('\n');
+    const __m256i sp   = _mm256_set1_epi8(' ');
+    const __m256i tab  = _mm256_set1_epi8('\t');
+    const __m256i four = _mm256_set1_epi8(4);
+    std::uint64_t space = 0, newline = 0;
+    for (int half = 0; half < 2; ++half) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * half));
+        // '\t'..'\r' are contiguous: (v - '\t') <= 4 as unsigned bytes.
+        const __m256i off  = _mm256_sub_epi8(v, tab);
+        const __m256i ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(off, four), off);
+        const __m256i ws   = _mm256_or_si256(ctrl, _mm256_cmpeq_epi8(v, sp));
+        space   |= std::uint64_t{static_cast<std::uint32_t>(_mm256_movemask_epi8(ws))} << (32 * half);
+        newline |= std::uint64_t{static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)))}
+                   << (32 * half);
+    }
+    return {space, newline};
+#elif defined(__SSE2__)
+    const __m128i nl   = _mm_set1_epi8('\n');
+    const __m128i sp   = _mm_set1_epi8(' ');
+    const __m128i tab  = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+    std::uint64_t space = 0, newline = 0;
+    for (int quarter = 0; quarter < 4; ++quarter) {
+        const __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * quarter));
+        const __m128i off  = _mm_sub_epi8(v, tab);
+        const __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(off, four), off);
+        const __m128i ws   = _mm_or_si128(ctrl, _mm_cmpeq_epi8(v, sp));
+        space   |= std::uint64_t{static_cast<std::uint16_t>(_mm_movemask_epi8(ws))} << (16 * quarter);
+        newline |= std::uint64_t{static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)))}
+                   << (16 * quarter);
+    }
+    return {space, newline};
+#else
+    BlockMasks m{0, 0};
+    for (unsigned i = 0; i < 64; ++i) {
+        const auto c = static_cast<unsigned char>(p[i]);
+        if (c == ' ' || static_cast<unsigned>(c - '\t') <= 4u) m.space |= std::uint64_t{1} << i;
+        if (c == '\n')                  m.newline |= std::uint64_t{1} << i;
+    }
+    return m;
+#endif
+}
+
+}  // namespace
+
+void ChunkIndex::build(std::string_view chunk) {
+    m_chunk = chunk;
+    m_newlines.clear();
+    m_tokens.clear();
+
+    std::size_t   open = 0;  // tokens whose end is not yet known start here
+    std::uint64_t prev = 0;  // word (non-space) bit of the previous byte, in bit 0
+    for (std::size_t offset = 0; offset < chunk.size(); offset += 64) {
+        const std::size_t n = std::min<std::size_t>(chunk.size() - offset, 64);
+        BlockMasks m;
+        if (n == 64) {
+            m = classify(chunk.data() + offset);
+        } else {
+            char tail[64];
+            std::memset(tail, ' ', sizeof(tail));  // padding ends the last token
+            std::memcpy(tail, chunk.data() + offset, n);
+            m = classify(tail);
+        }
+
+        const std::uint64_t word   = ~m.space;
+        const std::uint64_t before = (word << 1) | prev;  // bit i: byte i-1 is a word byte
+        prev = word >> 63;
+
+        for (std::uint64_t b = word & ~before; b != 0; b &= b - 1)
+            m_tokens.push_back({static_cast<std::uint32_t>(offset + static_cast<std::size_t>(std::countr_zero(b))), 0});
+        for (std::uint64_t e = ~word & before; e != 0; e &= e - 1)
+            m_tokens[open++].end = static_cast<std::uint32_t>(offset + static_cast<std::size_t>(std::countr_zero(e)));
+        for (std::uint64_t nl = m.newline; nl != 0; nl &= nl - 1)
+            m_newlines.push_back(static_cast<std::uint32_t>(offset + static_cast<std::size_t>(std::countr_zero(nl))));
+    }
+    // A chunk ending in a full block mid-token: that token runs to the end.
+    if (open < m_tokens.size()) m_tokens[open].end = static_cast<std::uint32_t>(chunk.size());
+}
+
+std::string_view line_scanner_isa() noexcept {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
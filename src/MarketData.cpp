@@ -0,0 +1,28 @@
+#include "MarketData.hpp"
+
+#include <algorithm>
+#include <ranges>
+
+void DepthBook::apply(const LevelUpdateEvent& update) {
+    std::vector<DepthLevel>& levels = levelsOf(update.side);
+    // Worst-first: ascending for bids, descending for asks.
+    const auto worse = [buy = update.side == Side::Buy](Price a, Price b) { return buy ? a < b : a > b; };
+
+    const auto it    = std::ranges::lower_bound(levels, update.price, worse, &DepthLevel::price);
+    const bool found = it != levels.end() && it->price == update.price;
+
+    if (update.quantity == 0) {
+        if (found) levels.erase(it);
+    } else if (found) {
+        it->quantity = update.quantity;
+    } else {
+        levels.insert(it, DepthLevel{update.price, update.quantity});
+    }
+}
+
+std::size_t DepthBook::top(Side side, std::span<DepthLevel> out) const noexcept {
+    const std::vector<DepthLevel>& levels = levelsOf(side);
+    const std::size_t n = std::min(out.size(), levels.size());
+    std::ranges::copy(levels | std::views::reverse | std::views::take(n), out.begin());
+    return n;
+}
@@ -0,0 +1,147 @@
+#include "Log.hpp"
+#include "MarketDataRing.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+namespace {
+
+[[nodiscard]] constexpr std::size_t ring_bytes(std::size_t capacity) noexcept {
+    return sizeof(FeedRingHeader) + capacity * sizeof(FeedSlot);
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// MarketDataRing
+// ---------------------------------------------------------------------------
+
+std::unique_ptr<MarketDataRing> MarketDataRing::create(const std::string& path, std::size_t capacity) {
+    capacity = std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity);
+    const std::size_t bytes = ring_bytes(capacity);
+
+    // A new inode rather than truncating in place: a reader still mapping the
+    // old file would fault on the vanished pages.
+    if (::unlink(path.c_str()) < 0 && errno != ENOENT) {
+        std::perror(path.c_str());
+        return nullptr;
+    }
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(bytes)) < 0) {
+        std::perror(path.c_str());
+        if (fd >= 0) ::close(fd);
+        return nullptr;
+    }
+    void* const base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::perror("mmap");
+        return nullptr;
+    }
+    return std::unique_ptr<MarketDataRing>{new MarketDataRing{base, bytes, capacity}};
+}
+
+MarketDataRing::MarketDataRing(void* base, std::size_t bytes, std::size_t capacity) noexcept
+    : m_base{base},
+      m_bytes{bytes},
+      m_header{::new (base) FeedRingHeader{}},
+      m_slots{reinterpret_cast<FeedSlot*>(static_cast<char*>(base) + sizeof(FeedRingHeader))},
+      m_mask{capacity - 1} {
+    // The file is zero-filled, which is already every slot's "never written"
+    // state; only the header needs filling in, magic last.
+    m_header->version  = kFeedVersion;
+    m_header->slotSize = sizeof(FeedSlot);
+    m_header->capacity = capacity;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(m_header->magic, kFeedMagic.data(), sizeof(m_header->magic));
+}
+
+MarketDataRing::~MarketDataRing() { ::munmap(m_base, m_bytes); }
+
+// ---------------------------------------------------------------------------
+// MarketDataReader
+// ---------------------------------------------------------------------------
+
+std::unique_ptr<MarketDataReader> MarketDataReader::open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::perror(path.c_str());
+        return nullptr;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) < 0) {
+        std::perror(path.c_str());
+        ::close(fd);
+        return nullptr;
+    }
+    const auto bytes = static_cast<std::size_t>(st.st_size);
+    void* const base = bytes >= sizeof(FeedRingHeader)
+                           ? ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0)
+                           : MAP_FAILED;
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        logln("{}: not a market-data ring.", path);
+        return nullptr;
+    }
+
+    const auto* header = static_cast<const FeedRingHeader*>(base);
+    const std::uint64_t capacity = header->capacity;
+    if (std::string_view{header->magic, sizeof(header->magic)} != kFeedMagic || header->version != kFeedVersion ||
+        header->slotSize != sizeof(FeedSlot) || !std::has_single_bit(capacity) || ring_bytes(capacity) != bytes) {
+        logln("{}: not a version {} market-data ring.", path, kFeedVersion);
+        ::munmap(base, bytes);
+        return nullptr;
+    }
+    return std::unique_ptr<MarketDataReader>{new MarketDataReader{base, bytes}};
+}
+
+MarketDataReader::MarketDataReader(const void* base, std::size_t bytes) noexcept
+    : m_base{base},
+      m_bytes{bytes},
+      m_header{static_cast<const FeedRingHeader*>(base)},
+      m_slots{reinterpret_cast<const FeedSlot*>(static_cast<const char*>(base) + sizeof(FeedRingHeader))},
+      m_mask{m_header->capacity - 1},
+      m_next{m_header->published.load(std::memory_order_acquire) + 1} {}
+
+MarketDataReader::~MarketDataReader() { ::munmap(const_cast<void*>(m_base), m_bytes); }
+
+std::uint64_t MarketDataReader::oldest() const noexcept {
+    // The slot after the newest one may be mid-rewrite; skip it too.
+    const std::uint64_t head = m_header->published.load(std::memory_order_acquire);
+    return head > m_mask ? head - m_mask + 1 : 1;
+}
+
+void MarketDataReader::rewind() noexcept { m_next = oldest(); }
+
+MarketDataReader::Poll MarketDataReader::poll(FeedRecord& out) noexcept {
+    const std::uint64_t want = m_next;
+    const FeedSlot&     slot = m_slots[(want - 1) & m_mask];
+
+    if (slot.words[0].load(std::memory_order_acquire) == want) {
+        std::array<std::uint64_t, kFeedWords> words;
+        words[0] = want;
+        for (std::size_t i = 1; i < kFeedWords; ++i) words[i] = slot.words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.words[0].load(std::memory_order_relaxed) == want) {
+            out = std::bit_cast<FeedRecord>(words);
+            ++m_next;
+            return Poll::Record;
+        }
+    }
+
+    // Not readable: either not written yet, or already overwritten — the
+    // latter once the producer has started on `want` + capacity.
+    const std::uint64_t head = m_header->published.load(std::memory_order_acquire);
+    if (head < want + m_mask) return Poll::Empty;
+    if (slot.words[0].load(std::memory_order_acquire) == want) return Poll::Empty;  // raced the store; retry
+    m_next  = oldest();
+    m_lost += m_next - want;
+    return Poll::Overrun;
+}
@@ -1,10 +1,15 @@
+#include "BinaryProtocol.hpp"
+#include "Journal.hpp"
+#include "MarketDataRing.hpp"
 #include "Protocol.hpp"
 
 #include <cctype>
 #include <charconv>
 #include <concepts>
 #include <optional>
+#include <span>
 #include <string_view>
+#include <utility>
 
 namespace {
 
@@ -18,15 +23,19 @@ public:
     explicit constexpr Tokenizer(std::string_view line) noexcept : m_rest{line} {}
 
     [[nodiscard]] constexpr std::optional<std::string_view> next() noexcept {
+        const auto token = peek();
+        if (token) m_rest.remove_prefix(token->size());
+        return token;
+    }
+
+    /// The next token without consuming it.
+    [[nodiscard]] constexpr std::optional<std::string_view> peek() noexcept {
         skipSpace();
         if (m_rest.empty()) return std::nullopt;
 
         std::size_t len = 0;
         while (len < m_rest.size() && !is_space(m_rest[len])) ++len;
-
-        const auto token = m_rest.substr(0, len);
-        m_rest.remove_prefix(len);
-        return token;
+        return m_rest.substr(0, len);
     }
 
     /// True iff nothing but whitespace remains.
@@ -43,6 +52,31 @@ private:
     std::string_view m_rest;
 };
 
+/// Tokenizer over one line's tokens from a ChunkIndex: boundaries were found
+/// for the whole chunk up front, so each token is a lookup, not a scan.
+class IndexedTokenizer {
+public:
+    IndexedTokenizer(const ChunkIndex& index, std::span<const ChunkIndex::Token> tokens) noexcept
+        : m_index{&index}, m_rest{tokens} {}
+
+    [[nodiscard]] std::optional<std::string_view> next() noexcept {
+        const auto token = peek();
+        if (token) m_rest = m_rest.subspan(1);
+        return token;
+    }
+
+    [[nodiscard]] std::optional<std::string_view> peek() const noexcept {
+        if (m_rest.empty()) return std::nullopt;
+        return m_index->text(m_rest.front());
+    }
+
+    [[nodiscard]] bool exhausted() const noexcept { return m_rest.empty(); }
+
+private:
+    const ChunkIndex*                  m_index;
+    std::span<const ChunkIndex::Token> m_rest;
+};
+
 /// Parse an entire token as an integer; rejects partial matches like "12x".
 template <std::integral T>
 [[nodiscard]] std::optional<T> parse_int(std::string_view token) noexcept {
@@ -64,72 +98,358 @@ template <std::integral T>
     }
 }
 
-}  // namespace
+/// Order type named by an optional trailing SUBMIT operand.
+[[nodiscard]] std::optional<OrderType> parse_order_type(std::string_view token) noexcept {
+    using enum OrderType;
+    if (token == "IOC")    return ImmediateOrCancel;
+    if (token == "FOK")    return FillOrKill;
+    if (token == "MARKET") return Market;
+    if (token == "POST")   return PostOnly;
+    return std::nullopt;
+}
 
-std::expected<Command, ParseError> parse_command(std::string_view line) noexcept {
-    Tokenizer tokens{line};
+/// Self-trade prevention mode named by a SUBMIT STP= operand.
+[[nodiscard]] std::optional<SelfTradePrevention> parse_stp(std::string_view token) noexcept {
+    using enum SelfTradePrevention;
+    if (token == "NEWEST")    return CancelNewest;
+    if (token == "OLDEST")    return CancelOldest;
+    if (token == "BOTH")      return CancelBoth;
+    if (token == "DECREMENT") return Decrement;
+    return std::nullopt;
+}
+
+/// Consume SUBMIT's optional trailing operands into `order`: an order type,
+/// then ACCT=<account> and STP=<mode> in either order, each at most once.
+/// False on anything else.
+template <class Tokens>
+[[nodiscard]] bool parse_submit_options(Tokens& tokens, Order& order) noexcept {
+    auto token = tokens.next();
+    if (token && !token->contains('=')) {
+        const auto type = parse_order_type(*token);
+        if (!type) return false;
+        order.type = *type;
+        token = tokens.next();
+    }
 
+    bool account = false;
+    bool stp     = false;
+    for (; token; token = tokens.next()) {
+        if (token->starts_with("ACCT=") && !std::exchange(account, true)) {
+            const auto value = parse_int<Account>(token->substr(5));
+            if (!value) return false;
+            order.account = *value;
+        } else if (token->starts_with("STP=") && !std::exchange(stp, true)) {
+            const auto mode = parse_stp(token->substr(4));
+            if (!mode) return false;
+            order.stp = *mode;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Consume an optional leading symbol operand: kNoSymbol if the next token is
+/// not symbol-shaped, nullopt if it is but cannot be encoded (e.g. too long).
+template <class Tokens>
+[[nodiscard]] std::optional<SymbolCode> parse_symbol_operand(Tokens& tokens) noexcept {
+    const auto token = tokens.peek();
+    if (!token || !is_symbol_lead(token->front())) return kNoSymbol;
+    static_cast<void>(tokens.next());
+    return encode_symbol(*token);
+}
+
+/// The grammar, shared by the per-line and the batched (indexed) parsers.
+template <class Tokens>
+[[nodiscard]] std::expected<Command, ParseError> parse_tokens(Tokens& tokens) noexcept {
     const auto cmd = tokens.next();
     if (!cmd) return std::unexpected{ParseError::Empty};
 
     if (*cmd == "SUBMIT") {
+        const auto symbol  = parse_symbol_operand(tokens);
         const auto id      = parse_int<OrderId>(tokens.next().value_or(""));
         const auto sideTok = tokens.next();
         const auto price   = parse_int<Price>(tokens.next().value_or(""));
         const auto qty     = parse_int<Quantity>(tokens.next().value_or(""));
 
-        if (!id || !sideTok || !price || !qty || !tokens.exhausted())
+        Order order{.id = id.value_or(0), .side = Side::Buy, .price = price.value_or(0), .quantity = qty.value_or(0)};
+        if (!symbol || !id || !sideTok || !price || !qty || !parse_submit_options(tokens, order))
             return std::unexpected{ParseError::BadSubmit};
 
         const auto side = parse_side(*sideTok);
         if (!side) return std::unexpected{ParseError::BadSide};
+        order.side = *side;
 
-        return SubmitCommand{Order{.id = *id, .side = *side, .price = *price, .quantity = *qty}};
+        return SubmitCommand{order, *symbol};
     }
 
     if (*cmd == "CANCEL") {
-        const auto id = parse_int<OrderId>(tokens.next().value_or(""));
-        if (!id || !tokens.exhausted())
+        const auto symbol = parse_symbol_operand(tokens);
+        const auto id     = parse_int<OrderId>(tokens.next().value_or(""));
+        if (!symbol || !id || !tokens.exhausted())
             return std::unexpected{ParseError::BadCancel};
-        return CancelCommand{*id};
+        return CancelCommand{*id, *symbol};
+    }
+
+    if (*cmd == "MODIFY") {
+        const auto symbol = parse_symbol_operand(tokens);
+        const auto id     = parse_int<OrderId>(tokens.next().value_or(""));
+        const auto price  = parse_int<Price>(tokens.next().value_or(""));
+        const auto qty    = parse_int<Quantity>(tokens.next().value_or(""));
+        if (!symbol || !id || !price || !qty || !tokens.exhausted())
+            return std::unexpected{ParseError::BadModify};
+        return ModifyCommand{*id, *price, *qty, *symbol};
     }
 
     if (*cmd == "DUMP") {
-        if (!tokens.exhausted())
+        const auto symbol = parse_symbol_operand(tokens);
+        if (!symbol || !tokens.exhausted())
             return std::unexpected{ParseError::UnknownCommand};
-        return DumpCommand{};
+        return DumpCommand{*symbol};
     }
 
     return std::unexpected{ParseError::UnknownCommand};
 }
 
-bool process_line(std::string_view line, MatchingEngine& engine, std::string& response) {
-    response.clear();
+}  // namespace
+
+std::expected<Command, ParseError> parse_command(std::string_view line) noexcept {
+    Tokenizer tokens{line};
+    return parse_tokens(tokens);
+}
+
+std::span<const std::expected<Command, ParseError>> parse_commands(std::string_view chunk, CommandBatch& batch) {
+    batch.index.build(chunk);
+    batch.commands.clear();
+
+    const auto all = batch.index.tokens();
+    std::size_t first = 0;
+    for (const std::uint32_t nl : batch.index.newlines()) {
+        std::size_t last = first;
+        while (last < all.size() && all[last].begin < nl) ++last;
+        IndexedTokenizer tokens{batch.index, all.subspan(first, last - first)};
+        batch.commands.push_back(parse_tokens(tokens));
+        first = last;
+    }
+    batch.consumed = batch.index.newlines().empty() ? 0 : batch.index.newlines().back() + 1;
+    return batch.commands;
+}
+
+namespace {
 
-    const auto parsed = parse_command(line);
+/// Wire text for a parse failure (nullptr for a blank line).
+[[nodiscard]] constexpr const char* parse_error_reply(ParseError e) noexcept {
+    switch (e) {
+        using enum ParseError;
+        case Empty:          return nullptr;  // no-op, nothing to send
+        case BadSubmit:      return "ERR BAD_SUBMIT\n";
+        case BadSide:        return "ERR BAD_SIDE\n";
+        case BadCancel:      return "ERR BAD_CANCEL\n";
+        case BadModify:      return "ERR BAD_MODIFY\n";
+        case UnknownCommand: return "ERR UNKNOWN_CMD\n";
+    }
+    std::unreachable();  // C++23: all enumerators handled above
+}
+
+/// Shared route -> journal -> apply -> format (-> publish) path, appending
+/// to `out`. `resolve` maps a command's symbol to the book it targets, or
+/// nullptr if not hosted.
+template <class Resolve>
+bool dispatch(const std::expected<Command, ParseError>& parsed, Resolve&& resolve, std::string& out,
+              Journal* journal = nullptr, MarketDataRing* feed = nullptr, MessageThrottle* throttle = nullptr) {
     if (!parsed) {
-        switch (parsed.error()) {
-            using enum ParseError;
-            case Empty:          return false;  // no-op, nothing to send
-            case BadSubmit:      response = "ERR BAD_SUBMIT\n";  return true;
-            case BadSide:        response = "ERR BAD_SIDE\n";    return true;
-            case BadCancel:      response = "ERR BAD_CANCEL\n";  return true;
-            case UnknownCommand: response = "ERR UNKNOWN_CMD\n"; return true;
-        }
-        std::unreachable();  // C++23: all enumerators handled above
+        const char* const reply = parse_error_reply(parsed.error());
+        if (!reply) return false;
+        out += reply;
+        return true;
+    }
+    if (const auto id = command_id(*parsed); id && journal && !journal->healthy()) {
+        FormattingSink{out}(RejectEvent{*id, RejectReason::JournalFailed});
+        return true;
+    }
+    if (const auto id = throttled_id(*parsed); id && throttle && !throttle->admit()) {
+        FormattingSink{out}(RejectEvent{*id, RejectReason::Throttled});
+        return true;
     }
 
     std::visit([&](const auto& command) {
+        MatchingEngine* const engine = resolve(command.symbol);
+        if (!engine) {
+            out += "ERR UNKNOWN_SYMBOL\n";
+            return;
+        }
+
         using T = std::remove_cvref_t<decltype(command)>;
         if constexpr (std::same_as<T, SubmitCommand>) {
-            engine.submit(command.order, FormattingSink{response});
+            if (journal) journal->append(command);
+            with_feed(feed, command.symbol, FormattingSink{out},
+                      [&](auto&& sink) { engine->submit(command.order, sink); });
         } else if constexpr (std::same_as<T, CancelCommand>) {
-            engine.cancel(command.id, FormattingSink{response});
+            if (journal) journal->append(command);
+            with_feed(feed, command.symbol, FormattingSink{out},
+                      [&](auto&& sink) { engine->cancel(command.id, sink); });
+        } else if constexpr (std::same_as<T, ModifyCommand>) {
+            if (journal) journal->append(command);
+            with_feed(feed, command.symbol, FormattingSink{out}, [&](auto&& sink) {
+                engine->modify(command.id, command.price, command.quantity, sink);
+            });
         } else {
             static_assert(std::same_as<T, DumpCommand>);
-            response = engine.dump();
+            out += engine->dump();
         }
     }, *parsed);
 
     return true;
 }
+
+[[nodiscard]] auto registry_resolver(BookRegistry& books) noexcept {
+    return [&books](SymbolCode symbol) noexcept { return books.find(symbol); };
+}
+
+}  // namespace
+
+bool process_line(std::string_view line, MatchingEngine& engine, std::string& response) {
+    response.clear();
+    return dispatch(parse_command(line), [&engine](SymbolCode symbol) noexcept {
+        return symbol == kNoSymbol ? &engine : nullptr;
+    }, response);
+}
+
+bool process_line(std::string_view line, BookRegistry& books, std::string& response) {
+    response.clear();
+    return dispatch(parse_command(line), registry_resolver(books), response);
+}
+
+bool process_command(const std::expected<Command, ParseError>& parsed, BookRegistry& books, std::string& out,
+                     Journal* journal, MarketDataRing* feed, MessageThrottle* throttle) {
+    return dispatch(parsed, registry_resolver(books), out, journal, feed, throttle);
+}
+
+// ---------------------------------------------------------------------------
+// ShardedSession
+// ---------------------------------------------------------------------------
+
+ShardedSession::ShardedSession(ShardedEngine& engine, std::uint32_t session, Journal* journal,
+                               std::uint32_t messagesPerSecond)
+    : m_engine{&engine},
+      m_journal{journal},
+      m_throttle{messagesPerSecond},
+      m_session{session},
+      m_outstanding(engine.shardCount(), 0),
+      m_pending(engine.shardCount()) {}
+
+bool ShardedSession::command(const std::expected<Command, ParseError>& parsed, std::string& tx) {
+    if (!parsed) {
+        const char* const reply = parse_error_reply(parsed.error());
+        if (!reply) return false;
+        tx += reply;
+        return true;
+    }
+
+    if (const auto* dump = std::get_if<DumpCommand>(&*parsed)) {
+        const auto route = m_engine->route(dump->symbol);
+        if (!route) {
+            tx += "ERR UNKNOWN_SYMBOL\n";
+            return true;
+        }
+        flush(tx);
+        tx += m_engine->book(*route).dump();
+        return true;
+    }
+
+    if (const auto id = command_id(*parsed); id && m_journal && !m_journal->healthy()) {
+        FormattingSink{tx}(RejectEvent{*id, RejectReason::JournalFailed});
+        return true;
+    }
+    if (const auto id = throttled_id(*parsed); id && !m_throttle.admit()) {
+        FormattingSink{tx}(RejectEvent{*id, RejectReason::Throttled});
+        return true;
+    }
+    if (!post(*parsed)) tx += "ERR UNKNOWN_SYMBOL\n";
+    return true;
+}
+
+void ShardedSession::message(std::string_view msg, std::string& tx) {
+    const BinarySink sink{tx};
+    const auto command = decode_message(msg);
+    if (!command) {
+        sink.reject(0, RejectCode::BadMessage);
+        return;
+    }
+    if (const auto id = command_id(*command); id && m_journal && !m_journal->healthy()) {
+        sink(RejectEvent{*id, RejectReason::JournalFailed});
+        return;
+    }
+    if (const auto id = throttled_id(*command); id && !m_throttle.admit()) {
+        sink(RejectEvent{*id, RejectReason::Throttled});
+        return;
+    }
+    if (!post(*command)) {
+        const OrderId id = std::visit([](const auto& c) -> OrderId {
+            using T = std::remove_cvref_t<decltype(c)>;
+            if constexpr (std::same_as<T, SubmitCommand>)    return c.order.id;
+            else if constexpr (std::same_as<T, DumpCommand>) return 0;  // not expressible in binary
+            else                                              return c.id;
+        }, *command);
+        sink.reject(id, RejectCode::UnknownSymbol);
+    }
+}
+
+void ShardedSession::flush(std::string& tx) {
+    SpinBackoff backoff;
+    for (ShardId shard = 0; shard < m_outstanding.size(); ++shard) {
+        while (m_outstanding[shard] != 0) {
+            const std::size_t before = m_outstanding[shard];
+            drain(shard);
+            if (m_outstanding[shard] == before) backoff.idle();
+        }
+        tx += m_pending[shard];
+        m_pending[shard].clear();
+    }
+}
+
+bool ShardedSession::post(const Command& command) {
+    return std::visit([&](const auto& c) {
+        const auto route = m_engine->route(c.symbol);
+        if (!route) return false;
+
+        using T = std::remove_cvref_t<decltype(c)>;
+        if constexpr (!std::same_as<T, DumpCommand>) {
+            if (m_journal) m_journal->append(c);
+        }
+        if constexpr (std::same_as<T, SubmitCommand>) {
+            enqueue(route->shard, ShardRequest{ShardRequest::Kind::Submit, m_session, route->book, c.order});
+        } else if constexpr (std::same_as<T, CancelCommand>) {
+            enqueue(route->shard, ShardRequest{ShardRequest::Kind::Cancel, m_session, route->book,
+                                               Order{.id = c.id, .side = Side::Buy, .price = 0, .quantity = 0}});
+        } else if constexpr (std::same_as<T, ModifyCommand>) {
+            enqueue(route->shard, ShardRequest{ShardRequest::Kind::Modify, m_session, route->book,
+                                               Order{.id = c.id, .side = Side::Buy, .price = c.price,
+                                                     .quantity = c.quantity}});
+        } else {
+            static_assert(std::same_as<T, DumpCommand>);
+            std::unreachable();  // handled synchronously by line()
+        }
+        return true;
+    }, command);
+}
+
+void ShardedSession::enqueue(ShardId shard, const ShardRequest& request) {
+    SpinBackoff backoff;
+    while (!m_engine->tryPost(shard, request)) {
+        drain(shard);  // the shard may be blocked on its output queue
+        backoff.idle();
+    }
+    ++m_outstanding[shard];
+}
+
+void ShardedSession::drain(ShardId shard) {
+    const auto encodeWith = [&](const auto& sink) {
+        m_engine->poll(shard, [&](const ShardEvent& e) {
+            std::visit(sink, e.event);
+            if (e.terminal) --m_outstanding[shard];
+        });
+    };
+    if (m_format == WireFormat::Binary) encodeWith(BinarySink{m_pending[shard]});
+    else                                encodeWith(FormattingSink{m_pending[shard]});
+}
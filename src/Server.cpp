@@ -0,0 +1,97 @@
+#include "Server.hpp"
+
+#include "Latency.hpp"
+
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace {
+
+constexpr std::string_view kStatsCommand = "STATS";
+
+/// `line` without surrounding blanks.
+[[nodiscard]] std::string_view trimmed(std::string_view line) noexcept {
+    const auto first = line.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) return {};
+    const auto last = line.find_last_not_of(" \t\r");
+    return line.substr(first, last - first + 1);
+}
+
+}  // namespace
+
+std::size_t process_input(std::string_view rx, Session& session, std::string& tx, CommandBatch& scratch,
+                          PendingLatency* latency) {
+    return std::visit([&](auto& s) {
+        std::size_t   pos  = 0;
+        std::uint64_t mark = latency ? latency->chunk : 0;
+
+        // One vectorised pass frames and tokenizes every complete line; walk
+        // them via offsets — no per-line find('\n'), and no erase of the
+        // front of the buffer (which would be O(n^2) under batched input).
+        if (s.format() == WireFormat::Text) {
+            const auto commands = parse_commands(rx, scratch);
+            const auto newlines = scratch.index.newlines();
+            if (latency) {
+                const std::uint64_t parsed = read_tsc();
+                thread_latency_stats().record(LatencyStage::Parse, parsed - mark);
+                mark = parsed;
+            }
+            for (std::size_t i = 0; i < commands.size(); ++i) {
+                const std::string_view line = rx.substr(pos, newlines[i] - pos);
+                pos = newlines[i] + 1;
+                const auto& parsed = commands[i];
+                if (!parsed && parsed.error() == ParseError::UnknownCommand) {
+                    const std::string_view word = trimmed(line);
+                    if (word == kBinaryHello) {
+                        s.flush(tx);  // text responses so far stay text
+                        tx += kBinaryHelloReply;
+                        s.setFormat(WireFormat::Binary);
+                        break;  // the rest of rx is binary; its text parse is discarded
+                    }
+                    if (word == kStatsCommand) {
+                        s.flush(tx);
+                        LatencyStats stats;
+                        latency_snapshot(stats);
+                        format_latency_stats(stats, tx);
+                        continue;
+                    }
+                }
+                s.command(parsed, tx);
+            }
+        }
+
+        if (s.format() == WireFormat::Binary) {
+            for (;;) {
+                const std::size_t n = binary_message_size(rx.substr(pos));
+                if (n == 0) break;
+                s.message(rx.substr(pos, n), tx);
+                pos += n;
+            }
+        }
+
+        s.flush(tx);
+        if (latency) {
+            latency->matched = read_tsc();
+            thread_latency_stats().record(LatencyStage::Match, latency->matched - mark);
+            if (tx.empty() && pos == rx.size()) latency->received = 0;  // nothing to answer, nothing pending
+        }
+        return pos;
+    }, session);
+}
+
+std::size_t replay_journal(JournalReader& journal, Session& session) {
+    return std::visit([&journal](auto& s) {
+        std::string discard;
+        std::size_t replayed = 0;
+        while (const auto command = journal.next()) {
+            s.command(*command, discard);
+            if (++replayed % 4096 == 0) {  // bound the responses buffered meanwhile
+                s.flush(discard);
+                discard.clear();
+            }
+        }
+        s.flush(discard);
+        return replayed;
+    }, session);
+}
@@ -0,0 +1,99 @@
+#include "Log.hpp"
+#include "ShardedEngine.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <concepts>
+#include <thread>
+
+namespace {
+
+/// Fibonacci-mix the packed symbol so adjacent tickers spread over shards.
+[[nodiscard]] ShardId shard_of(SymbolCode symbol, std::size_t shards) noexcept {
+    return static_cast<ShardId>(((symbol * 0x9E3779B97F4A7C15ull) >> 32) % shards);
+}
+
+void pin_to_cpu(int cpu) noexcept {
+    const unsigned cpus = std::thread::hardware_concurrency();
+    if (cpu < 0 || cpus == 0) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<unsigned>(cpu) % cpus, &set);
+    if (const int rc = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set); rc != 0)
+        logln("pthread_setaffinity_np(cpu {}) failed: {}", cpu, rc);
+}
+
+}  // namespace
+
+ShardedEngine::ShardedEngine(std::span<const SymbolCode> symbols, const Config& config) {
+    const std::size_t shards = config.shards ? config.shards : 1;
+
+    std::vector<std::size_t> booksPerShard(shards, 0);
+    m_routes.reserve(symbols.size() + 1);
+    m_routes.emplace(kNoSymbol, ShardRoute{0, 0});
+    booksPerShard[0] = 1;
+    for (const SymbolCode symbol : symbols) {
+        if (symbol == kNoSymbol || m_routes.contains(symbol)) continue;
+        const ShardId shard = shard_of(symbol, shards);
+        m_routes.emplace(symbol, ShardRoute{shard, static_cast<std::uint32_t>(booksPerShard[shard]++)});
+    }
+
+    std::latch ready{static_cast<std::ptrdiff_t>(shards)};
+    m_shards.reserve(shards);
+    for (std::size_t i = 0; i < shards; ++i) {
+        auto& shard = *m_shards.emplace_back(std::make_unique<Shard>(config.queueCapacity));
+        const int cpu = config.firstCpu < 0 ? -1 : config.firstCpu + static_cast<int>(i);
+        shard.thread = std::jthread{run, std::ref(shard), booksPerShard[i],
+                                    config.ordersPerBook, config.risk, cpu, std::ref(ready)};
+    }
+    ready.wait();
+}
+
+ShardedEngine::~ShardedEngine() {
+    for (auto& shard : m_shards) shard->thread.request_stop();
+    // jthread members join on destruction.
+}
+
+void ShardedEngine::run(std::stop_token stop, Shard& shard, std::size_t bookCount,
+                        std::size_t ordersPerBook, const RiskLimits& risk, int cpu, std::latch& ready) {
+    pin_to_cpu(cpu);
+
+    // Books are allocated here, after pinning, so their memory is first
+    // touched by (and local to) the core that will use it.
+    shard.books.reserve(bookCount);
+    for (std::size_t i = 0; i < bookCount; ++i)
+        shard.books.push_back(std::make_unique<MatchingEngine>(ordersPerBook, risk));
+    ready.count_down();
+
+    std::uint32_t session = 0;
+    OrderId       request = 0;
+    const auto emit = [&shard, &session, &request]<class E>(const E& event)
+        requires std::constructible_from<EngineEvent, const E&>  // trade events only, no market data
+    {
+        bool terminal = false;  // fills, and cancels of other orders, come first
+        if constexpr (!std::same_as<E, FillEvent>) terminal = event.id == request;
+        SpinBackoff backoff;
+        while (!shard.out.tryPush(ShardEvent{session, event, terminal})) backoff.idle();
+    };
+
+    SpinBackoff backoff;
+    while (!stop.stop_requested()) {
+        const std::size_t n = shard.in.drain([&](const ShardRequest& req) {
+            session = req.session;
+            request = req.order.id;
+            MatchingEngine& book = *shard.books[req.book];
+            switch (req.kind) {
+                using enum ShardRequest::Kind;
+                case Submit: book.submit(req.order, emit);    return;
+                case Cancel: book.cancel(req.order.id, emit); return;
+                case Modify:
+                    book.modify(req.order.id, req.order.price, req.order.quantity, emit);
+                    return;
+            }
+        });
+        if (n) backoff.reset();
+        else   backoff.idle();
+    }
+}
@@ -0,0 +1,275 @@
+#include "BinaryProtocol.hpp"
+#include "Log.hpp"
+#include "Snapshot.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <ranges>
+
+namespace {
+
+/// Owns a file descriptor.
+class UniqueFd {
+public:
+    explicit UniqueFd(int fd) noexcept : m_fd{fd} {}
+    ~UniqueFd() {
+        if (m_fd >= 0) ::close(m_fd);
+    }
+    UniqueFd(const UniqueFd&)            = delete;
+    UniqueFd& operator=(const UniqueFd&) = delete;
+
+    [[nodiscard]] int get() const noexcept { return m_fd; }
+
+private:
+    int m_fd;
+};
+
+/// Owns an mmap()ed region.
+class Mapping {
+public:
+    Mapping(int fd, std::size_t size, int prot, int flags) noexcept
+        : m_size{size}, m_addr{size ? ::mmap(nullptr, size, prot, flags, fd, 0) : MAP_FAILED} {}
+    ~Mapping() {
+        if (m_addr != MAP_FAILED) ::munmap(m_addr, m_size);
+    }
+    Mapping(const Mapping&)            = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    [[nodiscard]] explicit operator bool() const noexcept { return m_addr != MAP_FAILED; }
+    [[nodiscard]] char* data() const noexcept { return static_cast<char*>(m_addr); }
+
+private:
+    std::size_t m_size;
+    void*       m_addr;
+};
+
+template <class T>
+void store(char*& out, const T& record) noexcept {
+    std::memcpy(out, &record, sizeof(T));
+    out += sizeof(T);
+}
+
+/// Bounds-checked sequential reads from the mapped image.
+class ImageReader {
+public:
+    ImageReader(const char* data, std::size_t size) noexcept : m_pos{data}, m_end{data + size} {}
+
+    template <class T>
+    [[nodiscard]] bool take(T& out) noexcept {
+        if (remaining() < sizeof(T)) return false;
+        std::memcpy(&out, m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return true;
+    }
+
+    /// Claim `n` records of type T; nullptr if the image is too short.
+    template <class T>
+    [[nodiscard]] const char* takeArray(std::uint64_t n) noexcept {
+        if (n > remaining() / sizeof(T)) return nullptr;
+        const char* const first = m_pos;
+        m_pos += n * sizeof(T);
+        return first;
+    }
+
+private:
+    [[nodiscard]] std::size_t remaining() const noexcept { return static_cast<std::size_t>(m_end - m_pos); }
+
+    const char* m_pos;
+    const char* m_end;
+};
+
+/// Write one book (header, then its levels best-first per side, then its
+/// account positions); returns one past the last byte written.
+char* write_book(char* out, SymbolCode symbol, const MatchingEngine& book) {
+    char* const   bookAt  = out;
+    std::uint64_t levels  = 0;
+    char*         levelAt = nullptr;
+    SnapshotLevel level{};
+    const auto closeLevel = [&] {
+        if (!levelAt) return;
+        SnapshotLevel wire = level;
+        wire.price  = to_wire(level.price);
+        wire.orders = to_wire(level.orders);
+        store(levelAt, wire);
+    };
+
+    out += sizeof(SnapshotBook);
+    book.forEachResting([&](const Order& o) {
+        if (!levelAt || o.side != level.side || o.price != level.price) {
+            closeLevel();
+            levelAt = out;
+            out += sizeof(SnapshotLevel);
+            level = SnapshotLevel{o.price, 0, o.side, {}};
+            ++levels;
+        }
+        ++level.orders;
+        store(out, SnapshotOrder{to_wire(o.id), to_wire(o.quantity), to_wire(o.account), o.stp, {}});
+    });
+    closeLevel();
+
+    std::uint64_t positions = 0;
+    book.risk().forEachAccount([&](Account account, Quantity position) {
+        store(out, SnapshotPosition{to_wire(position), to_wire(account), 0});
+        ++positions;
+    });
+
+    char* at = bookAt;
+    store(at, SnapshotBook{to_wire(symbol), to_wire(levels), to_wire<std::uint64_t>(book.openOrders()),
+                           to_wire(positions)});
+    return out;
+}
+
+/// Restore one book's levels from `in`; false if the image is malformed.
+[[nodiscard]] bool read_book(ImageReader& in, const SnapshotBook& header, MatchingEngine& book) {
+    const std::uint64_t levels = from_wire(header.levels);
+    const std::uint64_t orders = from_wire(header.orders);
+    book.reserve(orders);
+
+    std::uint64_t restored = 0;
+    for (std::uint64_t l = 0; l < levels; ++l) {
+        SnapshotLevel level;
+        if (!in.take(level)) return false;
+        const Price         price = from_wire(level.price);
+        const std::uint32_t count = from_wire(level.orders);
+        if (count == 0 || (level.side != Side::Buy && level.side != Side::Sell)) return false;
+
+        // restoreLevel() refuses a level that breaks its preconditions, so a
+        // damaged image cannot corrupt the book; an unknown stp mode is
+        // handed over as quantity 0 for it to refuse the same way.
+        const char* const records = in.takeArray<SnapshotOrder>(count);
+        if (!records) return false;
+        const bool intact = book.restoreLevel(
+            std::views::iota(std::uint32_t{0}, count) | std::views::transform([&](std::uint32_t i) {
+                SnapshotOrder r;
+                std::memcpy(&r, records + std::size_t{i} * sizeof(SnapshotOrder), sizeof(r));
+                const bool known = r.stp <= SelfTradePrevention::Decrement;
+                return Order{.id       = from_wire(r.id),
+                             .side     = level.side,
+                             .stp      = known ? r.stp : SelfTradePrevention::None,
+                             .account  = from_wire(r.account),
+                             .price    = price,
+                             .quantity = known ? from_wire(r.quantity) : 0};
+            }));
+        if (!intact) return false;
+        restored += count;
+    }
+    if (restored != orders) return false;
+
+    const std::uint64_t positions = from_wire(header.positions);
+    const char* const   records   = in.takeArray<SnapshotPosition>(positions);
+    if (!records) return false;
+    for (std::uint64_t i = 0; i < positions; ++i) {
+        SnapshotPosition p;
+        std::memcpy(&p, records + i * sizeof(SnapshotPosition), sizeof(p));
+        book.restorePosition(from_wire(p.account), from_wire(p.position));
+    }
+    return true;
+}
+
+}  // namespace
+
+bool write_snapshot(const std::string& path, const BookRegistry& books, std::uint64_t journalRecords) {
+    // Size for the worst case — every order on a level of its own — and trim
+    // to what was written; untouched pages of the sparse file cost nothing.
+    std::size_t bound = sizeof(SnapshotHeader);
+    for (SymbolId id = 0; id < books.size(); ++id) {
+        const MatchingEngine& book = books.book(id);
+        bound += sizeof(SnapshotBook) + book.openOrders() * (sizeof(SnapshotLevel) + sizeof(SnapshotOrder));
+        book.risk().forEachAccount([&bound](Account, Quantity) { bound += sizeof(SnapshotPosition); });
+    }
+
+    const std::string tmp = path + ".tmp";
+    const UniqueFd fd{::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+    if (fd.get() < 0 || ::ftruncate(fd.get(), static_cast<off_t>(bound)) < 0) {
+        std::perror(tmp.c_str());
+        return false;
+    }
+
+    std::size_t used = 0;
+    {
+        const Mapping image{fd.get(), bound, PROT_READ | PROT_WRITE, MAP_SHARED};
+        if (!image) {
+            std::perror("mmap");
+            return false;
+        }
+        SnapshotHeader header{};
+        std::memcpy(header.magic, kSnapshotMagic.data(), sizeof(header.magic));
+        header.version        = to_wire(kSnapshotVersion);
+        header.books          = to_wire(static_cast<std::uint32_t>(books.size()));
+        header.journalRecords = to_wire(journalRecords);
+
+        char* out = image.data();
+        store(out, header);
+        for (SymbolId id = 0; id < books.size(); ++id) out = write_book(out, books.symbol(id), books.book(id));
+        used = static_cast<std::size_t>(out - image.data());
+    }  // unmapped: dirty pages stay in the page cache for the sync below
+
+    if (::ftruncate(fd.get(), static_cast<off_t>(used)) < 0 || ::fdatasync(fd.get()) < 0) {
+        std::perror(tmp.c_str());
+        return false;
+    }
+    if (::rename(tmp.c_str(), path.c_str()) < 0) {
+        std::perror(path.c_str());
+        return false;
+    }
+    // Make the rename itself durable.
+    const std::filesystem::path parent = std::filesystem::absolute(path).parent_path();
+    if (const UniqueFd dir{::open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)}; dir.get() >= 0)
+        ::fsync(dir.get());
+    return true;
+}
+
+std::optional<std::uint64_t> load_snapshot(const std::string& path, BookRegistry& books) {
+    const UniqueFd fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd.get() < 0) {
+        if (errno == ENOENT) return 0;
+        std::perror(path.c_str());
+        return std::nullopt;
+    }
+    struct stat st{};
+    if (::fstat(fd.get(), &st) < 0) {
+        std::perror(path.c_str());
+        return std::nullopt;
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+
+    const Mapping image{fd.get(), size, PROT_READ, MAP_PRIVATE | MAP_POPULATE};
+    if (size != 0 && !image) {
+        std::perror("mmap");
+        return std::nullopt;
+    }
+    ImageReader in{image ? image.data() : nullptr, image ? size : 0};
+
+    SnapshotHeader header;
+    if (!in.take(header) || std::string_view{header.magic, sizeof(header.magic)} != kSnapshotMagic ||
+        from_wire(header.version) != kSnapshotVersion) {
+        logln("{}: not a version {} snapshot.", path, kSnapshotVersion);
+        return std::nullopt;
+    }
+
+    for (std::uint32_t b = 0; b < from_wire(header.books); ++b) {
+        SnapshotBook book;
+        if (!in.take(book)) {
+            logln("{}: truncated snapshot.", path);
+            return std::nullopt;
+        }
+        const SymbolCode symbol = from_wire(book.symbol);
+        MatchingEngine&  engine = books.book(symbol == kNoSymbol ? BookRegistry::kDefaultBook : books.add(symbol));
+        if (engine.openOrders() != 0) {
+            logln("{}: restoring into a book that is not empty.", path);
+            return std::nullopt;
+        }
+        if (!read_book(in, book, engine)) {
+            logln("{}: malformed snapshot.", path);
+            return std::nullopt;
+        }
+    }
+    return from_wire(header.journalRecords);
+}
@@ -1,104 +1,207 @@
+#include "BookRegistry.hpp"
+#include "Journal.hpp"
+#include "Latency.hpp"
 #include "Log.hpp"
-#include "MatchingEngine.hpp"
-#include "Protocol.hpp"
+#include "MarketDataRing.hpp"
+#include "Server.hpp"
+#include "ShardedEngine.hpp"
+#include "Snapshot.hpp"
+#include "Symbol.hpp"
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
-#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
-#include <cerrno>
 #include <charconv>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
 #include <cstdint>
 #include <csignal>
 #include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 /**
- * Single-threaded TCP server for the text protocol.
+ * TCP server for the text protocol.
  *
- * Serves one client at a time but keeps accepting new connections; the order
- * book persists across reconnects. Responses for each received chunk are
- * batched into a single send() to cut syscall count, and TCP_NODELAY is set
- * so small request/response exchanges aren't delayed by Nagle's algorithm.
+ *   marketDataHandlerLL [port] [--symbols FILE] [--shards N] [--io-uring]
+ *                       [--journal FILE [--journal-sync none|data|full]] [--snapshot FILE]
+ *                       [--feed FILE] [--max-qty N] [--max-notional N] [--collar TICKS]
+ *                       [--max-open-orders N] [--max-position N] [--max-rate N]
+ *                       [--stats-interval SECONDS]
+ *
+ * Serves any number of concurrent clients from one network thread — an
+ * edge-triggered epoll loop (EpollServer.cpp) by default, or io_uring
+ * (IoUringServer.cpp) with --io-uring; all of them trade against the same
+ * books, which persist across reconnects. One process hosts every instrument listed
+ * in the symbols file (one per line) plus the default book used by commands
+ * without a symbol. By default all books are matched inline on the network
+ * thread; --shards N spreads them over N pinned ShardedEngine threads.
+ *
+ * With --journal, every SUBMIT, CANCEL and MODIFY that reaches a book is
+ * recorded in FILE, whether the book accepts or rejects it (group-committed
+ * with fdatasync by default), and replayed into the books on the next start,
+ * so resting orders survive a restart. With --snapshot (inline
+ * matching only), startup restores the books from a snapshot, replays only
+ * the journal records after it, and writes a fresh snapshot before serving.
+ *
+ * With --feed (inline matching only), fills and L2/L3 book updates are
+ * published to a shared-memory ring at FILE (e.g. /dev/shm/engine.feed) for
+ * local consumers; see MarketDataRing.hpp and tools/feed_tail.cpp.
+ *
+ * The --max-* and --collar flags set the pre-trade risk limits every book
+ * enforces on the matching thread (see RiskLimits in MatchingEngine.hpp);
+ * --max-rate caps each session's SUBMIT/MODIFY messages per second. All
+ * default to 0, meaning no limit.
+ *
+ * Hot-path latency (recv -> parse -> match -> send, per received chunk) is
+ * always recorded; clients read it with STATS, and --stats-interval logs it
+ * every SECONDS seconds.
  */
 
 namespace {
 
 constexpr std::uint16_t kDefaultPort = 6767;
 
-/// send() the whole buffer, retrying on EINTR. Returns false on hard error.
-[[nodiscard]] bool send_all(int fd, std::string_view data) noexcept {
-    while (!data.empty()) {
-        const ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
-        if (n < 0) {
-            if (errno == EINTR) continue;
-            std::perror("send");
-            return false;
-        }
-        data.remove_prefix(static_cast<std::size_t>(n));
-    }
-    return true;
-}
+struct Options {
+    std::uint16_t port          = kDefaultPort;
+    const char*   symbolsFile   = nullptr;
+    std::size_t   shards        = 0;  // 0 = match inline on the network thread
+    bool          ioUring       = false;
+    const char*   journalFile   = nullptr;
+    Journal::Sync journalSync   = Journal::Sync::Data;
+    const char*   snapshotFile  = nullptr;
+    const char*   feedFile      = nullptr;
+    RiskLimits    risk          = {};
+    std::uint32_t maxRate       = 0;  // per-session SUBMIT/MODIFY per second; 0 = unlimited
+    std::uint32_t statsInterval = 0;  // seconds between latency dumps; 0 = none
+};
 
-/// Pump one client connection until it closes or errors.
-void serve_client(int client_fd, MatchingEngine& engine) {
-    std::string rxBuf;       // unparsed bytes carried across recv() calls
-    std::string txBuf;       // batched responses for the current chunk
-    std::string response;    // per-line scratch, reused
-    rxBuf.reserve(4096);
-    txBuf.reserve(4096);
-
-    char chunk[4096];
-
-    for (;;) {
-        const ssize_t n = ::recv(client_fd, chunk, sizeof(chunk), 0);
-        if (n == 0) {
-            logln("Client closed connection.");
-            return;
-        }
-        if (n < 0) {
-            if (errno == EINTR) continue;
-            std::perror("recv");
-            return;
-        }
+[[nodiscard]] std::optional<Journal::Sync> parse_sync(std::string_view arg) noexcept {
+    if (arg == "none") return Journal::Sync::None;
+    if (arg == "data") return Journal::Sync::Data;
+    if (arg == "full") return Journal::Sync::Full;
+    return std::nullopt;
+}
 
-        rxBuf.append(chunk, static_cast<std::size_t>(n));
+template <std::integral T>
+[[nodiscard]] std::optional<T> parse_number(std::string_view arg) noexcept {
+    T value{};
+    const auto [ptr, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    if (ec != std::errc{} || ptr != arg.data() + arg.size()) return std::nullopt;
+    return value;
+}
 
-        // Walk complete lines via an offset — no per-line erase of the front
-        // of the buffer (which would be O(n^2) under batched input).
-        std::size_t lineStart = 0;
-        for (;;) {
-            const std::size_t nl = rxBuf.find('\n', lineStart);
-            if (nl == std::string::npos) break;
+/// Set the risk or rate limit named by `flag`; false if `flag` is not one
+/// or `value` is not a number.
+[[nodiscard]] bool parse_limit(std::string_view flag, std::string_view value, Options& opts) noexcept {
+    const auto set = [value]<class T>(T& limit) {
+        const auto n = parse_number<T>(value);
+        if (!n || std::cmp_less(*n, 0)) return false;
+        limit = *n;
+        return true;
+    };
+    if (flag == "--max-qty")         return set(opts.risk.maxQuantity);
+    if (flag == "--max-notional")    return set(opts.risk.maxNotional);
+    if (flag == "--collar")          return set(opts.risk.collar);
+    if (flag == "--max-open-orders") return set(opts.risk.maxOpenOrders);
+    if (flag == "--max-position")    return set(opts.risk.maxPosition);
+    if (flag == "--max-rate")        return set(opts.maxRate);
+    return false;
+}
 
-            const std::string_view line{rxBuf.data() + lineStart, nl - lineStart};
-            lineStart = nl + 1;
+[[nodiscard]] Options parse_options(int argc, char** argv) {
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        const char* const value = i + 1 < argc ? argv[i + 1] : nullptr;
 
-            if (process_line(line, engine, response)) {
-                txBuf += response;
-            }
+        if (arg == "--symbols" && value) {
+            opts.symbolsFile = value;
+            ++i;
+        } else if (arg == "--shards" && value) {
+            if (const auto n = parse_number<std::size_t>(value)) opts.shards = *n;
+            else logln("Ignoring invalid shard count '{}'.", value);
+            ++i;
+        } else if (arg == "--journal" && value) {
+            opts.journalFile = value;
+            ++i;
+        } else if (arg == "--journal-sync" && value) {
+            if (const auto sync = parse_sync(value)) opts.journalSync = *sync;
+            else logln("Ignoring invalid journal sync mode '{}'.", value);
+            ++i;
+        } else if (arg == "--snapshot" && value) {
+            opts.snapshotFile = value;
+            ++i;
+        } else if (arg == "--feed" && value) {
+            opts.feedFile = value;
+            ++i;
+        } else if ((arg.starts_with("--max-") || arg == "--collar") && value) {
+            if (!parse_limit(arg, value, opts)) logln("Ignoring invalid {} '{}'.", arg, value);
+            ++i;
+        } else if (arg == "--stats-interval" && value) {
+            if (const auto n = parse_number<std::uint32_t>(value)) opts.statsInterval = *n;
+            else logln("Ignoring invalid stats interval '{}'.", value);
+            ++i;
+        } else if (arg == "--io-uring") {
+            opts.ioUring = true;
+        } else if (const auto port = parse_number<std::uint16_t>(arg); port && *port != 0) {
+            opts.port = *port;
+        } else {
+            logln("Ignoring argument '{}'.", arg);
         }
-        rxBuf.erase(0, lineStart);  // keep only the trailing partial line
+    }
+    return opts;
+}
+
+/// Read every symbol in `path` (one per line, blank lines ignored).
+[[nodiscard]] std::optional<std::vector<SymbolCode>> load_symbols(const char* path) {
+    std::ifstream in{path};
+    if (!in) {
+        std::perror(path);
+        return std::nullopt;
+    }
+    std::vector<SymbolCode> symbols;
+    std::string line;
+    while (std::getline(in, line)) {
+        const auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        const auto last = line.find_last_not_of(" \t\r");
+        const std::string_view name{line.data() + first, last - first + 1};
 
-        if (!txBuf.empty()) {
-            if (!send_all(client_fd, txBuf)) return;
-            txBuf.clear();
+        const auto code = encode_symbol(name);
+        if (!code) {
+            logln("Ignoring invalid symbol '{}'.", name);
+            continue;
         }
+        symbols.push_back(*code);
     }
+    return symbols;
 }
 
-[[nodiscard]] std::uint16_t parse_port(int argc, char** argv) noexcept {
-    if (argc > 1) {
-        const std::string_view arg{argv[1]};
-        std::uint16_t port{};
-        const auto [ptr, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), port);
-        if (ec == std::errc{} && ptr == arg.data() + arg.size() && port != 0) return port;
-        logln("Ignoring invalid port '{}', using {}.", arg, kDefaultPort);
+/// Log the latency histograms every `interval` until stopped.
+void dump_latency(std::stop_token stop, std::chrono::seconds interval) {
+    std::mutex                  mutex;
+    std::condition_variable_any wake;
+    std::unique_lock            lock{mutex};
+    while (!wake.wait_for(lock, stop, interval, [] { return false; }) && !stop.stop_requested()) {
+        LatencyStats stats;
+        latency_snapshot(stats);
+        std::string report;
+        format_latency_stats(stats, report);
+        report.pop_back();  // logln adds the last newline
+        logln("{}", report);
     }
-    return kDefaultPort;
 }
 
 }  // namespace
@@ -107,7 +210,68 @@ int main(int argc, char** argv) {
     // Belt and braces with MSG_NOSIGNAL: never die on writes to a closed peer.
     std::signal(SIGPIPE, SIG_IGN);
 
-    const std::uint16_t port = parse_port(argc, argv);
+    const Options opts = parse_options(argc, argv);
+    const std::uint16_t port = opts.port;
+
+    std::vector<SymbolCode> symbols;
+    if (opts.symbolsFile) {
+        auto loaded = load_symbols(opts.symbolsFile);
+        if (!loaded) return 1;
+        symbols = std::move(*loaded);
+    }
+
+    // All books are allocated up front so the message path never allocates
+    // one: either inline in a registry, or on the shard threads.
+    BookRegistry books{BookRegistry::kDefaultOrdersPerBook, opts.risk};
+    std::unique_ptr<ShardedEngine> sharded;
+    if (opts.shards == 0) {
+        for (const SymbolCode symbol : symbols) books.add(symbol);
+    } else {
+        sharded = std::make_unique<ShardedEngine>(symbols,
+                                                  ShardedEngine::Config{.shards = opts.shards, .risk = opts.risk});
+    }
+
+    // Recover: restore the snapshot, replay the journal records it does not
+    // cover, then keep appending to the journal.
+    const char* const snapshotFile = sharded ? nullptr : opts.snapshotFile;
+    if (sharded && opts.snapshotFile) logln("Snapshots need inline matching; ignoring --snapshot.");
+
+    std::uint64_t covered = 0;
+    if (snapshotFile) {
+        const auto position = load_snapshot(snapshotFile, books);
+        if (!position) return 1;
+        covered = *position;
+    }
+
+    std::unique_ptr<Journal> journal;
+    std::size_t replayed = 0;
+    if (opts.journalFile) {
+        auto reader = JournalReader::load(opts.journalFile);
+        if (!reader) return 1;
+        if (!reader->skip(covered)) {
+            logln("{} ends before the snapshot's position ({} records); refusing to start.",
+                  opts.journalFile, covered);
+            return 1;
+        }
+        Session replay = (sharded ? SessionFactory{*sharded} : SessionFactory{books}).make(0);
+        replayed = replay_journal(*reader, replay);
+        logln("Replayed {} journal record(s) from {}.", replayed, opts.journalFile);
+
+        journal = Journal::open(opts.journalFile, Journal::Config{.sync = opts.journalSync});
+        if (!journal) return 1;
+    }
+
+    // Checkpoint, so the next restart replays only what happens from here on.
+    if (snapshotFile && replayed != 0 && !write_snapshot(snapshotFile, books, journal->appended())) return 1;
+
+    // Created after recovery: replayed commands are not re-published.
+    std::unique_ptr<MarketDataRing> feed;
+    if (opts.feedFile && sharded) {
+        logln("The market-data feed needs inline matching; ignoring --feed.");
+    } else if (opts.feedFile) {
+        feed = MarketDataRing::create(opts.feedFile);
+        if (!feed) return 1;
+    }
 
     const int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
     if (listen_fd < 0) {
@@ -129,34 +293,30 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    if (::listen(listen_fd, 16) < 0) {
+    if (::listen(listen_fd, SOMAXCONN) < 0) {
         std::perror("listen");
         ::close(listen_fd);
         return 1;
     }
 
-    logln("Listening on port {}...", port);
-
-    MatchingEngine engine;  // one book, persists across client connections
+    if (sharded) logln("Listening on port {} with {} book(s) on {} shard(s)...",
+                       port, symbols.size() + 1, sharded->shardCount());
+    else         logln("Listening on port {} with {} book(s)...", port, books.size());
 
-    for (;;) {
-        const int client_fd = ::accept(listen_fd, nullptr, nullptr);
-        if (client_fd < 0) {
-            if (errno == EINTR) continue;
-            std::perror("accept");
-            break;
-        }
+    SessionFactory sessions = sharded ? SessionFactory{*sharded, journal.get()}
+                                      : SessionFactory{books, journal.get(), feed.get()};
+    sessions.setMessageRate(opts.maxRate);
 
-        // Disable Nagle: small request/response messages go out immediately.
-        int nodelay = 1;
-        ::setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    static_cast<void>(tsc_ticks_per_ns());  // calibrate now, not on the first STATS
+    std::jthread latencyDump;
+    if (opts.statsInterval != 0)
+        latencyDump = std::jthread{dump_latency, std::chrono::seconds{opts.statsInterval}};
 
-        logln("Client connected.");
-        serve_client(client_fd, engine);
-        ::close(client_fd);
-        logln("Waiting for next connection (book state persists)...");
-    }
+    const bool ioUring = opts.ioUring && io_uring_supported();
+    if (opts.ioUring && !ioUring) logln("io_uring unavailable on this kernel; using epoll.");
+    const int rc = ioUring ? run_io_uring_server(listen_fd, sessions)
+                           : run_epoll_server(listen_fd, sessions);
 
     ::close(listen_fd);
-    return 0;
+    return rc;
 }
@@ -1,12 +1,35 @@
 // Unit tests for the matching engine and protocol layer (GoogleTest).
 
+#include "BinaryProtocol.hpp"
+#include "BookRegistry.hpp"
+#include "EventLog.hpp"
+#include "Latency.hpp"
+#include "LineScanner.hpp"
 #include "MatchingEngine.hpp"
 #include "Protocol.hpp"
+#include "Symbol.hpp"
+#include "TextFormat.hpp"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <limits>
+#include <memory_resource>
+#include <random>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
 #include <vector>
 
 namespace {
@@ -67,6 +90,17 @@ TEST_F(MatchingEngineTest, CancelPaths) {
     EXPECT_FALSE(engine.bestBid().has_value()) << "empty level removed on cancel";
 }
 
+TEST_F(MatchingEngineTest, CancelFromMiddleKeepsFifoAndRecyclesSlots) {
+    EXPECT_EQ(run("SUBMIT 1 S 100 1"), "ACK 1\n");
+    EXPECT_EQ(run("SUBMIT 2 S 100 2"), "ACK 2\n");
+    EXPECT_EQ(run("SUBMIT 3 S 100 3"), "ACK 3\n");
+    EXPECT_EQ(run("CANCEL 2"), "ACK 2\n");
+    EXPECT_EQ(run("SUBMIT 4 S 100 4"), "ACK 4\n") << "reuses the freed slot";
+    EXPECT_EQ(engine.dump(), "BIDS:\nASKS:\n100: 1(1) 3(3) 4(4) \n");
+    EXPECT_EQ(run("SUBMIT 5 B 100 5"), "FILL 5 1 100 1\nFILL 5 3 100 3\nFILL 5 4 100 1\nACK 5\n");
+    EXPECT_EQ(engine.dump(), "BIDS:\nASKS:\n100: 4(3) \n");
+}
+
 TEST_F(MatchingEngineTest, RejectsDuplicateIdAndBadQuantity) {
     EXPECT_EQ(run("SUBMIT 1 B 100 10"), "ACK 1\n");
     EXPECT_EQ(run("SUBMIT 1 S 100 10"), "ERR DUPLICATE_ID 1\n");
@@ -75,6 +109,196 @@ TEST_F(MatchingEngineTest, RejectsDuplicateIdAndBadQuantity) {
     EXPECT_EQ(run("CANCEL 2"), "ACK 2 NOT_FOUND\n") << "rejected order never rested";
 }
 
+TEST_F(MatchingEngineTest, ModifyDownKeepsQueuePosition) {
+    EXPECT_EQ(run("SUBMIT 1 S 100 5"), "ACK 1\n");
+    EXPECT_EQ(run("SUBMIT 2 S 100 5"), "ACK 2\n");
+    EXPECT_EQ(run("MODIFY 1 100 2"), "ACK 1\n");
+    EXPECT_EQ(run("MODIFY 1 100 2"), "ACK 1\n") << "an unchanged order is a no-op";
+    EXPECT_EQ(engine.dump(), "BIDS:\nASKS:\n100: 1(2) 2(5) \n") << "reduced in place, still first";
+    EXPECT_EQ(run("SUBMIT 3 B 100 3"), "FILL 3 1 100 2\nFILL 3 2 100 1\nACK 3\n");
+}
+
+TEST_F(MatchingEngineTest, ModifyUpOrRepriceLosesQueuePosition) {
+    EXPECT_EQ(run("SUBMIT 1 B 100 5"), "ACK 1\n");
+    EXPECT_EQ(run("SUBMIT 2 B 100 5"), "ACK 2\n");
+    EXPECT_EQ(run("MODIFY 1 100 6"), "ACK 1\n");
+    EXPECT_EQ(engine.dump(), "BIDS:\n100: 2(5) 1(6) \nASKS:\n") << "a size increase goes to the back";
+
+    EXPECT_EQ(run("MODIFY 2 99 5"), "ACK 2\n");
+    EXPECT_EQ(run("SUBMIT 3 B 99 1"), "ACK 3\n");
+    EXPECT_EQ(run("MODIFY 2 101 5"), "ACK 2\n");
+    EXPECT_EQ(engine.dump(), "BIDS:\n101: 2(5) \n100: 1(6) \n99: 3(1) \nASKS:\n")
+        << "a price change re-enters the book and leaves no empty level behind";
+    EXPECT_EQ(engine.openOrders(), 3u);
+}
+
+TEST_F(MatchingEngineTest, ModifyThatCrossesMatchesLikeASubmit) {
+    EXPECT_EQ(run("SUBMIT 1 S 101 4"), "ACK 1\n");
+    EXPECT_EQ(run("SUBMIT 2 B 99 10"), "ACK 2\n");
+    EXPECT_EQ(run("MODIFY 2 101 10"), "FILL 2 1 101 4\nACK 2\n");
+    EXPECT_EQ(engine.dump(), "BIDS:\n101: 2(6) \nASKS:\n");
+    EXPECT_EQ(run("SUBMIT 3 S 100 6"), "FILL 3 2 101 6\nACK 3\n");
+    EXPECT_EQ(run("MODIFY 2 101 1"), "ACK 2 NOT_FOUND\n") << "filled orders cannot be amended";
+    EXPECT_EQ(run("SUBMIT 4 B 98 1"), "ACK 4\n");
+    EXPECT_EQ(run("MODIFY 4 98 0"), "ERR BAD_QTY\n") << "use CANCEL to remove an order";
+    EXPECT_EQ(engine.dump(), "BIDS:\n98: 4(1) \nASKS:\n");
+}
+
+TEST_F(MatchingEngineTest, ImmediateOrCancelAndMarketOrdersNeverRest) {
+    EXPECT_EQ(run("SUBMIT 1 S 100 3"), "ACK 1\n");
+    EXPECT_EQ(run("SUBMIT 2 S 102 3"), "ACK 2\n");
+    EXPECT_EQ(run("SUBMIT 3 B 101 5 IOC"), "FILL 3 1 100 3\nACK 3\n") << "stops at its limit";
+    EXPECT_EQ(run("SUBMIT 4 B 99 5 IOC"), "ACK 4\n");
+    EXPECT_EQ(engine.dump(), "BIDS:\nASKS:\n102: 2(3) \n") << "IOC remainders are dropped";
+
+    EXPECT_EQ(run("SUBMIT 5 B 0 5 MARKET"), "FILL 5 2 102 3\nACK 5\n") << "any price, rest dropped";
+    EXPECT_EQ(engine.openOrders(), 0u);
+    EXPECT_EQ(run("SUBMIT 5 S 0 5 MARKET"), "ACK 5\n") << "an empty book leaves nothing to trade";
+}
+
+TEST_F(MatchingEngineTest, FillOrKillTradesAllOrNothing) {
+    EXPECT_EQ(run("SUBMIT 1 B 100 3"), "ACK 1\n");
+    EXPECT_EQ(run("SUBMIT 2 B 99 3"), "ACK 2\n");
+    EXPECT_EQ(run("SUBMIT 3 B 98 3"), "ACK 3\n");
+
+    EXPECT_EQ(run("SUBMIT 4 S 99 7 FOK"), "ERR KILLED 4\n") << "only 6 at 99 or better";
+    EXPECT_EQ(engine.dump(), "BIDS:\n100: 1(3) \n99: 2(3) \n98: 3(3) \nASKS:\n") << "nothing traded";
+    EXPECT_EQ(run("SUBMIT 5 S 98 7 FOK"), "FILL 5 1 100 3\nFILL 5 2 99 3\nFILL 5 3 98 1\nACK 5\n");
+    EXPECT_EQ(engine.dump(), "BIDS:\n98: 3(2) \nASKS:\n");
+}
+
+TEST_F(MatchingEngineTest, PostOnlyRestsOrIsRejected) {
+    EXPECT_EQ(run("SUBMIT 1 S 100 3"), "ACK 1\n");
+    EXPECT_EQ(run("SUBMIT 2 B 100 1 POST"), "ERR WOULD_CROSS 2\n");
+    EXPECT_EQ(run("SUBMIT 2 B 99 1 POST"), "ACK 2\n");
+    EXPECT_EQ(engine.dump(), "BIDS:\n99: 2(1) \nASKS:\n100: 1(3) \n");
+    EXPECT_EQ(run("SUBMIT 3 S 99 1"), "FILL 3 2 99 1\nACK 3\n") << "a rested post-only order is a plain maker";
+}
+
+TEST_F(MatchingEngineTest, SelfTradePreventionSettlesOwnOrdersWithoutFills) {
+    EXPECT_EQ(run("SUBMIT 1 S 100 2 ACCT=7"), "ACK 1\n");
+    EXPECT_EQ(run("SUBMIT 2 S 100 2 ACCT=8"), "ACK 2\n");
+    EXPECT_EQ(run("SUBMIT 3 S 101 2 ACCT=7"), "ACK 3\n");
+
+    EXPECT_EQ(run("SUBMIT 4 B 101 3 ACCT=7 STP=NEWEST"), "ERR SELF_TRADE 4\n") << "own order first in line";
+    EXPECT_EQ(engine.dump(), "BIDS:\nASKS:\n100: 1(2) 2(2) \n101: 3(2) \n");
+    EXPECT_EQ(run("SUBMIT 5 B 101 5 ACCT=7 STP=OLDEST"), "ACK 1\nFILL 5 2 100 2\nACK 3\nACK 5\n");
+    EXPECT_EQ(engine.dump(), "BIDS:\n101: 5(3) \nASKS:\n") << "both own asks cancelled, the remainder rests";
+    EXPECT_EQ(run("CANCEL 5"), "ACK 5\n");
+
+    EXPECT_EQ(run("SUBMIT 6 S 100 2 ACCT=7"), "ACK 6\n");
+    EXPECT_EQ(run("SUBMIT 7 S 100 5 ACCT=8"), "ACK 7\n");
+    EXPECT_EQ(run("SUBMIT 8 B 100 3 ACCT=7 STP=DECREMENT"), "ACK 6\nFILL 8 7 100 1\nACK 8\n");
+    EXPECT_EQ(engine.dump(), "BIDS:\nASKS:\n100: 7(4) \n") << "2 decremented off each side, 1 traded";
+
+    EXPECT_EQ(run("SUBMIT 9 S 101 2 ACCT=8"), "ACK 9\n");
+    EXPECT_EQ(run("SUBMIT 10 S 102 2"), "ACK 10\n");
+    EXPECT_EQ(run("SUBMIT 11 B 102 9 ACCT=8 STP=BOTH"), "ACK 7\nERR SELF_TRADE 11\n");
+    EXPECT_EQ(engine.dump(), "BIDS:\nASKS:\n101: 9(2) \n102: 10(2) \n") << "7 and the taker cancelled";
+
+    EXPECT_EQ(run("SUBMIT 12 B 101 1 ACCT=8"), "FILL 12 9 101 1\nACK 12\n") << "no mode: trades with itself";
+    EXPECT_EQ(run("SUBMIT 13 B 102 1 STP=BOTH"), "FILL 13 9 101 1\nACK 13\n") << "no account: nothing to match";
+
+    EXPECT_EQ(run("SUBMIT 14 B 100 1 ACCT=9"), "ACK 14\n");
+    EXPECT_EQ(run("SUBMIT 15 S 103 1 ACCT=9 STP=NEWEST"), "ACK 15\n");
+    EXPECT_EQ(run("MODIFY 15 100 1"), "ERR SELF_TRADE 15\n") << "re-entered into its own bid";
+    EXPECT_EQ(engine.dump(), "BIDS:\n100: 14(1) \nASKS:\n102: 10(2) \n");
+}
+
+TEST_F(MatchingEngineTest, FillOrKillDiscountsOwnLiquidityUnderSelfTradePrevention) {
+    EXPECT_EQ(run("SUBMIT 1 S 100 2 ACCT=7"), "ACK 1\n");
+    EXPECT_EQ(run("SUBMIT 2 S 100 2 ACCT=8"), "ACK 2\n");
+
+    EXPECT_EQ(run("SUBMIT 3 B 100 3 FOK ACCT=7 STP=OLDEST"), "ERR KILLED 3\n") << "only 2 is not its own";
+    EXPECT_EQ(run("SUBMIT 4 B 100 1 FOK ACCT=7 STP=NEWEST"), "ERR KILLED 4\n") << "its own order comes first";
+    EXPECT_EQ(engine.dump(), "BIDS:\nASKS:\n100: 1(2) 2(2) \n");
+    EXPECT_EQ(run("SUBMIT 5 B 100 2 FOK ACCT=7 STP=OLDEST"), "ACK 1\nFILL 5 2 100 2\nACK 5\n");
+    EXPECT_EQ(engine.openOrders(), 0u);
+}
+
+TEST(RiskGateTest, RejectsOrdersThatBreakALimit) {
+    MatchingEngine book{64, RiskLimits{.maxQuantity = 100, .maxNotional = 10'000, .collar = 5, .maxOpenOrders = 2,
+                                       .maxPosition = 10}};
+    const auto run = [&book](std::string_view line) {
+        std::string response;
+        static_cast<void>(process_line(line, book, response));
+        return response;
+    };
+
+    EXPECT_EQ(run("SUBMIT 1 B 100 101"), "ERR RISK_QTY 1\n");
+    EXPECT_EQ(run("SUBMIT 2 B 200 60"), "ERR RISK_NOTIONAL 2\n");
+    EXPECT_EQ(run("SUBMIT 3 S 100 5 ACCT=1"), "ACK 3\n");
+    EXPECT_EQ(run("SUBMIT 4 B 106 1 ACCT=2"), "ERR RISK_COLLAR 4\n") << "6 ticks through the ask";
+    EXPECT_EQ(run("SUBMIT 5 B 105 1 ACCT=2"), "FILL 5 3 100 1\nACK 5\n");
+    EXPECT_EQ(run("SUBMIT 6 S 101 1 ACCT=1"), "ACK 6\n");
+    EXPECT_EQ(run("SUBMIT 7 S 102 1 ACCT=1"), "ERR RISK_OPEN_ORDERS 7\n");
+    EXPECT_EQ(run("SUBMIT 8 S 99 1 IOC ACCT=1"), "ACK 8\n") << "an IOC never rests: no open-order limit";
+
+    EXPECT_EQ(book.risk().openOrders(1), 2u);
+    EXPECT_EQ(book.risk().position(1), -1);
+    EXPECT_EQ(book.risk().position(2), 1);
+    EXPECT_EQ(book.risk().openQuantity(1, Side::Sell), 5);
+
+    EXPECT_EQ(run("MODIFY 6 101 5"), "ACK 6\n") << "an amend is not a new open order; -1 - 4 open - 5 is in";
+    EXPECT_EQ(run("MODIFY 6 101 6"), "ERR RISK_POSITION 6\n");
+    EXPECT_EQ(book.dump(), "BIDS:\nASKS:\n100: 3(4) \n101: 6(5) \n") << "rejects leave the book alone";
+    EXPECT_EQ(book.risk().openQuantity(1, Side::Sell), 9);
+
+    EXPECT_EQ(run("SUBMIT 9 B 101 8 ACCT=2"), "FILL 9 3 100 4\nFILL 9 6 101 4\nACK 9\n");
+    EXPECT_EQ(book.risk().openOrders(1), 1u) << "3 filled away";
+    EXPECT_EQ(run("CANCEL 6"), "ACK 6\n");
+    EXPECT_EQ(book.risk().openOrders(1), 0u);
+    EXPECT_EQ(book.risk().openQuantity(1, Side::Sell), 0);
+    EXPECT_EQ(book.risk().position(1), -9);
+    EXPECT_EQ(book.risk().position(2), 9);
+    EXPECT_EQ(run("SUBMIT 10 B 101 2 ACCT=2"), "ERR RISK_POSITION 10\n");
+}
+
+TEST(RiskGateTest, CountsRestingOrdersAndKeysAccountsExactly) {
+    MatchingEngine book{64, RiskLimits{.maxPosition = 10, .accountSlots = 2}};
+    const auto run = [&book](std::string_view line) {
+        std::string response;
+        static_cast<void>(process_line(line, book, response));
+        return response;
+    };
+
+    EXPECT_EQ(run("SUBMIT 1 S 100 6 ACCT=1"), "ACK 1\n");
+    EXPECT_EQ(run("SUBMIT 2 S 101 5 ACCT=1"), "ERR RISK_POSITION 2\n") << "6 already open on the same side";
+    EXPECT_EQ(run("SUBMIT 3 B 99 10 ACCT=1"), "ACK 3\n") << "open sells do not offset a buy";
+
+    // Under slots keyed by account % 2, 3 would share 1's counters.
+    EXPECT_EQ(run("SUBMIT 4 B 100 6 ACCT=3"), "FILL 4 1 100 6\nACK 4\n");
+    EXPECT_EQ(book.risk().position(1), -6);
+    EXPECT_EQ(book.risk().position(3), 6);
+    EXPECT_EQ(run("SUBMIT 5 B 101 4 ACCT=3"), "ACK 5\n");
+    EXPECT_EQ(run("SUBMIT 6 S 102 4 ACCT=1"), "ACK 6\n");
+
+    EXPECT_EQ(run("SUBMIT 7 B 90 1 ACCT=5"), "ERR RISK_ACCOUNTS 7\n") << "both slots are taken";
+    EXPECT_EQ(run("CANCEL 5"), "ACK 5\n");
+    EXPECT_EQ(run("SUBMIT 8 B 90 1 ACCT=5"), "ERR RISK_ACCOUNTS 8\n") << "slots are kept for the book's life";
+}
+
+TEST(RiskGateTest, ThrottleAdmitsUpToTheRatePerSecond) {
+    using namespace std::chrono_literals;
+    MessageThrottle throttle{2};
+    const MessageThrottle::Clock::time_point t0{1s};
+    EXPECT_TRUE(throttle.admit(t0));
+    EXPECT_TRUE(throttle.admit(t0 + 500ms));
+    EXPECT_FALSE(throttle.admit(t0 + 999ms));
+    EXPECT_TRUE(throttle.admit(t0 + 1s)) << "a new window";
+
+    MessageThrottle unlimited;
+    for (int i = 0; i < 1'000; ++i) ASSERT_TRUE(unlimited.admit());
+    for (int i = 0; i < 1'000; ++i) ASSERT_TRUE(unlimited.admit(t0)) << "0 = unlimited with a caller's clock too";
+
+    BookRegistry books{64};
+    MessageThrottle session{2};
+    std::string out;
+    for (const std::string_view line : {"SUBMIT 1 B 100 1", "MODIFY 1 100 2", "SUBMIT 2 B 100 1", "CANCEL 1"})
+        ASSERT_TRUE(process_command(parse_command(line), books, out, nullptr, nullptr, &session));
+    EXPECT_EQ(out, "ACK 1\nACK 1\nERR THROTTLED 2\nACK 1\n") << "cancels are never throttled";
+}
+
 TEST(ProtocolTest, ParserAcceptsAndRejects) {
     const auto failsWith = [](std::string_view line, ParseError want) {
         const auto r = parse_command(line);
@@ -86,11 +310,68 @@ TEST(ProtocolTest, ParserAcceptsAndRejects) {
     EXPECT_TRUE(failsWith("SUBMIT 1 X 100 10", ParseError::BadSide)) << "bad side";
     EXPECT_TRUE(failsWith("SUBMIT 1 B 100 10 junk", ParseError::BadSubmit)) << "trailing junk";
     EXPECT_TRUE(failsWith("SUBMIT 1x B 100 10", ParseError::BadSubmit)) << "partial-numeric token";
+    EXPECT_TRUE(failsWith("SUBMIT 1 B 100 10 GTC", ParseError::BadSubmit)) << "unknown order type";
+    EXPECT_EQ(std::get<SubmitCommand>(*parse_command("SUBMIT 1 B 100 10 FOK")).order.type, OrderType::FillOrKill);
+    EXPECT_EQ(std::get<SubmitCommand>(*parse_command("SUBMIT 1 B 100 10")).order.type, OrderType::Limit);
+    const auto owned = parse_command("SUBMIT 1 B 100 10 IOC STP=BOTH ACCT=7");
+    ASSERT_TRUE(owned.has_value());
+    EXPECT_EQ(std::get<SubmitCommand>(*owned).order,
+              (Order{.id = 1, .side = Side::Buy, .type = OrderType::ImmediateOrCancel,
+                     .stp = SelfTradePrevention::CancelBoth, .account = 7, .price = 100, .quantity = 10}));
+    EXPECT_TRUE(parse_command("SUBMIT 1 B 100 10 ACCT=7").has_value()) << "options without an order type";
+    EXPECT_TRUE(failsWith("SUBMIT 1 B 100 10 ACCT=7 IOC", ParseError::BadSubmit)) << "type comes first";
+    EXPECT_TRUE(failsWith("SUBMIT 1 B 100 10 ACCT=-1", ParseError::BadSubmit)) << "bad account";
+    EXPECT_TRUE(failsWith("SUBMIT 1 B 100 10 ACCT=1 ACCT=2", ParseError::BadSubmit)) << "repeated option";
+    EXPECT_TRUE(failsWith("SUBMIT 1 B 100 10 STP=SOMETIMES", ParseError::BadSubmit)) << "unknown stp mode";
     EXPECT_TRUE(failsWith("CANCEL nope", ParseError::BadCancel)) << "bad cancel id";
+    EXPECT_TRUE(failsWith("MODIFY 1 100", ParseError::BadModify)) << "missing modify quantity";
+    EXPECT_TRUE(failsWith("MODIFY 1 B 100 10", ParseError::BadModify)) << "modify keeps the side";
     EXPECT_TRUE(failsWith("   ", ParseError::Empty)) << "blank line is a no-op";
     EXPECT_TRUE(failsWith("HELLO", ParseError::UnknownCommand)) << "unknown command";
 }
 
+TEST(ProtocolTest, ParsesOptionalSymbolOperand) {
+    const auto submit = parse_command("SUBMIT AAPL 1 B 100 10");
+    ASSERT_TRUE(submit.has_value());
+    const auto& cmd = std::get<SubmitCommand>(*submit);
+    EXPECT_EQ(cmd.symbol, encode_symbol("AAPL"));
+    EXPECT_EQ(cmd.order.id, 1);
+
+    EXPECT_EQ(std::get<SubmitCommand>(*parse_command("SUBMIT 1 B 100 10")).symbol, kNoSymbol);
+    EXPECT_EQ(std::get<CancelCommand>(*parse_command("CANCEL MSFT 7")).symbol, encode_symbol("MSFT"));
+    const auto modify = std::get<ModifyCommand>(*parse_command("MODIFY ES 7 -3 4"));
+    EXPECT_EQ(modify.symbol, encode_symbol("ES"));
+    EXPECT_EQ(std::tie(modify.id, modify.price, modify.quantity), std::tuple(7, -3, 4));
+    EXPECT_EQ(std::get<DumpCommand>(*parse_command("DUMP ES")).symbol, encode_symbol("ES"));
+    EXPECT_FALSE(parse_command("SUBMIT WAYTOOLONG 1 B 100 10").has_value()) << "symbols are <= 8 chars";
+    EXPECT_FALSE(parse_command("CANCEL MSFT").has_value()) << "symbol is not an id";
+}
+
+TEST(ProtocolTest, RegistryRoutesCommandsPerSymbol) {
+    BookRegistry books{64};
+    books.add(*encode_symbol("AAPL"));
+    books.add(*encode_symbol("MSFT"));
+    EXPECT_EQ(books.size(), 3u) << "two named books plus the default";
+
+    std::string response;
+    ASSERT_TRUE(process_line("SUBMIT AAPL 1 S 100 5", books, response));
+    EXPECT_EQ(response, "ACK 1\n");
+    ASSERT_TRUE(process_line("SUBMIT MSFT 2 B 100 5", books, response));
+    EXPECT_EQ(response, "ACK 2\n") << "books are independent: no cross-symbol fill";
+    ASSERT_TRUE(process_line("SUBMIT 3 B 100 5", books, response));
+    EXPECT_EQ(response, "ACK 3\n") << "unsymboled commands go to the default book";
+    ASSERT_TRUE(process_line("SUBMIT AAPL 4 B 100 2", books, response));
+    EXPECT_EQ(response, "FILL 4 1 100 2\nACK 4\n");
+    ASSERT_TRUE(process_line("DUMP AAPL", books, response));
+    EXPECT_EQ(response, "BIDS:\nASKS:\n100: 1(3) \n");
+    ASSERT_TRUE(process_line("CANCEL GOOG 1", books, response));
+    EXPECT_EQ(response, "ERR UNKNOWN_SYMBOL\n");
+
+    MatchingEngine single;
+    ASSERT_TRUE(process_line("SUBMIT AAPL 1 B 100 1", single, response));
+    EXPECT_EQ(response, "ERR UNKNOWN_SYMBOL\n") << "a lone engine only serves unsymboled commands";
+}
+
 TEST(ProtocolTest, BlankInputProducesNoResponse) {
     MatchingEngine engine;
     std::string response;
@@ -98,6 +379,269 @@ TEST(ProtocolTest, BlankInputProducesNoResponse) {
     EXPECT_TRUE(response.empty());
 }
 
+TEST(TextFormatTest, WritesIntegersLikeToString) {
+    std::vector<std::int64_t> values{0, 1, -1, std::numeric_limits<std::int64_t>::max(),
+                                     std::numeric_limits<std::int64_t>::min()};
+    for (std::int64_t p = 1; p <= std::numeric_limits<std::int64_t>::max() / 10; p *= 10)
+        for (const std::int64_t v : {p - 1, p, p + 1, 10 * p - 1}) values.insert(values.end(), {v, -v});
+    std::mt19937_64 rng{3};
+    for (int i = 0; i < 10'000; ++i) values.push_back(static_cast<std::int64_t>(rng() >> (rng() % 64)));
+
+    for (const std::int64_t v : values) {
+        char buf[kMaxIntChars];
+        const char* const end = write_int(buf, v);
+        EXPECT_EQ(std::string_view(buf, end), std::to_string(v));
+    }
+
+    std::string out = "x";
+    FormattingSink{out}(FillEvent{.taker = 12, .maker = -7, .price = 100, .quantity = 5});
+    FormattingSink{out}(RejectEvent{.id = 9, .reason = RejectReason::UnknownOrder});
+    EXPECT_EQ(out, "xFILL 12 -7 100 5\nACK 9 NOT_FOUND\n");
+}
+
+TEST(LineScannerTest, IndexMatchesScalarReference) {
+    constexpr std::string_view alphabet = "AB1 \t\n\r\v\f\x80\xff\x0b\x08\x0e";
+    std::mt19937_64 rng{11};
+    ChunkIndex index;
+    for (const std::size_t size : {0uz, 1uz, 63uz, 64uz, 65uz, 127uz, 200uz, 4096uz, 4097uz}) {
+        std::string chunk(size, '\0');
+        for (char& c : chunk) c = alphabet[rng() % alphabet.size()];
+        index.build(chunk);
+
+        const auto is_space = [](char c) { return c == ' ' || (c >= '\t' && c <= '\r'); };
+        std::vector<std::uint32_t> newlines;
+        std::vector<std::string_view> tokens;
+        for (std::size_t i = 0; i < size; ++i) {
+            if (chunk[i] == '\n') newlines.push_back(static_cast<std::uint32_t>(i));
+            if (!is_space(chunk[i]) && (i == 0 || is_space(chunk[i - 1]))) {
+                std::size_t end = i;
+                while (end < size && !is_space(chunk[end])) ++end;
+                tokens.push_back(std::string_view{chunk}.substr(i, end - i));
+            }
+        }
+        EXPECT_TRUE(std::ranges::equal(index.newlines(), newlines)) << "size " << size;
+        ASSERT_EQ(index.tokens().size(), tokens.size()) << "size " << size;
+        for (std::size_t t = 0; t < tokens.size(); ++t)
+            ASSERT_EQ(index.text(index.tokens()[t]), tokens[t]) << "size " << size << " token " << t;
+    }
+}
+
+TEST(ProtocolTest, BatchedParseMatchesPerLineParse) {
+    std::string chunk;
+    for (int round = 0; round < 40; ++round) {  // long enough to span many 64-byte blocks
+        chunk += "SUBMIT 1 B 100 10\n  SUBMIT  AAPL\t2 s 101 5 \r\n\nCANCEL 7\nCANCEL MSFT 8\n";
+        chunk += "SUBMIT 1 X 100 10\nSUBMIT 1 B 100\nDUMP ES\n\t\nHELLO world\nSUBMIT WAYTOOLONG 1 B 1 1\n";
+    }
+    chunk += "SUBMIT 9 B 1";  // partial trailing line
+
+    CommandBatch batch;
+    const auto commands = parse_commands(chunk, batch);
+    EXPECT_EQ(batch.consumed, chunk.rfind('\n') + 1);
+    ASSERT_EQ(commands.size(), batch.index.newlines().size());
+
+    // Same parse => same response from identical books.
+    BookRegistry batched{64}, perLine{64};
+    for (auto* books : {&batched, &perLine})
+        for (const char* sym : {"AAPL", "MSFT", "ES"}) books->add(*encode_symbol(sym));
+
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+        const std::string_view line = std::string_view{chunk}.substr(begin, batch.index.newlines()[i] - begin);
+        begin = batch.index.newlines()[i] + 1;
+        const auto expected = parse_command(line);
+        ASSERT_EQ(commands[i].has_value(), expected.has_value()) << line;
+        if (!expected) {
+            EXPECT_EQ(commands[i].error(), expected.error()) << line;
+            continue;
+        }
+        std::string got, want;
+        EXPECT_EQ(process_command(commands[i], batched, got), process_command(expected, perLine, want));
+        EXPECT_EQ(got, want) << line;
+    }
+}
+
+/// Render a stream of binary server messages as text, for readable asserts.
+std::string describe_binary(std::string_view rx) {
+    std::string out;
+    while (const std::size_t n = binary_message_size(rx)) {
+        BinaryHeader h;
+        std::memcpy(&h, rx.data(), sizeof(h));
+        if (h.type == MsgType::Fill) {
+            FillMsg m;
+            std::memcpy(&m, rx.data(), sizeof(m));
+            out += std::format("FILL {} {} {} {}|", from_wire(m.taker), from_wire(m.maker),
+                               from_wire(m.price), from_wire(m.quantity));
+        } else if (h.type == MsgType::Reject) {
+            RejectMsg m;
+            std::memcpy(&m, rx.data(), sizeof(m));
+            out += std::format("REJECT {} {}|", from_wire(m.id), static_cast<int>(m.reason));
+        } else {
+            AckMsg m;
+            std::memcpy(&m, rx.data(), sizeof(m));
+            out += std::format("{} {}|", h.type == MsgType::Ack ? "ACK" : "CANCEL_ACK", from_wire(m.id));
+        }
+        rx.remove_prefix(n);
+    }
+    return out;
+}
+
+TEST(BinaryProtocolTest, EncodesAndDecodesClientMessages) {
+    std::string wire;
+    const Order order{.id = 42, .side = Side::Sell, .type = OrderType::PostOnly,
+                      .stp = SelfTradePrevention::Decrement, .account = 0x01020304, .price = -5, .quantity = 9};
+    encode_submit(wire, order, *encode_symbol("ES"));
+    encode_cancel(wire, 43);
+    encode_modify(wire, 44, 101, 7, *encode_symbol("ES"));
+    ASSERT_EQ(wire.size(), sizeof(SubmitMsg) + sizeof(CancelMsg) + sizeof(ModifyMsg));
+    EXPECT_EQ(wire[0], 48) << "length is little-endian on the wire";
+    EXPECT_EQ(wire[offsetof(SubmitMsg, account)], 4) << "so is the account";
+
+    const std::size_t n = binary_message_size(wire);
+    ASSERT_EQ(n, sizeof(SubmitMsg));
+    const auto submit = decode_message(std::string_view{wire}.substr(0, n));
+    ASSERT_TRUE(submit.has_value());
+    const auto& s = std::get<SubmitCommand>(*submit);
+    EXPECT_EQ(s.order, order);
+    EXPECT_EQ(s.symbol, encode_symbol("ES"));
+
+    const auto cancel = decode_message(std::string_view{wire}.substr(n, sizeof(CancelMsg)));
+    ASSERT_TRUE(cancel.has_value());
+    EXPECT_EQ(std::get<CancelCommand>(*cancel).id, 43);
+    EXPECT_EQ(std::get<CancelCommand>(*cancel).symbol, kNoSymbol);
+
+    const auto modify = decode_message(std::string_view{wire}.substr(n + sizeof(CancelMsg)));
+    ASSERT_TRUE(modify.has_value());
+    const auto& m = std::get<ModifyCommand>(*modify);
+    EXPECT_EQ(std::tie(m.id, m.price, m.quantity), std::tuple(44, 101, 7));
+    EXPECT_EQ(m.symbol, encode_symbol("ES"));
+
+    EXPECT_EQ(binary_message_size(std::string_view{wire}.substr(0, n - 1)), 0u) << "incomplete message";
+    EXPECT_EQ(binary_message_size(std::string_view{"\x00\x00\x01\x00", 4}), 4u) << "bogus length still advances";
+
+    std::string badType = wire.substr(0, n);
+    badType[offsetof(SubmitMsg, type)] = 9;
+    EXPECT_FALSE(decode_message(badType).has_value()) << "unknown order type";
+    std::string badStp = wire.substr(0, n);
+    badStp[offsetof(SubmitMsg, stp)] = 5;
+    EXPECT_FALSE(decode_message(badStp).has_value()) << "unknown stp mode";
+}
+
+TEST(BinaryProtocolTest, RegistryAnswersWithBinaryEvents) {
+    BookRegistry books{64};
+    books.add(*encode_symbol("AAPL"));
+    const SymbolCode aapl = *encode_symbol("AAPL");
+
+    std::string in, tx;
+    encode_submit(in, Order{.id = 1, .side = Side::Sell, .price = 100, .quantity = 5}, aapl);
+    encode_submit(in, Order{.id = 2, .side = Side::Buy, .price = 100, .quantity = 3}, aapl);
+    encode_submit(in, Order{.id = 1, .side = Side::Buy, .price = 90, .quantity = 1}, aapl);  // duplicate
+    encode_modify(in, 1, 100, 1, aapl);
+    encode_cancel(in, 1, aapl);
+    encode_cancel(in, 1, aapl);
+    encode_modify(in, 1, 100, 1, aapl);
+    encode_submit(in, Order{.id = 3, .side = Side::Buy, .price = 100, .quantity = 1}, *encode_symbol("GOOG"));
+    encode_submit(in, Order{.id = 4, .side = Side::Buy, .type = OrderType::FillOrKill, .price = 100, .quantity = 1},
+                  aapl);  // nothing to fill it: killed
+    for (std::string_view rx = in; const std::size_t n = binary_message_size(rx); rx.remove_prefix(n))
+        process_message(rx.substr(0, n), books, tx);
+
+    EXPECT_EQ(describe_binary(tx), "ACK 1|FILL 2 1 100 3|ACK 2|REJECT 1 1|ACK 1|CANCEL_ACK 1|REJECT 1 3|REJECT 1 3|"
+                                   "REJECT 3 128|REJECT 4 12|");
+
+    tx.clear();
+    std::string bad(sizeof(AckMsg), '\0');
+    const AckMsg echo{binary_header<AckMsg>(MsgType::Ack), 0, 7};
+    std::memcpy(bad.data(), &echo, sizeof(echo));
+    process_message(bad, books, tx);  // a server-to-client type is not valid input
+    process_message(std::string_view{in}.substr(0, sizeof(BinaryHeader)), books, tx);  // truncated SUBMIT
+    EXPECT_EQ(describe_binary(tx), "REJECT 0 129|REJECT 0 129|");
+}
+
+TEST(BinaryProtocolTest, RiskAndThrottleRejectsCarryTheirCodes) {
+    BookRegistry books{64, RiskLimits{.maxQuantity = 10, .maxNotional = 1'000, .collar = 2, .maxOpenOrders = 1,
+                                      .maxPosition = 5}};
+    MessageThrottle throttle{7};
+    std::string in, tx;
+    encode_submit(in, Order{.id = 1, .side = Side::Sell, .price = 100, .quantity = 1}, kNoSymbol);
+    encode_submit(in, Order{.id = 2, .side = Side::Buy, .price = 100, .quantity = 11}, kNoSymbol);
+    encode_submit(in, Order{.id = 3, .side = Side::Buy, .price = 200, .quantity = 6}, kNoSymbol);
+    encode_submit(in, Order{.id = 4, .side = Side::Buy, .price = 103, .quantity = 1}, kNoSymbol);
+    encode_submit(in, Order{.id = 5, .side = Side::Sell, .price = 101, .quantity = 1}, kNoSymbol);
+    encode_submit(in, Order{.id = 6, .side = Side::Buy, .type = OrderType::ImmediateOrCancel, .price = 99, .quantity = 6}, kNoSymbol);
+    encode_cancel(in, 1, kNoSymbol);
+    encode_submit(in, Order{.id = 7, .side = Side::Buy, .price = 99, .quantity = 1}, kNoSymbol);
+    encode_submit(in, Order{.id = 8, .side = Side::Buy, .price = 99, .quantity = 1}, kNoSymbol);
+    for (std::string_view rx = in; const std::size_t n = binary_message_size(rx); rx.remove_prefix(n))
+        process_message(rx.substr(0, n), books, tx, nullptr, nullptr, &throttle);
+
+    EXPECT_EQ(describe_binary(tx),
+              "ACK 1|REJECT 2 5|REJECT 3 6|REJECT 4 7|REJECT 5 8|REJECT 6 9|CANCEL_ACK 1|ACK 7|REJECT 8 130|");
+}
+
+TEST(LatencyHistogramTest, PercentilesTrackASortedReference) {
+    for (std::uint64_t v : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123'456'789ull, ~0ull}) {
+        const std::size_t i = LatencyHistogram::index(v);
+        ASSERT_LT(i, LatencyHistogram::kBuckets);
+        EXPECT_GE(LatencyHistogram::highest(i), v);
+        if (i > 0) {
+            EXPECT_LT(LatencyHistogram::highest(i - 1), v) << "buckets are contiguous";
+        }
+    }
+
+    std::mt19937_64 rng{21};
+    std::vector<std::uint64_t> samples;
+    LatencyHistogram a, b;
+    for (int i = 0; i < 100'000; ++i) {
+        const std::uint64_t v = rng() >> (rng() % 60);  // spread over many octaves
+        samples.push_back(v);
+        (i % 2 ? a : b).record(v);
+    }
+    a.merge(b);
+    std::ranges::sort(samples);
+
+    EXPECT_EQ(a.count(), samples.size());
+    EXPECT_EQ(a.max(), samples.back());
+    for (const double p : {1.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+        const std::uint64_t exact =
+            samples[static_cast<std::size_t>(std::ceil(p / 100.0 * static_cast<double>(samples.size()))) - 1];
+        const std::uint64_t got = a.percentile(p);
+        EXPECT_GE(got, exact) << p;
+        EXPECT_LE(static_cast<double>(got - exact), static_cast<double>(exact) / 32.0) << p;
+    }
+    EXPECT_EQ(LatencyHistogram{}.percentile(50), 0u);
+}
+
+TEST(OrderIndexTest, MatchesReferenceMapUnderChurn) {
+    std::pmr::unsynchronized_pool_resource arena;
+    OrderIndex index{&arena};
+    index.reserve(64);  // deliberately small: exercise growth too
+    std::unordered_map<OrderId, OrderHandle> reference;
+
+    std::mt19937_64 rng{7};
+    for (int step = 0; step < 200'000; ++step) {
+        const auto id = static_cast<OrderId>(rng() % 4096);
+        if (rng() % 3 == 0) {
+            const auto got = index.extract(id);
+            const auto it  = reference.find(id);
+            ASSERT_EQ(got.has_value(), it != reference.end()) << "step " << step;
+            if (got) {
+                EXPECT_EQ(*got, it->second);
+                reference.erase(it);
+            }
+        } else if (!index.contains(id)) {
+            const auto h = static_cast<OrderHandle>(step);
+            index.insert(id, h);
+            reference.emplace(id, h);
+        }
+        ASSERT_EQ(index.size(), reference.size());
+    }
+    for (const auto& [id, h] : reference) {
+        const OrderHandle* found = index.find(id);
+        ASSERT_NE(found, nullptr);
+        EXPECT_EQ(*found, h);
+    }
+}
+
 // Any set of operator() overloads satisfying EventSink works as a sink.
 // (Namespace scope: local classes can't have the templated catch-all member.)
 struct Recorder {
@@ -117,6 +661,28 @@ TEST_F(MatchingEngineTest, CustomRecordingSinkSeesFills) {
               (FillEvent{.taker = 2, .maker = 1, .price = 100, .quantity = 3}));
 }
 
+TEST_F(MatchingEngineTest, BatchBuffersEventsAndFlushesThemInOrder) {
+    using TradeEvent = std::variant<AckEvent, FillEvent, CancelAckEvent, RejectEvent>;
+    EventLog events;
+    engine.submitBatch(std::vector<Order>{
+        {.id = 1, .side = Side::Sell, .price = 100, .quantity = 3},
+        {.id = 1, .side = Side::Sell, .price = 100, .quantity = 3},
+        {.id = 2, .side = Side::Buy,  .price = 100, .quantity = 5},
+    }, events);
+    std::vector<TradeEvent> seen;
+    events.replay([&seen]<class E>(const E& e) requires std::constructible_from<TradeEvent, const E&> {
+        seen.emplace_back(e);
+    });
+    EXPECT_EQ(seen, (std::vector<TradeEvent>{
+        AckEvent{1}, RejectEvent{1, RejectReason::DuplicateId}, FillEvent{2, 1, 100, 3}, AckEvent{2},
+    }));
+
+    std::string text;
+    events.flush(FormattingSink{text});
+    EXPECT_EQ(text, "ACK 1\nERR DUPLICATE_ID 1\nFILL 2 1 100 3\nACK 2\n");
+    EXPECT_TRUE(events.empty());
+}
+
 TEST_F(MatchingEngineTest, DumpRendersLevelsBestFirstFifoWithin) {
     NullSink drop;
     engine.submitBatch(std::vector<Order>{
@@ -130,4 +696,249 @@ TEST_F(MatchingEngineTest, DumpRendersLevelsBestFirstFifoWithin) {
               "BIDS:\n100: 1(10) 2(5) \n99: 3(7) \nASKS:\n101: 4(2) \n");
 }
 
+// The same matching semantics must hold for every level-storage policy. A
+// 64-tick ladder keeps the band narrow enough that tests reach the overflow.
+template <class Levels>
+class LevelPolicyTest : public ::testing::Test {
+protected:
+    BasicMatchingEngine<Levels> engine;
+    NullSink drop;
+};
+
+using LevelPolicies = ::testing::Types<MapLevels, LadderLevels<64>>;
+TYPED_TEST_SUITE(LevelPolicyTest, LevelPolicies);
+
+TYPED_TEST(LevelPolicyTest, SweepsInBandAndOverflowLevelsInPriceOrder) {
+    // The first ask anchors the band around 1000; 900 and 5000 fall outside it.
+    this->engine.submitBatch(std::vector<Order>{
+        {.id = 1, .side = Side::Sell, .price = 1000, .quantity = 1},
+        {.id = 2, .side = Side::Sell, .price = 5000, .quantity = 1},
+        {.id = 3, .side = Side::Sell, .price = 900,  .quantity = 1},
+        {.id = 4, .side = Side::Sell, .price = 1010, .quantity = 1},
+    }, this->drop);
+    EXPECT_EQ(this->engine.bestAsk(), Price{900}) << "overflow level beats the band";
+    EXPECT_EQ(this->engine.dump(), "BIDS:\nASKS:\n900: 3(1) \n1000: 1(1) \n1010: 4(1) \n5000: 2(1) \n");
+
+    std::vector<FillEvent> fills;
+    this->engine.submit(Order{.id = 9, .side = Side::Buy, .price = 6000, .quantity = 4},
+                        [&](const auto& e) {
+                            if constexpr (std::same_as<std::remove_cvref_t<decltype(e)>, FillEvent>)
+                                fills.push_back(e);
+                        });
+    ASSERT_EQ(fills.size(), 4u);
+    EXPECT_EQ(fills[0].price, 900);
+    EXPECT_EQ(fills[1].price, 1000);
+    EXPECT_EQ(fills[2].price, 1010);
+    EXPECT_EQ(fills[3].price, 5000);
+    EXPECT_EQ(this->engine.openOrders(), 0u);
+}
+
+TYPED_TEST(LevelPolicyTest, FillOrKillCountsInBandAndOverflowLiquidity) {
+    this->engine.submitBatch(std::vector<Order>{
+        {.id = 1, .side = Side::Sell, .price = 1000, .quantity = 1},
+        {.id = 2, .side = Side::Sell, .price = 5000, .quantity = 1},
+        {.id = 3, .side = Side::Sell, .price = 900,  .quantity = 1},
+        {.id = 4, .side = Side::Sell, .price = 1010, .quantity = 1},
+    }, this->drop);
+
+    std::vector<FillEvent> fills;
+    const auto record = [&](const auto& e) {
+        if constexpr (std::same_as<std::remove_cvref_t<decltype(e)>, FillEvent>) fills.push_back(e);
+    };
+    const auto fok = [](OrderId id, Price px, Quantity qty) {
+        return Order{.id = id, .side = Side::Buy, .type = OrderType::FillOrKill, .price = px, .quantity = qty};
+    };
+    this->engine.submit(fok(9, 4999, 4), record);
+    EXPECT_TRUE(fills.empty()) << "the 5000 overflow level is beyond the limit";
+    this->engine.submit(fok(10, 1010, 3), record);
+    EXPECT_EQ(fills.size(), 3u) << "overflow 900, then the band";
+    this->engine.submit(fok(11, 5000, 2), record);
+    EXPECT_EQ(fills.size(), 3u) << "one order left";
+    EXPECT_EQ(this->engine.dump(), "BIDS:\nASKS:\n5000: 2(1) \n");
+}
+
+TYPED_TEST(LevelPolicyTest, FollowsATouchThatDriftsOutOfTheBand) {
+    // A stale bid keeps the side non-empty while the touch climbs far past
+    // the band it anchored; resting, cancelling and sweeping must still see
+    // every level once the ladder has recentered under them.
+    this->engine.submit(Order{.id = 1, .side = Side::Buy, .price = 1000, .quantity = 1}, this->drop);
+    for (OrderId id = 2; id <= 400; ++id)
+        this->engine.submit(Order{.id = id, .side = Side::Buy, .price = static_cast<Price>(1000 + 5 * id), .quantity = 1},
+                            this->drop);
+    EXPECT_EQ(this->engine.bestBid(), Price{3000});
+    EXPECT_EQ(this->engine.openOrders(), 400u);
+
+    for (OrderId id = 3; id <= 400; id += 3) this->engine.cancel(id, this->drop);
+    this->engine.cancel(1, this->drop);
+
+    std::vector<FillEvent> fills;
+    this->engine.submit(Order{.id = 999, .side = Side::Sell, .price = 0, .quantity = 1000},
+                        [&](const auto& e) {
+                            if constexpr (std::same_as<std::remove_cvref_t<decltype(e)>, FillEvent>)
+                                fills.push_back(e);
+                        });
+    ASSERT_EQ(fills.size(), 266u);
+    EXPECT_TRUE(std::ranges::is_sorted(fills, std::greater<>{}, &FillEvent::price));
+    EXPECT_EQ(fills.back().price, 1010);
+    EXPECT_EQ(this->engine.openOrders(), 1u) << "the sell remainder rests";
+}
+
+TEST(LadderBookTest, RecentersOnATouchThatLeftTheBand) {
+    LadderBook<Side::Buy, 64> book{std::pmr::get_default_resource()};
+    PriceLevel& stale = book.level(1000);  // anchors the band at [968, 1032)
+    stale.quantity = 1;
+    for (Price px = 1100; px < 1100 + 64; ++px) book.level(px).quantity = 1;
+    EXPECT_TRUE(book.drifted());
+
+    std::vector<Price> moved;
+    book.recenter([&](PriceLevel& lvl) { moved.push_back(lvl.price); });
+    EXPECT_FALSE(book.drifted());
+    EXPECT_EQ(moved.size(), 34u) << "the stale level leaves the band, 1131..1163 join it";
+    EXPECT_EQ(book.best()->price, 1163);
+
+    std::vector<Price> seen;
+    book.forEach([&](const PriceLevel& lvl) {
+        EXPECT_EQ(lvl.quantity, 1);
+        seen.push_back(lvl.price);
+    });
+    ASSERT_EQ(seen.size(), 65u);
+    EXPECT_EQ(seen.front(), 1163);
+    EXPECT_EQ(seen.back(), 1000);
+    EXPECT_TRUE(std::ranges::is_sorted(seen, std::greater<>{}));
+    EXPECT_NE(book.find(1000), nullptr);
+}
+
+TYPED_TEST(LevelPolicyTest, BatchMatchesOrderByOrderSubmission) {
+    BasicMatchingEngine<TypeParam> single{64};  // small: the batch path grows them up front
+    BasicMatchingEngine<TypeParam> batched{64};
+    BookEventLog want, got;
+
+    std::mt19937 rng{17};
+    std::vector<Order> burst;
+    for (OrderId next = 1; next <= 20'000;) {
+        burst.clear();
+        for (auto n = 1 + rng() % 500; n-- != 0; ++next) {
+            burst.push_back(Order{.id       = rng() % 16 == 0 ? next / 2 : next,  // some duplicates
+                                  .side     = rng() % 2 ? Side::Buy : Side::Sell,
+                                  .type     = static_cast<OrderType>(rng() % 8 < 4 ? 0 : rng() % 5),
+                                  .price    = 1000 + static_cast<Price>(rng() % 200) - 100,
+                                  .quantity = static_cast<Quantity>(rng() % 20)});  // 0 is rejected
+        }
+        for (const Order& o : burst) single.submit(o, want);
+        batched.submitBatch(burst, got);
+    }
+    EXPECT_TRUE(got == want) << "same events, book updates included, in the same order";
+    EXPECT_EQ(batched.dump(), single.dump());
+}
+
+TYPED_TEST(LevelPolicyTest, EventLogReplaysExactlyWhatWasRecorded) {
+    using BookEvent = std::variant<AckEvent, FillEvent, CancelAckEvent, RejectEvent, OrderUpdateEvent,
+                                   LevelUpdateEvent>;
+    BasicMatchingEngine<TypeParam> direct;
+    BasicMatchingEngine<TypeParam> logged;
+    BasicMatchingEngine<TypeParam> formatted;
+    std::vector<BookEvent> want, got;
+    const auto record = [](std::vector<BookEvent>& into) {
+        return [&into](const auto& e) { into.emplace_back(e); };
+    };
+    BookEventLog log;
+    std::string wantText, gotText;
+
+    std::mt19937 rng{23};
+    for (OrderId id = 1; id <= 5'000; ++id) {
+        const auto apply = [&](auto& book, auto&& sink) {
+            if (id % 7 == 0) {
+                book.cancel(1 + static_cast<OrderId>(rng() % id), sink);
+            } else if (id % 11 == 0) {
+                book.modify(1 + static_cast<OrderId>(rng() % id), 1000 + static_cast<Price>(rng() % 80) - 40,
+                              static_cast<Quantity>(rng() % 20), sink);
+            } else {
+                book.submit(Order{.id = rng() % 32 == 0 ? id - 1 : id, .side = rng() % 2 ? Side::Buy : Side::Sell,
+                                    .type = rng() % 8 == 0 ? OrderType::PostOnly : OrderType::Limit,
+                                    .price = 1000 + static_cast<Price>(rng() % 80) - 40,
+                                    .quantity = -1 + static_cast<Quantity>(rng() % 20)}, sink);
+            }
+        };
+        const auto seed = rng();
+        rng.seed(seed);
+        apply(direct, record(want));
+        rng.seed(seed);
+        apply(logged, log);
+        rng.seed(seed);
+        apply(formatted, FormattingSink{wantText});
+    }
+    log.replay(record(got));
+    EXPECT_EQ(got, want) << "every event kind and field survives the round trip";
+
+    log.flush(FormattingSink{gotText});  // book updates are skipped for trade-only sinks
+    EXPECT_EQ(gotText, wantText);
+    EXPECT_TRUE(log.empty());
+}
+
+TYPED_TEST(LevelPolicyTest, DepthObserversMatchAQueueWalk) {
+    auto& book = this->engine;
+    EXPECT_EQ(book.depthAt(Side::Buy, 1000), (LevelDepth{1000, 0, 0})) << "empty book";
+
+    // Levels as a walk of every resting order sees them, best first.
+    const auto walked = [&](Side side) {
+        std::vector<LevelDepth> levels;
+        book.forEachResting([&](const Order& o) {
+            if (o.side != side) return;
+            if (levels.empty() || levels.back().price != o.price) levels.push_back(LevelDepth{o.price, 0, 0});
+            levels.back().quantity += o.quantity;
+            ++levels.back().orders;
+        });
+        return levels;
+    };
+
+    std::mt19937 rng{29};
+    for (OrderId id = 1; id <= 20'000; ++id) {
+        if (const auto roll = rng() % 6; roll < 2) {
+            book.cancel(1 + static_cast<OrderId>(rng() % id), this->drop);
+        } else if (roll == 2) {
+            book.modify(1 + static_cast<OrderId>(rng() % id), 1000 + static_cast<Price>(rng() % 200) - 100,
+                          1 + static_cast<Quantity>(rng() % 20), this->drop);
+        } else {
+            book.submit(Order{.id = id, .side = rng() % 2 ? Side::Buy : Side::Sell,
+                                .type    = static_cast<OrderType>(rng() % 8 < 4 ? 0 : rng() % 5),
+                                .stp     = static_cast<SelfTradePrevention>(rng() % 5),
+                                .account = static_cast<Account>(rng() % 3),
+                                .price   = 1000 + static_cast<Price>(rng() % 200) - 100,
+                                .quantity = 1 + static_cast<Quantity>(rng() % 20)}, this->drop);
+        }
+        if (id % 1000 != 0) continue;
+
+        for (const Side side : {Side::Buy, Side::Sell}) {
+            const std::vector<LevelDepth> want = walked(side);
+            std::vector<LevelDepth> got(want.size() + 1);
+            got.resize(book.topLevels(side, got));
+            ASSERT_EQ(got, want) << "after " << id;
+
+            std::array<LevelDepth, 3> top{};
+            EXPECT_EQ(book.topLevels(side, top), std::min<std::size_t>(3, want.size())) << "truncated";
+            for (const LevelDepth& level : want) ASSERT_EQ(book.depthAt(side, level.price), level);
+        }
+    }
+}
+
+TYPED_TEST(LevelPolicyTest, BestCursorSkipsEmptiedLevels) {
+    this->engine.submitBatch(std::vector<Order>{
+        {.id = 1, .side = Side::Buy, .price = 100, .quantity = 1},
+        {.id = 2, .side = Side::Buy, .price = 97,  .quantity = 1},
+        {.id = 3, .side = Side::Buy, .price = 20,  .quantity = 1},  // overflow (worse)
+    }, this->drop);
+    this->engine.cancel(1, this->drop);
+    EXPECT_EQ(this->engine.bestBid(), Price{97});
+    this->engine.cancel(2, this->drop);
+    EXPECT_EQ(this->engine.bestBid(), Price{20});
+    this->engine.cancel(3, this->drop);
+    EXPECT_FALSE(this->engine.bestBid().has_value());
+
+    // An emptied side re-anchors its band around the next price it sees.
+    this->engine.submit(Order{.id = 4, .side = Side::Buy, .price = 100000, .quantity = 2}, this->drop);
+    this->engine.submit(Order{.id = 5, .side = Side::Buy, .price = 100001, .quantity = 2}, this->drop);
+    EXPECT_EQ(this->engine.bestBid(), Price{100001});
+    EXPECT_EQ(this->engine.dump(), "BIDS:\n100001: 5(2) \n100000: 4(2) \nASKS:\n");
+}
+
 }  // namespace
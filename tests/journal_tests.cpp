@@ -0,0 +1,383 @@
+// Unit tests for the write-ahead journal, book snapshots and startup
+// recovery (GoogleTest).
+
+#include "BookRegistry.hpp"
+#include "Journal.hpp"
+#include "Protocol.hpp"
+#include "Server.hpp"
+#include "ShardedEngine.hpp"
+#include "Snapshot.hpp"
+#include "Symbol.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <array>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+class JournalTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_path = std::filesystem::temp_directory_path() /
+                 std::format("engine_journal_{}_{}.bin", ::getpid(),
+                             ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove(m_path);
+    }
+    void TearDown() override {
+        std::filesystem::remove(m_path);
+        std::filesystem::remove(snapshotPath());
+    }
+
+    [[nodiscard]] std::string path() const { return m_path.string(); }
+    [[nodiscard]] std::string snapshotPath() const { return m_path.string() + ".snap"; }
+
+    static constexpr Journal::Config kConfig{.sync = Journal::Sync::Data, .ringCapacity = 64};
+
+    /// Replay the journal into `books`.
+    [[nodiscard]] std::size_t recover(BookRegistry& books) const {
+        auto reader = JournalReader::load(path());
+        EXPECT_TRUE(reader.has_value());
+        if (!reader) return 0;
+        Session replay = SessionFactory{books}.make(0);
+        return replay_journal(*reader, replay);
+    }
+
+private:
+    std::filesystem::path m_path;
+};
+
+const std::array kSymbols{"AAPL", "MSFT"};
+
+void add_symbols(BookRegistry& books) {
+    for (const char* name : kSymbols) books.add(*encode_symbol(name));
+}
+
+/// Random text order flow over the default book and kSymbols, some of it
+/// under self-trade prevention, including commands that are rejected or
+/// never reach a book.
+std::vector<std::string> order_flow(int count) {
+    std::mt19937 rng{5};
+    std::vector<std::string> lines;
+    for (int i = 1; i <= count; ++i) {
+        const char* const symbol = std::array{"", "AAPL ", "MSFT ", "GOOG "}[rng() % 4];
+        if (const auto roll = rng() % 8; roll < 2) {
+            lines.push_back(std::format("CANCEL {}{}", symbol, 1 + rng() % i));
+        } else if (roll == 2) {
+            lines.push_back(std::format("MODIFY {}{} {} {}", symbol, 1 + rng() % i, 95 + rng() % 11, rng() % 10));
+        } else {
+            const char* const owner = std::array{"", "", " ACCT=1 STP=OLDEST", " ACCT=2 STP=DECREMENT"}[rng() % 4];
+            lines.push_back(std::format("SUBMIT {}{} {} {} {}{}", symbol, i, rng() % 2 ? 'B' : 'S',
+                                        95 + rng() % 11, rng() % 10, owner));  // qty 0 is rejected
+        }
+    }
+    return lines;
+}
+
+std::string dump_all(BookRegistry& books) {
+    std::string out = books.find(kNoSymbol)->dump();
+    for (const char* name : kSymbols) out += books.find(*encode_symbol(name))->dump();
+    return out;
+}
+
+TEST_F(JournalTest, ReplayRebuildsTheBooks) {
+    BookRegistry live{256};
+    add_symbols(live);
+    {
+        const auto journal = Journal::open(path(), kConfig);  // ring far smaller than the flow
+        ASSERT_NE(journal, nullptr);
+        Session session = SessionFactory{live, journal.get()}.make(1);
+        std::string tx;
+        for (const auto& line : order_flow(5000)) std::get<InlineSession>(session).line(line, tx);
+
+        journal->flush();
+        EXPECT_EQ(journal->durable(), journal->appended());
+        EXPECT_TRUE(journal->healthy());
+    }
+
+    BookRegistry recovered{256};
+    add_symbols(recovered);
+    EXPECT_GT(recover(recovered), 0u);
+    EXPECT_EQ(dump_all(recovered), dump_all(live));
+}
+
+TEST_F(JournalTest, FailedJournalStopsWritingAndSessionsRejectCommands) {
+    BookRegistry books{16};
+    auto journal = Journal::open(path(), kConfig);
+    ASSERT_NE(journal, nullptr);
+    const auto header = std::filesystem::file_size(path());
+
+    // Cap files at their current size so the next write fails with EFBIG.
+    const auto previous = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit saved{};
+    ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &saved), 0);
+    rlimit capped = saved;
+    capped.rlim_cur = header;
+    ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &capped), 0);
+    std::string out;
+    static_cast<void>(process_command(parse_command("SUBMIT 1 B 100 5"), books, out, journal.get()));
+    journal->flush();  // returns on failure too
+    ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &saved), 0);
+    std::signal(SIGXFSZ, previous);
+
+    EXPECT_EQ(out, "ACK 1\n") << "failed after the fact";
+    EXPECT_FALSE(journal->healthy());
+    out.clear();
+    for (const char* line : {"SUBMIT 2 B 100 5", "MODIFY 1 100 4", "CANCEL 1"})
+        static_cast<void>(process_command(parse_command(line), books, out, journal.get()));
+    EXPECT_EQ(out, "ERR JOURNAL_FAILED 2\nERR JOURNAL_FAILED 1\nERR JOURNAL_FAILED 1\n");
+    EXPECT_EQ(books.book(BookRegistry::kDefaultBook).openOrders(), 1u) << "nothing applied unrecorded";
+
+    journal->append(CancelCommand{1});
+    journal.reset();
+    EXPECT_EQ(std::filesystem::file_size(path()), header) << "nothing written after the failure";
+}
+
+TEST_F(JournalTest, ShardedSessionsJournalToo) {
+    std::vector<SymbolCode> symbols;
+    for (const char* name : kSymbols) symbols.push_back(*encode_symbol(name));
+    ShardedEngine engine{symbols, ShardedEngine::Config{.shards = 2, .queueCapacity = 1024,
+                                                        .ordersPerBook = 256, .firstCpu = -1}};
+    BookRegistry reference{256};
+    add_symbols(reference);
+    {
+        const auto journal = Journal::open(path(), kConfig);
+        ASSERT_NE(journal, nullptr);
+        ShardedSession session{engine, 0, journal.get()};
+        std::string tx, ignored;
+        for (const auto& line : order_flow(2000)) {
+            session.line(line, tx);
+            static_cast<void>(process_line(line, reference, ignored));
+        }
+        session.flush(tx);
+    }
+
+    BookRegistry recovered{256};
+    add_symbols(recovered);
+    static_cast<void>(recover(recovered));
+    EXPECT_EQ(dump_all(recovered), dump_all(reference));
+}
+
+TEST_F(JournalTest, TornTailIsDroppedAndAppendsResume) {
+    {
+        const auto journal = Journal::open(path(), kConfig);
+        ASSERT_NE(journal, nullptr);
+        journal->append(SubmitCommand{Order{.id = 1, .side = Side::Buy, .price = 100, .quantity = 5}});
+        journal->append(SubmitCommand{Order{.id = 2, .side = Side::Buy, .price = 101, .quantity = 5}});
+    }
+    {
+        std::ofstream out{path(), std::ios::binary | std::ios::app};
+        out.write("\x28\x00\x01", 3);  // a crash mid-record
+    }
+    {
+        const auto journal = Journal::open(path(), kConfig);
+        ASSERT_NE(journal, nullptr);
+        journal->append(CancelCommand{1});
+    }
+
+    BookRegistry recovered{16};
+    EXPECT_EQ(recover(recovered), 3u);
+    EXPECT_EQ(recovered.find(kNoSymbol)->dump(), "BIDS:\n101: 2(5) \nASKS:\n");
+}
+
+TEST_F(JournalTest, RefusesAFileThatIsNotAJournal) {
+    {
+        std::ofstream out{path(), std::ios::binary};
+        out << "SUBMIT 1 B 100 5\nSUBMIT 2 S 100 5\n";
+    }
+    EXPECT_FALSE(JournalReader::load(path()).has_value());
+    EXPECT_EQ(Journal::open(path(), kConfig), nullptr);
+}
+
+TEST_F(JournalTest, MissingFileIsAnEmptyJournal) {
+    auto reader = JournalReader::load(path());
+    ASSERT_TRUE(reader.has_value());
+    EXPECT_FALSE(reader->next().has_value());
+}
+
+TEST_F(JournalTest, SnapshotRestoresLevelsFifoAndIndex) {
+    BookRegistry live{256};
+    add_symbols(live);
+    std::string ignored;
+    for (const auto& line : order_flow(5000)) static_cast<void>(process_line(line, live, ignored));
+    ASSERT_TRUE(write_snapshot(snapshotPath(), live, 1234));
+
+    BookRegistry restored{16};  // symbols come from the snapshot
+    EXPECT_EQ(load_snapshot(snapshotPath(), restored), 1234u);
+    EXPECT_EQ(restored.size(), live.size());
+    EXPECT_EQ(dump_all(restored), dump_all(live));
+
+    // Same future: crossing orders fill in the same FIFO order, and cancels
+    // find the same ids through the rebuilt index. Accounts survive too: a
+    // self-trade-preventing order skips the same makers on both.
+    for (int id = 1; id <= 5000; id += 7) {
+        for (const char* symbol : {"", "AAPL ", "MSFT "}) {
+            for (const std::string& line : {std::format("CANCEL {}{}", symbol, id),
+                                            std::format("SUBMIT {}{} {} 100 7{}", symbol, 10'000 + id,
+                                                        id % 2 ? 'B' : 'S', id % 3 ? "" : " ACCT=1 STP=OLDEST")}) {
+                std::string want, got;
+                static_cast<void>(process_line(line, live, want));
+                static_cast<void>(process_line(line, restored, got));
+                ASSERT_EQ(got, want) << line;
+            }
+        }
+    }
+}
+
+TEST_F(JournalTest, SnapshotPlusJournalTailMatchesFullReplay) {
+    BookRegistry live{256};
+    add_symbols(live);
+    const auto flow = order_flow(6000);
+    {
+        const auto journal = Journal::open(path(), kConfig);
+        ASSERT_NE(journal, nullptr);
+        Session session = SessionFactory{live, journal.get()}.make(1);
+        std::string tx;
+        for (std::size_t i = 0; i < flow.size(); ++i) {
+            std::get<InlineSession>(session).line(flow[i], tx);
+            if (i == flow.size() / 2) {
+                ASSERT_TRUE(write_snapshot(snapshotPath(), live, journal->appended()));
+            }
+        }
+    }
+
+    BookRegistry recovered{256};
+    const auto covered = load_snapshot(snapshotPath(), recovered);
+    ASSERT_TRUE(covered.has_value());
+    auto reader = JournalReader::load(path());
+    ASSERT_TRUE(reader.has_value());
+    ASSERT_TRUE(reader->skip(*covered));
+    Session replay = SessionFactory{recovered}.make(0);
+    EXPECT_GT(replay_journal(*reader, replay), 0u);
+    EXPECT_EQ(dump_all(recovered), dump_all(live));
+
+    auto fresh = JournalReader::load(path());
+    ASSERT_TRUE(fresh.has_value());
+    EXPECT_FALSE(fresh->skip(reader->records() + 1)) << "cannot skip past the end";
+}
+
+TEST_F(JournalTest, SnapshotCarriesRiskPositions) {
+    constexpr RiskLimits kLimits{.maxPosition = 10};
+    BookRegistry live{16, kLimits};
+    std::string ignored;
+    for (const char* line : {"SUBMIT 1 S 100 8 ACCT=2", "SUBMIT 2 B 100 8 ACCT=1", "SUBMIT 3 S 101 1 ACCT=2"})
+        static_cast<void>(process_line(line, live, ignored));
+    ASSERT_TRUE(write_snapshot(snapshotPath(), live, 0));
+
+    BookRegistry restored{16, kLimits};
+    ASSERT_EQ(load_snapshot(snapshotPath(), restored), 0u);
+    const RiskGate& risk = restored.book(BookRegistry::kDefaultBook).risk();
+    EXPECT_EQ(risk.position(1), 8);
+    EXPECT_EQ(risk.position(2), -8);
+    EXPECT_EQ(risk.openQuantity(2, Side::Sell), 1) << "rebuilt from the resting orders";
+
+    for (const char* line : {"SUBMIT 4 B 99 3 ACCT=1", "SUBMIT 5 S 102 2 ACCT=2", "SUBMIT 6 S 102 1 ACCT=2"}) {
+        std::string want, got;
+        static_cast<void>(process_line(line, live, want));
+        static_cast<void>(process_line(line, restored, got));
+        EXPECT_EQ(got, want) << line;
+    }
+}
+
+TEST_F(JournalTest, SnapshotKeepsFlatAccountsSlots) {
+    // Both accounts trade back to flat with nothing resting; their slots are
+    // still taken, so a third account is refused before and after restore.
+    constexpr RiskLimits kLimits{.maxPosition = 10, .accountSlots = 2};
+    BookRegistry live{16, kLimits};
+    std::string ignored;
+    for (const char* line : {"SUBMIT 1 S 100 5 ACCT=2", "SUBMIT 2 B 100 5 ACCT=1",
+                             "SUBMIT 3 B 100 5 ACCT=2", "SUBMIT 4 S 100 5 ACCT=1"})
+        static_cast<void>(process_line(line, live, ignored));
+    ASSERT_EQ(live.book(BookRegistry::kDefaultBook).openOrders(), 0u);
+    ASSERT_TRUE(write_snapshot(snapshotPath(), live, 0));
+
+    BookRegistry restored{16, kLimits};
+    ASSERT_EQ(load_snapshot(snapshotPath(), restored), 0u);
+    EXPECT_EQ(restored.book(BookRegistry::kDefaultBook).risk().position(1), 0);
+
+    for (const char* line : {"SUBMIT 5 B 100 1 ACCT=3", "SUBMIT 6 B 100 1 ACCT=1"}) {
+        std::string want, got;
+        static_cast<void>(process_line(line, live, want));
+        static_cast<void>(process_line(line, restored, got));
+        EXPECT_EQ(got, want) << line;
+    }
+    std::string refused;
+    static_cast<void>(process_line("SUBMIT 7 B 100 1 ACCT=3", restored, refused));
+    EXPECT_EQ(refused, "ERR RISK_ACCOUNTS 7\n");
+}
+
+TEST_F(JournalTest, SnapshotKeepsEachOrdersSelfTradePrevention) {
+    BookRegistry live{16};
+    std::string ignored;
+    for (const char* line : {"SUBMIT 1 B 100 5 ACCT=1", "SUBMIT 2 S 105 5 ACCT=1 STP=NEWEST"})
+        static_cast<void>(process_line(line, live, ignored));
+    ASSERT_TRUE(write_snapshot(snapshotPath(), live, 0));
+
+    BookRegistry restored{16};
+    ASSERT_EQ(load_snapshot(snapshotPath(), restored), 0u);
+    std::string want, got;
+    static_cast<void>(process_line("MODIFY 2 100 5", live, want));
+    static_cast<void>(process_line("MODIFY 2 100 5", restored, got));
+    EXPECT_EQ(want, "ERR SELF_TRADE 2\n");
+    EXPECT_EQ(got, want) << "re-entered with its own mode, not as a plain order";
+    EXPECT_EQ(restored.book(BookRegistry::kDefaultBook).dump(), live.book(BookRegistry::kDefaultBook).dump());
+}
+
+TEST_F(JournalTest, RejectsMalformedSnapshots) {
+    BookRegistry books{16};
+    std::string ignored;
+    for (int id = 1; id <= 10; ++id)
+        static_cast<void>(process_line(std::format("SUBMIT {} B {} 5", id, 90 + id), books, ignored));
+    ASSERT_TRUE(write_snapshot(snapshotPath(), books, 0));
+
+    BookRegistry target{16};
+    EXPECT_FALSE(load_snapshot(snapshotPath(), books).has_value()) << "books must be empty";
+
+    // Records that decode but would break the book: patch one field of the
+    // image at a time. Bids are written best-first, so the first level is
+    // 100 holding order 10 and the second 99 holding order 9.
+    std::string image;
+    {
+        std::ifstream in{snapshotPath(), std::ios::binary};
+        image.assign(std::istreambuf_iterator<char>{in}, {});
+    }
+    constexpr std::size_t kFirstOrder  = sizeof(SnapshotHeader) + sizeof(SnapshotBook) + sizeof(SnapshotLevel);
+    constexpr std::size_t kSecondLevel = kFirstOrder + sizeof(SnapshotOrder);
+    constexpr std::size_t kSecondOrder = kSecondLevel + sizeof(SnapshotLevel);
+    const auto loadPatched = [&]<class T>(std::size_t at, T value) {
+        std::string patched = image;
+        std::memcpy(patched.data() + at, &value, sizeof(value));
+        std::ofstream{snapshotPath(), std::ios::binary | std::ios::trunc} << patched;
+        BookRegistry fresh{16};
+        return load_snapshot(snapshotPath(), fresh).has_value();
+    };
+    ASSERT_TRUE(loadPatched(kFirstOrder, OrderId{10})) << "the unpatched image loads";
+    EXPECT_FALSE(loadPatched(kFirstOrder + offsetof(SnapshotOrder, quantity), Quantity{0})) << "empty order";
+    EXPECT_FALSE(loadPatched(kSecondOrder, OrderId{10})) << "id already resting";
+    EXPECT_FALSE(loadPatched(kSecondLevel + offsetof(SnapshotLevel, side), Side::Sell)) << "ask at 99 crosses 100";
+    EXPECT_FALSE(loadPatched(kFirstOrder + offsetof(SnapshotOrder, stp), std::uint8_t{9})) << "unknown stp mode";
+
+    std::ofstream{snapshotPath(), std::ios::binary | std::ios::trunc} << image;
+    std::filesystem::resize_file(snapshotPath(), std::filesystem::file_size(snapshotPath()) - 8);
+    EXPECT_FALSE(load_snapshot(snapshotPath(), target).has_value()) << "truncated";
+
+    { std::ofstream{snapshotPath(), std::ios::binary} << "definitely not a snapshot, but long enough"; }
+    EXPECT_FALSE(load_snapshot(snapshotPath(), target).has_value());
+
+    std::filesystem::remove(snapshotPath());
+    EXPECT_EQ(load_snapshot(snapshotPath(), target), 0u) << "no snapshot yet";
+}
+
+}  // namespace
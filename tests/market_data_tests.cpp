@@ -0,0 +1,361 @@
+// Unit tests for the engine's L2/L3 market-data feed, the DepthBook
+// consumer and the shared-memory feed ring (GoogleTest).
+
+#include "BookRegistry.hpp"
+#include "MarketData.hpp"
+#include "MarketDataRing.hpp"
+#include "MatchingEngine.hpp"
+#include "Server.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+
+using FeedEvent = std::variant<AckEvent, FillEvent, CancelAckEvent, RejectEvent, OrderUpdateEvent, LevelUpdateEvent>;
+
+/// Records every event in delivery order.
+struct FeedRecorder {
+    std::vector<FeedEvent> events;
+    void operator()(const auto& e) { events.emplace_back(e); }
+};
+static_assert(MarketDataSink<FeedRecorder>);
+
+/// Order-by-order mirror of a book rebuilt from L3 events alone, checking
+/// each L2 event against it as it arrives.
+class L3Mirror {
+public:
+    void operator()(const OrderUpdateEvent& e) {
+        auto& queue = e.side == Side::Buy ? m_bids[e.price] : m_asks[e.price];
+        const auto it = std::ranges::find(queue, e.id, &Resting::id);
+        switch (e.action) {
+            using enum BookAction;
+            case Add:
+                ASSERT_EQ(it, queue.end()) << "order " << e.id << " added twice";
+                queue.push_back({e.id, e.quantity});
+                break;
+            case Modify:
+                ASSERT_NE(it, queue.end()) << "order " << e.id << " modified before it was added";
+                ASSERT_GT(e.quantity, 0);
+                it->quantity = e.quantity;
+                break;
+            case Delete:
+                ASSERT_NE(it, queue.end()) << "order " << e.id << " deleted before it was added";
+                ASSERT_EQ(e.quantity, 0);
+                queue.erase(it);
+                break;
+        }
+        if (queue.empty()) {
+            if (e.side == Side::Buy) m_bids.erase(e.price);
+            else                     m_asks.erase(e.price);
+        }
+    }
+
+    void operator()(const LevelUpdateEvent& e) {
+        EXPECT_EQ(e.quantity, aggregate(e.side, e.price)) << "level " << e.price << " out of step with its orders";
+        depth.apply(e);
+    }
+
+    void operator()(const auto&) {}  // trade events
+
+    /// The mirror rendered in MatchingEngine::dump() format.
+    [[nodiscard]] std::string dump() const {
+        std::string out = "BIDS:\n";
+        renderSide(out, m_bids);
+        out += "ASKS:\n";
+        renderSide(out, m_asks);
+        return out;
+    }
+
+    /// Every level on `side`, best first, as the L3 orders add up.
+    [[nodiscard]] std::vector<DepthLevel> levels(Side side) const {
+        std::vector<DepthLevel> out;
+        const auto collect = [&](const auto& book) {
+            for (const auto& [price, queue] : book) out.push_back({price, aggregate(side, price)});
+        };
+        if (side == Side::Buy) collect(m_bids);
+        else                   collect(m_asks);
+        return out;
+    }
+
+    DepthBook depth;  // fed from the same stream's L2 events
+
+private:
+    struct Resting {
+        OrderId  id;
+        Quantity quantity;
+    };
+
+    [[nodiscard]] Quantity aggregate(Side side, Price price) const {
+        const auto sum = [price](const auto& book) {
+            Quantity total = 0;
+            if (const auto it = book.find(price); it != book.end())
+                for (const Resting& r : it->second) total += r.quantity;
+            return total;
+        };
+        return side == Side::Buy ? sum(m_bids) : sum(m_asks);
+    }
+
+    static void renderSide(std::string& out, const auto& book) {
+        for (const auto& [price, queue] : book) {
+            out += std::format("{}: ", price);
+            for (const Resting& r : queue) out += std::format("{}({}) ", r.id, r.quantity);
+            out += '\n';
+        }
+    }
+
+    std::map<Price, std::vector<Resting>, std::greater<>> m_bids;
+    std::map<Price, std::vector<Resting>>                 m_asks;
+};
+static_assert(MarketDataSink<L3Mirror>);
+
+template <class Levels>
+class MarketDataTest : public ::testing::Test {
+protected:
+    BasicMatchingEngine<Levels> engine;
+};
+
+using LevelPolicies = ::testing::Types<MapLevels, LadderLevels<64>>;
+TYPED_TEST_SUITE(MarketDataTest, LevelPolicies);
+
+TYPED_TEST(MarketDataTest, FillsAndCancelsReportOrdersThenTheirLevel) {
+    FeedRecorder feed;
+    this->engine.submit(Order{.id = 1, .side = Side::Sell, .price = 100, .quantity = 3}, feed);
+    this->engine.submit(Order{.id = 2, .side = Side::Sell, .price = 100, .quantity = 4}, feed);
+    EXPECT_EQ(feed.events, (std::vector<FeedEvent>{
+        OrderUpdateEvent{BookAction::Add, 1, Side::Sell, 100, 3}, LevelUpdateEvent{Side::Sell, 100, 3}, AckEvent{1},
+        OrderUpdateEvent{BookAction::Add, 2, Side::Sell, 100, 4}, LevelUpdateEvent{Side::Sell, 100, 7}, AckEvent{2},
+    }));
+
+    feed.events.clear();
+    this->engine.submit(Order{.id = 3, .side = Side::Buy, .price = 101, .quantity = 6}, feed);
+    EXPECT_EQ(feed.events, (std::vector<FeedEvent>{
+        FillEvent{3, 1, 100, 3}, OrderUpdateEvent{BookAction::Delete, 1, Side::Sell, 100, 0},
+        FillEvent{3, 2, 100, 3}, OrderUpdateEvent{BookAction::Modify, 2, Side::Sell, 100, 1},
+        LevelUpdateEvent{Side::Sell, 100, 1},  // one L2 update for the whole walk
+        AckEvent{3},
+    }));
+
+    feed.events.clear();
+    this->engine.cancel(2, feed);
+    this->engine.cancel(2, feed);
+    EXPECT_EQ(feed.events, (std::vector<FeedEvent>{
+        OrderUpdateEvent{BookAction::Delete, 2, Side::Sell, 100, 0}, LevelUpdateEvent{Side::Sell, 100, 0},
+        CancelAckEvent{2},
+        RejectEvent{2, RejectReason::UnknownOrder},  // rejects leave the book, and the feed, alone
+    }));
+}
+
+TYPED_TEST(MarketDataTest, ModifiesReportPriorityLossAsDeleteThenAdd) {
+    FeedRecorder feed;
+    this->engine.submit(Order{.id = 1, .side = Side::Buy, .price = 100, .quantity = 5}, feed);
+    feed.events.clear();
+
+    this->engine.modify(1, 100, 3, feed);
+    this->engine.modify(1, 100, 4, feed);
+    this->engine.modify(1, 101, 4, feed);
+    EXPECT_EQ(feed.events, (std::vector<FeedEvent>{
+        OrderUpdateEvent{BookAction::Modify, 1, Side::Buy, 100, 3}, LevelUpdateEvent{Side::Buy, 100, 3}, AckEvent{1},
+        OrderUpdateEvent{BookAction::Delete, 1, Side::Buy, 100, 0},
+        OrderUpdateEvent{BookAction::Add, 1, Side::Buy, 100, 4}, LevelUpdateEvent{Side::Buy, 100, 4}, AckEvent{1},
+        OrderUpdateEvent{BookAction::Delete, 1, Side::Buy, 100, 0}, LevelUpdateEvent{Side::Buy, 100, 0},
+        OrderUpdateEvent{BookAction::Add, 1, Side::Buy, 101, 4}, LevelUpdateEvent{Side::Buy, 101, 4}, AckEvent{1},
+    }));
+}
+
+TYPED_TEST(MarketDataTest, FeedReproducesTheBook) {
+    L3Mirror mirror;
+    std::mt19937 rng{13};
+    for (OrderId id = 1; id <= 20'000; ++id) {
+        if (const auto roll = rng() % 6; roll < 2) {
+            this->engine.cancel(1 + static_cast<OrderId>(rng() % id), mirror);
+        } else if (roll == 2) {
+            this->engine.modify(1 + static_cast<OrderId>(rng() % id), 1000 + static_cast<Price>(rng() % 40) - 20,
+                                1 + static_cast<Quantity>(rng() % 50), mirror);
+        } else {
+            // Wide enough to spill out of a 64-tick ladder now and then.
+            const Price px = 1000 + static_cast<Price>(rng() % 2 ? rng() % 40 : rng() % 400) - 20;
+            this->engine.submit(Order{.id = id, .side = rng() % 2 ? Side::Buy : Side::Sell,
+                                      .stp     = static_cast<SelfTradePrevention>(rng() % 5),
+                                      .account = static_cast<Account>(rng() % 4), .price = px,
+                                      .quantity = 1 + static_cast<Quantity>(rng() % 50)}, mirror);
+        }
+        if (::testing::Test::HasFailure()) return;
+        if (id % 5000 == 0) {
+            ASSERT_EQ(mirror.dump(), this->engine.dump()) << "after " << id;
+        }
+    }
+
+    for (const Side side : {Side::Buy, Side::Sell}) {
+        const std::vector<DepthLevel> want = mirror.levels(side);
+        std::vector<DepthLevel> got(want.size() + 1);
+        got.resize(mirror.depth.top(side, got));
+        EXPECT_EQ(got, want);
+    }
+}
+
+TEST(DepthBookTest, TopLevelsAreBestFirstAndTruncated) {
+    DepthBook depth;
+    for (const LevelUpdateEvent& e : {
+             LevelUpdateEvent{Side::Buy, 99, 5},  LevelUpdateEvent{Side::Buy, 101, 1},
+             LevelUpdateEvent{Side::Buy, 100, 2}, LevelUpdateEvent{Side::Buy, 100, 7},  // replaces
+             LevelUpdateEvent{Side::Sell, 104, 3}, LevelUpdateEvent{Side::Sell, 102, 4},
+             LevelUpdateEvent{Side::Sell, 103, 1}, LevelUpdateEvent{Side::Sell, 102, 0},  // removes
+             LevelUpdateEvent{Side::Sell, 110, 0},                                          // unknown: no-op
+         })
+        depth.apply(e);
+
+    std::array<DepthLevel, 2> top{};
+    ASSERT_EQ(depth.top(Side::Buy, top), 2u);
+    EXPECT_EQ(top, (std::array{DepthLevel{101, 1}, DepthLevel{100, 7}}));
+    ASSERT_EQ(depth.top(Side::Sell, top), 2u);
+    EXPECT_EQ(top, (std::array{DepthLevel{103, 1}, DepthLevel{104, 3}}));
+    EXPECT_EQ(depth.levels(Side::Buy), 3u);
+    EXPECT_EQ(depth.levels(Side::Sell), 2u);
+}
+
+class MarketDataRingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_path = std::filesystem::temp_directory_path() /
+                 std::format("engine_feed_{}_{}", ::getpid(),
+                             ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    }
+    void TearDown() override { std::filesystem::remove(m_path); }
+
+    [[nodiscard]] std::string path() const { return m_path.string(); }
+
+    /// A record whose every field is derived from `n`, so a torn read shows.
+    [[nodiscard]] static FeedRecord record(std::uint64_t n) {
+        return FeedRecord{.symbol = n * 7, .type = FeedType::Order, .action = BookAction::Modify,
+                          .side = n % 2 ? Side::Buy : Side::Sell, .id = static_cast<OrderId>(n),
+                          .maker = static_cast<OrderId>(~n), .price = static_cast<Price>(n * 3),
+                          .quantity = static_cast<Quantity>(n ^ 0x5555)};
+    }
+
+private:
+    std::filesystem::path m_path;
+};
+
+TEST_F(MarketDataRingTest, ReaderTailsRecordsInOrder) {
+    const auto ring = MarketDataRing::create(path(), 64);
+    ASSERT_NE(ring, nullptr);
+    ring->publish(record(100));  // before the reader joins: not seen
+    const auto reader = MarketDataReader::open(path());
+    ASSERT_NE(reader, nullptr);
+
+    FeedRecord got{};
+    EXPECT_EQ(reader->poll(got), MarketDataReader::Poll::Empty);
+    for (std::uint64_t n = 1; n <= 200; ++n) {
+        ring->publish(record(n));
+        ASSERT_EQ(reader->poll(got), MarketDataReader::Poll::Record);
+        FeedRecord want = record(n);
+        want.sequence   = n + 1;
+        ASSERT_EQ(got, want);
+    }
+    EXPECT_EQ(reader->poll(got), MarketDataReader::Poll::Empty);
+
+    reader->rewind();
+    EXPECT_EQ(reader->next(), ring->published() - ring->capacity() + 2) << "oldest intact record";
+}
+
+TEST_F(MarketDataRingTest, SlowReaderIsToldWhatItLost) {
+    const auto ring = MarketDataRing::create(path(), 8);
+    ASSERT_NE(ring, nullptr);
+    const auto reader = MarketDataReader::open(path());
+    ASSERT_NE(reader, nullptr);
+    for (std::uint64_t n = 1; n <= 20; ++n) ring->publish(record(n));
+
+    FeedRecord got{};
+    ASSERT_EQ(reader->poll(got), MarketDataReader::Poll::Overrun);
+    EXPECT_EQ(reader->lost(), 13u);
+    for (std::uint64_t seq = 14; seq <= 20; ++seq) {
+        ASSERT_EQ(reader->poll(got), MarketDataReader::Poll::Record);
+        EXPECT_EQ(got.sequence, seq);
+        EXPECT_EQ(got.id, static_cast<OrderId>(seq));
+    }
+    EXPECT_EQ(reader->poll(got), MarketDataReader::Poll::Empty);
+}
+
+TEST_F(MarketDataRingTest, ConcurrentReaderNeverSeesATornRecord) {
+    const auto ring = MarketDataRing::create(path(), 256);  // small: forces overruns
+    ASSERT_NE(ring, nullptr);
+    const auto reader = MarketDataReader::open(path());
+    ASSERT_NE(reader, nullptr);
+    constexpr std::uint64_t kCount = 1'000'000;
+
+    std::atomic<bool> done{false};
+    std::jthread producer{[&] {
+        for (std::uint64_t n = 1; n <= kCount; ++n) ring->publish(record(n));
+        done.store(true, std::memory_order_release);
+    }};
+
+    std::uint64_t received = 0;
+    FeedRecord    got{};
+    for (;;) {
+        const auto status = reader->poll(got);
+        if (status == MarketDataReader::Poll::Record) {
+            FeedRecord want = record(got.sequence);
+            want.sequence   = got.sequence;
+            ASSERT_EQ(got, want) << "torn record " << got.sequence;
+            ASSERT_EQ(got.sequence, reader->next() - 1);
+            ++received;
+        } else if (status == MarketDataReader::Poll::Empty && done.load(std::memory_order_acquire) &&
+                   reader->next() > kCount) {
+            break;
+        }
+    }
+    EXPECT_EQ(received + reader->lost(), kCount);
+}
+
+TEST_F(MarketDataRingTest, RejectsAFileThatIsNotARing) {
+    { std::ofstream{path(), std::ios::binary} << std::string(4096, 'x'); }
+    EXPECT_EQ(MarketDataReader::open(path()), nullptr);
+}
+
+TEST_F(MarketDataRingTest, InlineSessionsPublishFillsAndBookUpdates) {
+    const auto ring = MarketDataRing::create(path(), 64);
+    ASSERT_NE(ring, nullptr);
+    const auto reader = MarketDataReader::open(path());
+    ASSERT_NE(reader, nullptr);
+
+    BookRegistry books{16};
+    const SymbolCode aapl = *encode_symbol("AAPL");
+    books.add(aapl);
+    InlineSession session{books, nullptr, ring.get()};
+    std::string tx;
+    session.line("SUBMIT AAPL 1 S 100 5", tx);
+    session.line("SUBMIT AAPL 2 B 100 3", tx);
+    session.line("CANCEL MSFT 1", tx);  // never reaches a book: nothing published
+    EXPECT_EQ(tx, "ACK 1\nFILL 2 1 100 3\nACK 2\nERR UNKNOWN_SYMBOL\n") << "responses unchanged";
+
+    std::vector<FeedRecord> feed;
+    for (FeedRecord r{}; reader->poll(r) == MarketDataReader::Poll::Record;) feed.push_back(r);
+    EXPECT_EQ(feed, (std::vector<FeedRecord>{
+        {.sequence = 1, .symbol = aapl, .type = FeedType::Order, .action = BookAction::Add, .side = Side::Sell,
+         .id = 1, .price = 100, .quantity = 5},
+        {.sequence = 2, .symbol = aapl, .type = FeedType::Level, .side = Side::Sell, .price = 100, .quantity = 5},
+        {.sequence = 3, .symbol = aapl, .type = FeedType::Fill, .id = 2, .maker = 1, .price = 100, .quantity = 3},
+        {.sequence = 4, .symbol = aapl, .type = FeedType::Order, .action = BookAction::Modify, .side = Side::Sell,
+         .id = 1, .price = 100, .quantity = 2},
+        {.sequence = 5, .symbol = aapl, .type = FeedType::Level, .side = Side::Sell, .price = 100, .quantity = 2},
+    }));
+}
+
+}  // namespace
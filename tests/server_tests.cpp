@@ -0,0 +1,166 @@
+// Loopback tests for the network transports (GoogleTest).
+
+#include "BinaryProtocol.hpp"
+#include "BookRegistry.hpp"
+#include "Server.hpp"
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+enum class Transport { Epoll, IoUring };
+
+/// Runs the transport under test on an ephemeral loopback port in a
+/// background thread. Every test runs against each transport.
+class ServerTest : public ::testing::TestWithParam<Transport> {
+protected:
+    void SetUp() override {
+        if (GetParam() == Transport::IoUring && !io_uring_supported())
+            GTEST_SKIP() << "io_uring unavailable on this kernel";
+
+        m_listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_GE(m_listenFd, 0);
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port        = 0;
+        ASSERT_EQ(::bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        ASSERT_EQ(::listen(m_listenFd, 16), 0);
+        socklen_t len = sizeof(addr);
+        ASSERT_EQ(::getsockname(m_listenFd, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+        m_port = ntohs(addr.sin_port);
+
+        m_server = std::jthread{[this](std::stop_token stop) {
+            if (GetParam() == Transport::Epoll) run_epoll_server(m_listenFd, m_sessions, {}, stop);
+            else                                run_io_uring_server(m_listenFd, m_sessions, {}, stop);
+        }};
+    }
+
+    void TearDown() override {
+        if (!m_server.joinable()) return;  // skipped
+        m_server.request_stop();
+        m_server.join();
+        ::close(m_listenFd);
+    }
+
+    [[nodiscard]] int connectClient() const {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port        = htons(m_port);
+        EXPECT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        timeval tv{.tv_sec = 5, .tv_usec = 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        return fd;
+    }
+
+    /// Send `request` and read until `bytes` response bytes have arrived.
+    static std::string roundTrip(int fd, std::string_view request, std::size_t bytes) {
+        EXPECT_EQ(::send(fd, request.data(), request.size(), 0), static_cast<ssize_t>(request.size()));
+        std::string out;
+        char buf[4096];
+        while (out.size() < bytes) {
+            const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n < 0 && errno == EINTR) continue;  // SO_RCVTIMEO makes recv non-restartable
+            if (n <= 0) break;
+            out.append(buf, static_cast<std::size_t>(n));
+        }
+        return out;
+    }
+
+    BookRegistry   m_books{1024};
+    SessionFactory m_sessions{m_books};
+    int            m_listenFd = -1;
+    std::uint16_t  m_port     = 0;
+    std::jthread   m_server;
+};
+
+TEST_P(ServerTest, ConcurrentClientsShareOneBook) {
+    const int a = connectClient();
+    const int b = connectClient();
+
+    // Client A stays connected and idle while B trades against its order —
+    // the old accept loop would have blocked B until A disconnected.
+    EXPECT_EQ(roundTrip(a, "SUBMIT 1 S 100 5\n", 6), "ACK 1\n");
+    EXPECT_EQ(roundTrip(b, "SUBMIT 2 B 100 3\n", 21), "FILL 2 1 100 3\nACK 2\n");
+    EXPECT_EQ(roundTrip(a, "CANCEL 1\n", 6), "ACK 1\n");
+
+    ::close(a);
+    ::close(b);
+}
+
+TEST_P(ServerTest, ReassemblesLinesSplitAcrossWrites) {
+    const int fd = connectClient();
+    EXPECT_EQ(roundTrip(fd, "SUBMIT 7 B 9", 0), "");
+    EXPECT_EQ(roundTrip(fd, "9 1\nDUMP\n", 28), "ACK 7\nBIDS:\n99: 7(1) \nASKS:\n");
+    ::close(fd);
+}
+
+TEST_P(ServerTest, LargePipelinedBurstIsAnsweredInFull) {
+    const int fd = connectClient();
+    std::string burst, expected;
+    for (int id = 1; id <= 20'000; ++id) {
+        burst    += "SUBMIT " + std::to_string(id) + " B 50 1\n";
+        expected += "ACK " + std::to_string(id) + "\n";
+    }
+    std::jthread writer{[&] { ::send(fd, burst.data(), burst.size(), 0); }};
+    EXPECT_EQ(roundTrip(fd, "", expected.size()), expected);
+    ::close(fd);
+}
+
+TEST_P(ServerTest, NegotiatesBinaryProtocolPerConnection) {
+    const int text   = connectClient();
+    const int binary = connectClient();
+
+    // The switch and the first message may arrive in one segment; the reply
+    // to everything after the "BINARY" line is binary.
+    std::string request{"SUBMIT 1 S 100 5\nBINARY\n"};
+    encode_submit(request, Order{.id = 2, .side = Side::Buy, .price = 100, .quantity = 2});
+    std::string expected{"ACK BINARY\n"};
+    BinarySink{expected}(FillEvent{2, 1, 100, 2});
+    BinarySink{expected}(AckEvent{2});
+    EXPECT_EQ(roundTrip(binary, request, expected.size() + 6), "ACK 1\n" + expected);
+
+    EXPECT_EQ(roundTrip(text, "CANCEL 1\n", 6), "ACK 1\n") << "other connections stay text";
+
+    ::close(text);
+    ::close(binary);
+}
+
+TEST_P(ServerTest, StatsReportsHotPathLatency) {
+    const int fd = connectClient();
+    EXPECT_EQ(roundTrip(fd, "SUBMIT 1 B 100 1\n", 6), "ACK 1\n");
+
+    std::string stats = roundTrip(fd, "STATS\n", 1);
+    while (stats.find("STATS total") == std::string::npos || stats.back() != '\n') {
+        const std::string more = roundTrip(fd, "", 1);
+        ASSERT_FALSE(more.empty()) << "incomplete STATS reply: " << stats;
+        stats += more;
+    }
+    for (const char* stage : {"parse", "match", "send", "total"})
+        EXPECT_NE(stats.find(std::string{"STATS "} + stage + " n="), std::string::npos) << stats;
+    EXPECT_EQ(stats.find("STATS match n=0 "), std::string::npos) << "the SUBMIT was timed: " << stats;
+    EXPECT_EQ(roundTrip(fd, "CANCEL 1\n", 6), "ACK 1\n") << "STATS is not a book command";
+    ::close(fd);
+}
+
+INSTANTIATE_TEST_SUITE_P(Transports, ServerTest,
+                         ::testing::Values(Transport::Epoll, Transport::IoUring),
+                         [](const ::testing::TestParamInfo<Transport>& param) {
+                             return param.param == Transport::Epoll ? "Epoll" : "IoUring";
+                         });
+
+}  // namespace
@@ -0,0 +1,226 @@
+// Unit tests for the SPSC queue and the sharded runtime (GoogleTest).
+
+#include "BinaryProtocol.hpp"
+#include "BookRegistry.hpp"
+#include "EventLog.hpp"
+#include "Protocol.hpp"
+#include "ShardedEngine.hpp"
+#include "SpscQueue.hpp"
+#include "Symbol.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+TEST(SpscQueueTest, PreservesOrderAcrossThreads) {
+    SpscQueue<std::uint64_t> q{1024};
+    constexpr std::uint64_t kCount = 500'000;
+
+    std::jthread producer{[&q] {
+        SpinBackoff backoff;
+        for (std::uint64_t i = 0; i < kCount; ++i)
+            while (!q.tryPush(i)) backoff.idle();
+    }};
+
+    std::uint64_t expected = 0;
+    SpinBackoff backoff;
+    while (expected < kCount) {
+        if (q.drain([&](std::uint64_t v) { ASSERT_EQ(v, expected); ++expected; }) == 0) backoff.idle();
+    }
+    std::uint64_t extra;
+    EXPECT_FALSE(q.tryPop(extra));
+}
+
+TEST(SpscQueueTest, ReportsFullAndRoundsCapacity) {
+    SpscQueue<int> q{3};
+    EXPECT_EQ(q.capacity(), 4u);
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(q.tryPush(i));
+    EXPECT_FALSE(q.tryPush(4));
+    int v = -1;
+    EXPECT_TRUE(q.tryPop(v));
+    EXPECT_EQ(v, 0);
+    EXPECT_TRUE(q.tryPush(4));
+}
+
+// Matching on one thread, formatting on another, through recycled logs: the
+// text must match formatting inline.
+TEST(EventLogPipeTest, ReplaysOnAnotherThreadInOrder) {
+    std::vector<Order> orders;
+    std::mt19937 rng{3};
+    for (OrderId id = 1; id <= 50'000; ++id) {
+        orders.push_back(Order{.id = id, .side = rng() % 2 ? Side::Buy : Side::Sell,
+                               .price = 95 + static_cast<Price>(rng() % 11),
+                               .quantity = 1 + static_cast<Quantity>(rng() % 10)});
+    }
+
+    std::string expected;
+    MatchingEngine inlineBook;
+    for (const Order& o : orders) inlineBook.submit(o, FormattingSink{expected});
+
+    EventLogPipe<EventLog> pipe{3, 64};
+    std::atomic<bool> done{false};
+    std::string formatted;
+    std::jthread replayer{[&] {
+        SpinBackoff backoff;
+        for (;;) {
+            const bool last = done.load(std::memory_order_acquire);  // before the final drain
+            if (pipe.consume([&](const EventLog& log) { log.replay(FormattingSink{formatted}); }) != 0)
+                backoff.reset();
+            else if (last)
+                return;
+            else
+                backoff.idle();
+        }
+    }};
+
+    MatchingEngine book;
+    for (std::size_t i = 0; i < orders.size(); i += 100) {
+        EventLog& log = pipe.acquire();
+        book.submitBatch(std::span{orders}.subspan(i, std::min<std::size_t>(100, orders.size() - i)), log);
+        pipe.publish(log);
+    }
+    done.store(true, std::memory_order_release);
+    replayer.join();
+
+    EXPECT_EQ(formatted, expected);
+}
+
+// The sharded runtime must produce, per symbol, exactly what a single-threaded
+// registry produces for the same order flow.
+TEST(ShardedEngineTest, MatchesInlineRegistryPerSymbol) {
+    const std::array names{"AAPL", "MSFT", "ES", "NQ", "CL", "GC", "ZN"};
+    std::vector<SymbolCode> symbols;
+    BookRegistry inline_books{256};
+    for (const char* name : names) {
+        symbols.push_back(*encode_symbol(name));
+        inline_books.add(symbols.back());
+    }
+
+    ShardedEngine sharded{symbols, {.shards = 3, .queueCapacity = 64, .ordersPerBook = 256, .firstCpu = -1}};
+    ShardedSession session{sharded};
+
+    std::mt19937 rng{11};
+    std::string expected, response, tx;
+    for (int id = 1; id <= 5'000; ++id) {
+        const char* sym = names[rng() % names.size()];
+        const auto roll = rng() % 8;
+        const std::string line =
+            roll < 2   ? std::format("CANCEL {} {}", sym, 1 + rng() % id)
+            : roll == 2 ? std::format("MODIFY {} {} {} {}", sym, 1 + rng() % id, 95 + rng() % 11, 1 + rng() % 10)
+                        : std::format("SUBMIT {} {} {} {} {}", sym, id, rng() % 2 ? 'B' : 'S', 95 + rng() % 11,
+                                      1 + rng() % 10);
+
+        ASSERT_TRUE(process_line(line, inline_books, response));
+        expected += response;
+        session.line(line, tx);
+        session.flush(tx);  // one request in flight: output order is total
+    }
+    EXPECT_EQ(tx, expected);
+
+    for (const char* name : names) {
+        std::string inlineDump, shardedDump;
+        ASSERT_TRUE(process_line(std::format("DUMP {}", name), inline_books, inlineDump));
+        session.line(std::format("DUMP {}", name), shardedDump);
+        EXPECT_EQ(shardedDump, inlineDump) << name;
+    }
+}
+
+TEST(ShardedEngineTest, PipelinedBatchKeepsPerSymbolOrder) {
+    const std::vector<SymbolCode> symbols{*encode_symbol("AAA"), *encode_symbol("BBB")};
+    // A tiny queue forces the back-pressure path (front end drains while posting).
+    ShardedEngine sharded{symbols, {.shards = 2, .queueCapacity = 4, .ordersPerBook = 64, .firstCpu = -1}};
+    ShardedSession session{sharded};
+
+    std::string tx;
+    for (int i = 1; i <= 100; ++i) session.line(std::format("SUBMIT AAA {} S 100 1", i), tx);
+    session.line("SUBMIT BBB 1000 B 1 1", tx);
+    session.line("SUBMIT AAA 2000 B 100 100", tx);
+    session.line("BOGUS", tx);
+    EXPECT_EQ(tx, "ERR UNKNOWN_CMD\n") << "errors are answered immediately";
+    session.flush(tx);
+
+    std::string aaaFills;
+    for (int i = 1; i <= 100; ++i) aaaFills += std::format("FILL 2000 {} 100 1\n", i);
+    EXPECT_NE(tx.find(aaaFills + "ACK 2000\n"), std::string::npos) << "FILLs stay in maker FIFO order";
+    EXPECT_NE(tx.find("ACK 1000\n"), std::string::npos);
+
+    std::string dump;
+    session.line("DUMP AAA", dump);
+    EXPECT_EQ(dump, "BIDS:\nASKS:\n") << "the sweep consumed every ask";
+    dump.clear();
+    session.line("DUMP BBB", dump);
+    EXPECT_EQ(dump, "BIDS:\n1: 1000(1) \nASKS:\n");
+}
+
+TEST(ShardedEngineTest, BinarySessionMatchesInlineRegistry) {
+    const std::vector<SymbolCode> symbols{*encode_symbol("AAA"), *encode_symbol("BBB")};
+    BookRegistry inline_books{256};
+    for (const SymbolCode s : symbols) inline_books.add(s);
+    ShardedEngine sharded{symbols, {.shards = 2, .queueCapacity = 64, .ordersPerBook = 256, .firstCpu = -1}};
+    ShardedSession session{sharded};
+    session.setFormat(WireFormat::Binary);
+
+    std::mt19937 rng{5};
+    std::string msg, expected, tx;
+    for (int id = 1; id <= 2'000; ++id) {
+        const SymbolCode sym = rng() % 8 == 0 ? *encode_symbol("CCC") : symbols[rng() % 2];
+        msg.clear();
+        if (rng() % 4 == 0) encode_cancel(msg, 1 + rng() % id, sym);
+        else encode_submit(msg, Order{.id = id, .side = rng() % 2 ? Side::Buy : Side::Sell,
+                                      .price = 95 + static_cast<Price>(rng() % 11),
+                                      .quantity = 1 + static_cast<Quantity>(rng() % 10)}, sym);
+
+        process_message(msg, inline_books, expected);
+        session.message(msg, tx);
+        session.flush(tx);
+    }
+    EXPECT_EQ(tx, expected) << "byte-identical binary event streams";
+}
+
+TEST(ShardedEngineTest, RiskLimitsAndThrottleApplyPerShardBook) {
+    const std::vector<SymbolCode> symbols{*encode_symbol("AAA"), *encode_symbol("BBB")};
+    const RiskLimits limits{.maxQuantity = 8, .collar = 3, .maxOpenOrders = 5, .maxPosition = 12};
+    BookRegistry inline_books{256, limits};
+    for (const SymbolCode s : symbols) inline_books.add(s);
+    ShardedEngine sharded{symbols,
+                          {.shards = 2, .queueCapacity = 64, .ordersPerBook = 256, .firstCpu = -1, .risk = limits}};
+    ShardedSession session{sharded};
+
+    std::mt19937 rng{17};
+    std::string expected, response, tx;
+    for (int id = 1; id <= 3'000; ++id) {
+        const char* sym = rng() % 2 ? "AAA" : "BBB";
+        const std::string line =
+            rng() % 4 == 0 ? std::format("CANCEL {} {}", sym, 1 + rng() % id)
+                           : std::format("SUBMIT {} {} {} {} {} ACCT={}", sym, id, rng() % 2 ? 'B' : 'S',
+                                         95 + rng() % 11, 1 + rng() % 10, 1 + rng() % 3);
+        ASSERT_TRUE(process_line(line, inline_books, response));
+        expected += response;
+        session.line(line, tx);
+        session.flush(tx);
+    }
+    EXPECT_EQ(tx, expected);
+    EXPECT_NE(expected.find("ERR RISK_"), std::string::npos) << "the flow must exercise the limits";
+
+    ShardedSession throttled{sharded, 1, nullptr, 2};
+    tx.clear();
+    for (const char* line : {"SUBMIT AAA 9001 B 1 1", "SUBMIT AAA 9002 B 1 1", "SUBMIT AAA 9003 B 1 1",
+                             "CANCEL AAA 9001"}) {
+        throttled.line(line, tx);
+        throttled.flush(tx);
+    }
+    EXPECT_EQ(tx, "ACK 9001\nACK 9002\nERR THROTTLED 9003\nACK 9001\n");
+}
+
+}  // namespace
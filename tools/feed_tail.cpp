@@ -0,0 +1,103 @@
+#include "Log.hpp"
+#include "MarketDataRing.hpp"
+#include "Symbol.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+/**
+ * Test consumer for the market-data ring.
+ *
+ *   feed_tail FILE [--from-start] [--stats]
+ *
+ * Maps the ring the server publishes with --feed FILE and prints each record
+ * as it arrives — or, with --stats, one line per second of record rate and
+ * records lost to overruns. Starts at the live tail unless --from-start asks
+ * for the oldest record still in the ring.
+ */
+
+namespace {
+
+[[nodiscard]] std::string_view action_label(BookAction action) noexcept {
+    switch (action) {
+        using enum BookAction;
+        case Add:    return "ADD";
+        case Modify: return "MODIFY";
+        case Delete: return "DELETE";
+    }
+    return "?";
+}
+
+void print(const FeedRecord& r) {
+    const std::string symbol = r.symbol == kNoSymbol ? std::string{"-"} : symbol_name(r.symbol);
+    switch (r.type) {
+        case FeedType::Fill:
+            logln("{} {} FILL {} {} {} {}", r.sequence, symbol, r.id, r.maker, r.price, r.quantity);
+            return;
+        case FeedType::Order:
+            logln("{} {} ORDER {} {} {} {} {}", r.sequence, symbol, action_label(r.action), r.id,
+                  side_label(r.side), r.price, r.quantity);
+            return;
+        case FeedType::Level:
+            logln("{} {} LEVEL {} {} {}", r.sequence, symbol, side_label(r.side), r.price, r.quantity);
+            return;
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        logln("usage: {} FILE [--from-start] [--stats]", argv[0]);
+        return 2;
+    }
+    bool fromStart = false;
+    bool stats     = false;
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (arg == "--from-start") fromStart = true;
+        else if (arg == "--stats") stats = true;
+        else logln("Ignoring argument '{}'.", arg);
+    }
+
+    const auto reader = MarketDataReader::open(argv[1]);
+    if (!reader) return 1;
+    if (fromStart) reader->rewind();
+
+    using Clock = std::chrono::steady_clock;
+    auto          nextReport = Clock::now() + std::chrono::seconds{1};
+    std::uint64_t received   = 0;
+    std::uint64_t lostBefore = 0;
+
+    FeedRecord  record;
+    SpinBackoff backoff;
+    bool        unflushed = false;
+    for (;;) {
+        switch (reader->poll(record)) {
+            case MarketDataReader::Poll::Record:
+                ++received;
+                if (!stats) print(record);
+                unflushed |= !stats;
+                backoff.reset();
+                break;
+            case MarketDataReader::Poll::Overrun:
+                if (!stats) logln("-- overrun: resuming at {} ({} lost in total)", reader->next(), reader->lost());
+                break;
+            case MarketDataReader::Poll::Empty:
+                if (unflushed) std::fflush(stdout);  // caught up: let a piped reader see it
+                unflushed = false;
+                backoff.idle();
+                break;
+        }
+        if (stats && Clock::now() >= nextReport) {
+            logln("{} records/s, {} lost, next {}", received, reader->lost() - lostBefore, reader->next());
+            received   = 0;
+            lostBefore = reader->lost();
+            unflushed  = true;
+            nextReport += std::chrono::seconds{1};
+        }
+    }
+}
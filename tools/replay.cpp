@@ -0,0 +1,331 @@
+#include "BinaryProtocol.hpp"
+#include "BookRegistry.hpp"
+#include "Journal.hpp"
+#include "Latency.hpp"
+#include "Log.hpp"
+#include "Protocol.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+/**
+ * Deterministic offline replay of recorded order flow.
+ *
+ *   replay FILE [--binary] [--paced] [--speed X] [--orders N]
+ *               [--output FILE] [--expect CHECKSUM]
+ *
+ * Maps FILE and feeds it, command by command, through the server's own
+ * process_command() / process_message() into fresh books (every symbol the
+ * capture names is registered before the clock starts). FILE is one of:
+ *
+ *   - text protocol lines, each optionally led by its receive time in
+ *     nanoseconds: "1700000000123456789 SUBMIT AAPL 1 B 100 10";
+ *   - a journal written by the server's --journal (recognised by its header);
+ *   - with --binary, a raw binary-protocol stream as a client sends it
+ *     after "BINARY".
+ *
+ * By default commands go in back to back and latency is each command's
+ * service time. --paced holds every timestamped line until its recorded
+ * offset from the first (--speed X replays X times faster); latency then
+ * runs from the scheduled time, so a replay that falls behind reports its
+ * queueing delay instead of hiding it.
+ *
+ * Prints throughput, latency percentiles and a 64-bit FNV-1a checksum of
+ * every response byte. The engine is deterministic, so the checksum pins
+ * down the output for a capture: compare it across builds, or pass --expect
+ * to exit 1 when it differs. --output writes the responses themselves, for
+ * diffing when it does.
+ */
+
+namespace {
+
+enum class Capture : std::uint8_t { Text, Journal, Binary };
+
+struct Options {
+    const char*                  file       = nullptr;
+    bool                         binary     = false;
+    double                       speed      = 0;  // 0 = back to back; else recorded time / speed
+    std::size_t                  orders     = BookRegistry::kDefaultOrdersPerBook;
+    const char*                  outputFile = nullptr;
+    std::optional<std::uint64_t> expect;
+};
+
+template <class T>
+[[nodiscard]] std::optional<T> parse_number(std::string_view arg, int base = 10) noexcept {
+    T value{};
+    std::from_chars_result r{};
+    if constexpr (std::is_floating_point_v<T>) r = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    else                                       r = std::from_chars(arg.data(), arg.data() + arg.size(), value, base);
+    if (r.ec != std::errc{} || r.ptr != arg.data() + arg.size()) return std::nullopt;
+    return value;
+}
+
+[[nodiscard]] std::optional<Options> parse_options(int argc, char** argv) {
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        const char* const value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (arg == "--binary") {
+            opts.binary = true;
+        } else if (arg == "--paced") {
+            if (opts.speed == 0) opts.speed = 1;
+        } else if (arg == "--speed" && value) {
+            if (const auto x = parse_number<double>(value); x && *x > 0) opts.speed = *x;
+            else logln("Ignoring invalid speed '{}'.", value);
+            ++i;
+        } else if (arg == "--orders" && value) {
+            if (const auto n = parse_number<std::size_t>(value)) opts.orders = *n;
+            else logln("Ignoring invalid order count '{}'.", value);
+            ++i;
+        } else if (arg == "--output" && value) {
+            opts.outputFile = value;
+            ++i;
+        } else if (arg == "--expect" && value) {
+            std::string_view hex{value};
+            if (hex.starts_with("0x")) hex.remove_prefix(2);
+            opts.expect = parse_number<std::uint64_t>(hex, 16);
+            if (!opts.expect) logln("Ignoring invalid checksum '{}'.", value);
+            ++i;
+        } else if (!opts.file && !arg.starts_with("--")) {
+            opts.file = argv[i];
+        } else {
+            logln("Ignoring argument '{}'.", arg);
+        }
+    }
+    if (!opts.file) return std::nullopt;
+    return opts;
+}
+
+/// A whole file mapped read-only; an empty file maps to an empty view.
+class MappedFile {
+public:
+    explicit MappedFile(const char* path) noexcept {
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::perror(path);
+            return;
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) < 0) {
+            std::perror(path);
+        } else if (st.st_size == 0) {
+            m_ok = true;
+        } else {
+            const auto size = static_cast<std::size_t>(st.st_size);
+            void* const addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                std::perror("mmap");
+            } else {
+                ::madvise(addr, size, MADV_SEQUENTIAL);
+                m_data = {static_cast<const char*>(addr), size};
+                m_ok   = true;
+            }
+        }
+        ::close(fd);
+    }
+    ~MappedFile() {
+        if (!m_data.empty()) ::munmap(const_cast<char*>(m_data.data()), m_data.size());
+    }
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] explicit operator bool() const noexcept { return m_ok; }
+    [[nodiscard]] std::string_view data() const noexcept { return m_data; }
+
+private:
+    std::string_view m_data;
+    bool             m_ok = false;
+};
+
+/// One recorded command: its wire bytes and receive time (0 = none recorded).
+struct Step {
+    std::string_view input;
+    std::uint64_t    at = 0;
+};
+
+/**
+ * Walks a capture one command at a time. Blank text lines are skipped; a
+ * truncated final binary message ends the capture (see trailing()).
+ */
+class CaptureReader {
+public:
+    CaptureReader(std::string_view data, Capture capture) noexcept : m_rest{data}, m_capture{capture} {}
+
+    [[nodiscard]] bool next(Step& step) noexcept {
+        if (m_capture != Capture::Text) {
+            const std::size_t n = binary_message_size(m_rest);
+            if (n == 0) return false;
+            step = {m_rest.substr(0, n), 0};
+            m_rest.remove_prefix(n);
+            return true;
+        }
+        while (!m_rest.empty()) {
+            const std::size_t eol  = m_rest.find('\n');
+            std::string_view  line = m_rest.substr(0, eol);
+            m_rest.remove_prefix(eol == std::string_view::npos ? m_rest.size() : eol + 1);
+
+            std::uint64_t at = 0;
+            if (!line.empty() && std::isdigit(static_cast<unsigned char>(line.front()))) {
+                const auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), at);
+                line.remove_prefix(static_cast<std::size_t>(ptr - line.data()));
+            }
+            if (line.find_first_not_of(" \t\r") == std::string_view::npos) continue;
+            step = {line, at};
+            return true;
+        }
+        return false;
+    }
+
+    /// Bytes left unread once next() has returned false.
+    [[nodiscard]] std::size_t trailing() const noexcept { return m_rest.size(); }
+
+private:
+    std::string_view m_rest;
+    Capture          m_capture;
+};
+
+/// The capture format of `data`, and its commands with any header stripped.
+[[nodiscard]] std::optional<std::pair<Capture, std::string_view>> identify(const Options& opts,
+                                                                          std::string_view data) {
+    if (!data.starts_with(kJournalMagic))
+        return std::pair{opts.binary ? Capture::Binary : Capture::Text, data};
+    std::uint32_t version = 0;
+    if (data.size() >= kJournalHeaderSize) std::memcpy(&version, data.data() + kJournalMagic.size(), sizeof(version));
+    if (from_wire(version) != kJournalVersion) {
+        logln("{}: not a version {} journal.", opts.file, kJournalVersion);
+        return std::nullopt;
+    }
+    return std::pair{Capture::Journal, data.substr(kJournalHeaderSize)};
+}
+
+[[nodiscard]] std::optional<Command> decode(const Step& step, Capture capture) noexcept {
+    if (capture != Capture::Text) return decode_message(step.input);
+    auto parsed = parse_command(step.input);
+    return parsed ? std::optional<Command>{*parsed} : std::nullopt;
+}
+
+/// 64-bit FNV-1a, continued from `hash`.
+[[nodiscard]] std::uint64_t fnv1a(std::uint64_t hash, std::string_view bytes) noexcept {
+    for (const char c : bytes) hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    return hash;
+}
+constexpr std::uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+
+/// Spin until the TSC reaches `due`, sleeping through most of a long wait.
+void wait_until(std::uint64_t due, double ticksPerNs) {
+    constexpr double kSpinNs = 100'000;
+    for (std::uint64_t now = read_tsc(); now < due; now = read_tsc()) {
+        const double aheadNs = static_cast<double>(due - now) / ticksPerNs;
+        if (aheadNs > 2 * kSpinNs)
+            std::this_thread::sleep_for(std::chrono::nanoseconds{static_cast<std::int64_t>(aheadNs - kSpinNs)});
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const auto opts = parse_options(argc, argv);
+    if (!opts) {
+        logln("usage: {} FILE [--binary] [--paced] [--speed X] [--orders N] [--output FILE] [--expect CHECKSUM]",
+              argv[0]);
+        return 2;
+    }
+
+    const MappedFile file{opts->file};
+    if (!file) return 1;
+    const auto identified = identify(*opts, file.data());
+    if (!identified) return 1;
+    const auto [capture, commands] = *identified;
+
+    // Register every symbol up front, as the server does from --symbols, so
+    // no book is built inside the timed loop. This pass also faults the
+    // mapping in.
+    BookRegistry  books{opts->orders};
+    std::uint64_t total = 0;
+    Step          step;
+    for (CaptureReader reader{commands, capture}; reader.next(step); ++total) {
+        if (const auto command = decode(step, capture)) {
+            const SymbolCode symbol = std::visit([](const auto& c) { return c.symbol; }, *command);
+            if (symbol != kNoSymbol) books.add(symbol);
+        }
+    }
+
+    std::FILE* output = nullptr;
+    if (opts->outputFile && !(output = std::fopen(opts->outputFile, "wb"))) {
+        std::perror(opts->outputFile);
+        return 1;
+    }
+
+    const double ticksPerNs = tsc_ticks_per_ns();
+    const bool   paced      = opts->speed > 0 && capture == Capture::Text;
+    if (opts->speed > 0 && !paced) logln("Binary captures carry no timestamps; replaying back to back.");
+
+    LatencyHistogram latency;
+    std::string      out;
+    std::uint64_t    checksum = kFnvOffset;
+    std::uint64_t    bytes    = 0;
+    std::uint64_t    first    = 0;  // earliest-recorded timestamp, once seen
+
+    using Clock = std::chrono::steady_clock;
+    const auto          wallStart = Clock::now();
+    const std::uint64_t tscStart  = read_tsc();
+
+    CaptureReader reader{commands, capture};
+    while (reader.next(step)) {
+        std::uint64_t begin = read_tsc();
+        if (paced && step.at != 0) {
+            if (first == 0) first = step.at;
+            const double        offsetNs = step.at > first ? static_cast<double>(step.at - first) : 0.0;
+            const std::uint64_t due      = tscStart + static_cast<std::uint64_t>(offsetNs * ticksPerNs / opts->speed);
+            wait_until(due, ticksPerNs);
+            begin = due;
+        }
+
+        if (capture == Capture::Text) (void)process_command(parse_command(step.input), books, out);
+        else                          process_message(step.input, books, out);
+        latency.record(read_tsc() - begin);
+
+        checksum = fnv1a(checksum, out);
+        bytes += out.size();
+        if (output) std::fwrite(out.data(), 1, out.size(), output);
+        out.clear();
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - wallStart).count();
+    if (output) std::fclose(output);
+
+    static constexpr std::string_view kCaptureNames[] = {"text", "journal", "binary"};
+    const auto ns = [ticksPerNs](std::uint64_t ticks) {
+        return static_cast<std::uint64_t>(static_cast<double>(ticks) / ticksPerNs + 0.5);
+    };
+    logln("{}: {} {} commands in {:.3f} s ({:.0f} commands/s{})", opts->file, total,
+          kCaptureNames[static_cast<std::size_t>(capture)], seconds,
+          seconds > 0 ? static_cast<double>(total) / seconds : 0.0, paced ? ", paced" : "");
+    logln("latency ns: p50={} p90={} p99={} p99.9={} max={}", ns(latency.percentile(50)),
+          ns(latency.percentile(90)), ns(latency.percentile(99)), ns(latency.percentile(99.9)), ns(latency.max()));
+    if (reader.trailing() != 0) logln("Ignored {} bytes of truncated trailing message.", reader.trailing());
+    logln("responses: {} bytes, checksum {:016x}", bytes, checksum);
+
+    if (opts->expect && *opts->expect != checksum) {
+        logln("CHECKSUM MISMATCH: expected {:016x}", *opts->expect);
+        return 1;
+    }
+    return 0;
+}